@@ -1,3 +1,9 @@
+// Cohorts with more likelihood terms (subjects or compressed titre cells)
+// than this are fitted with the subsampled likelihood, SUBSAMPLE_BATCH terms
+// per cold-rung step
+const SUBSAMPLE_MIN_TERMS = 100000;
+const SUBSAMPLE_BATCH = 1000;
+
 class SeroCOPApp {
     constructor() {
         this.mcmcModule = null;
@@ -14,10 +20,43 @@ class SeroCOPApp {
         await this.initializeMCMC();
     }
 
+    // Pick the fastest MCMC build this browser can run. The threaded build
+    // needs a cross-origin isolated page (SharedArrayBuffer), which only the
+    // Vercel deployment provides (vercel.json sends COOP/COEP; GitHub Pages
+    // cannot), so elsewhere the SIMD or baseline build is loaded. All three
+    // are built from the same source by `make -C wasm site`.
+    async loadMCMCFactory() {
+        const simdProbe = new Uint8Array([0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3,
+            2, 1, 0, 10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11]);
+        const hasSimd = WebAssembly.validate(simdProbe);
+        const candidates = [];
+        if (self.crossOriginIsolated && hasSimd) candidates.push('parallel_tempering_mcmc_mt.js');
+        if (hasSimd) candidates.push('parallel_tempering_mcmc_simd.js');
+        candidates.push('parallel_tempering_mcmc.js');
+        
+        for (const src of candidates) {
+            const loaded = await new Promise(resolve => {
+                const script = document.createElement('script');
+                script.src = src;
+                script.onload = () => resolve(true);
+                script.onerror = () => { script.remove(); resolve(false); };
+                document.head.appendChild(script);
+            });
+            if (loaded && typeof createMCMCModule === 'function') {
+                this.log(`Using MCMC build ${src}`);
+                return createMCMCModule;
+            }
+        }
+        throw new Error('No MCMC module build could be loaded');
+    }
+
     async initializeMCMC() {
         try {
             this.log('Loading parallel tempering MCMC module...');
-            this.mcmcModule = await createMCMCModule();
+            const createModule = await this.loadMCMCFactory();
+            this.mcmcModule = await createModule();
+            this.checkMCMCModule(this.mcmcModule);
+            this.log(`MCMC threads: ${this.mcmcModule.get_num_threads()}`);
             this.mcmcReady = true;
             this.log('✓ MCMC module loaded successfully');
             document.getElementById('loading-screen').style.display = 'none';
@@ -29,6 +68,19 @@ class SeroCOPApp {
         }
     }
 
+    // A stale build would silently miss the samplers this page drives, so
+    // refuse to start instead of falling back to older code paths
+    checkMCMCModule(Module) {
+        const missing = ['ParallelTemperingEnsemble', 'BiomarkerPanel', 'CsvParser', 'simd_enabled', 'get_num_threads']
+            .filter(name => typeof Module[name] !== 'function');
+        if (missing.length === 0 && typeof Module.ParallelTemperingEnsemble.prototype.get_warmup !== 'function') {
+            missing.push('ParallelTemperingEnsemble.get_warmup');
+        }
+        if (missing.length > 0) {
+            throw new Error(`MCMC module is out of date (missing ${missing.join(', ')}); rebuild it with \`make -C wasm site\``);
+        }
+    }
+
     setupEventListeners() {
         // File upload
         document.getElementById('file-input').addEventListener('change', (e) => this.handleFileUpload(e));
@@ -57,13 +109,99 @@ class SeroCOPApp {
         if (!file) return;
 
         try {
-            const text = await file.text();
-            this.loadDataFromCSV(text);
+            if (this.mcmcReady && typeof file.stream === 'function') {
+                await this.loadDataFromStream(file);
+            } else {
+                const text = await file.text();
+                this.loadDataFromCSV(text);
+            }
         } catch (error) {
             this.logError('Failed to load file: ' + error.message);
         }
     }
 
+    // Fitting needs both outcomes; throws with a message for the log
+    checkOutcomes(n, nInfected) {
+        if (n < 10) {
+            throw new Error(`Insufficient data: only ${n} observations. Need at least 10 for reliable model fitting.`);
+        }
+        
+        // Check for variance in outcome
+        const nProtected = n - nInfected;
+        if (nInfected === 0 || nProtected === 0) {
+            throw new Error('No variation in outcome: all observations are ' + 
+                (nInfected > 0 ? 'infected' : 'protected') + 
+                '. Need both infected and protected individuals.');
+        }
+        
+        // Check for sufficient variation in each outcome
+        if (nInfected < 3 || nProtected < 3) {
+            this.log(`Warning: Limited variation (infected=${nInfected}, protected=${nProtected}). Results may be unstable.`);
+        }
+    }
+    
+    // Parse an upload natively while it streams in: each chunk is copied once
+    // into the module's parser, which fills the titre/outcome columns row by
+    // row, so the file never exists as a JS string or as per-line arrays.
+    // Same column names and checks as loadDataFromCSV.
+    async loadDataFromStream(file) {
+        const Module = this.mcmcModule;
+        const parser = new Module.CsvParser();
+        const toArray = vec => {
+            const out = [];
+            for (let i = 0; i < vec.size(); i++) out.push(vec.get(i));
+            vec.delete();
+            return out;
+        };
+        try {
+            this.log('Parsing CSV data...');
+            const reader = file.stream().getReader();
+            for (;;) {
+                const { done, value } = await reader.read();
+                if (done) break;
+                parser.resize_chunk(value.length);
+                parser.get_chunk_view().set(value);
+                if (!parser.push_chunk()) {
+                    reader.cancel();
+                    break;
+                }
+            }
+            if (!parser.finish()) {
+                throw new Error(parser.get_error_message());
+            }
+            
+            const n = parser.get_num_rows();
+            const nInfected = parser.get_num_infected();
+            this.checkOutcomes(n, nInfected);
+            if (parser.get_num_skipped() > 0) {
+                this.log(`Skipped ${parser.get_num_skipped()} rows with empty titre or outcome`);
+            }
+            
+            // Plain arrays for the plots; the fits copy them back in one typed-array set
+            this.currentData = {
+                titre: Array.from(parser.column_view(0)),
+                infected: Array.from(parser.infected_view())
+            };
+            
+            this.displayDataSummary({
+                n: n,
+                n_infected: nInfected,
+                n_protected: n - nInfected,
+                titre_range: toArray(parser.get_titre_range(0)),
+                columns: toArray(parser.get_column_names()).join(', '),
+                n_biomarkers: 1
+            });
+            document.getElementById('fit-model').disabled = false;
+            this.log('\u2713 Data loaded successfully (' + n + ' observations)');
+            
+        } catch (error) {
+            this.logError('Failed to load data: ' + error.message);
+            console.error(error);
+        } finally {
+            parser.delete();
+        }
+    }
+    
     loadDataFromCSV(csvText) {
         try {
             this.log('Parsing CSV data...');
@@ -119,24 +257,7 @@ class SeroCOPApp {
                 throw new Error('No valid data rows found in CSV');
             }
             
-            if (titre.length < 10) {
-                throw new Error(`Insufficient data: only ${titre.length} observations. Need at least 10 for reliable model fitting.`);
-            }
-            
-            // Check for variance in outcome
-            const uniqueOutcomes = [...new Set(infected)];
-            if (uniqueOutcomes.length === 1) {
-                throw new Error('No variation in outcome: all observations are ' + 
-                    (uniqueOutcomes[0] === 1 ? 'infected' : 'protected') + 
-                    '. Need both infected and protected individuals.');
-            }
-            
-            // Check for sufficient variation in each outcome
-            const nInfected = infected.filter(x => x === 1).length;
-            const nProtected = infected.filter(x => x === 0).length;
-            if (nInfected < 3 || nProtected < 3) {
-                this.log(`Warning: Limited variation (infected=${nInfected}, protected=${nProtected}). Results may be unstable.`);
-            }
+            this.checkOutcomes(titre.length, infected.filter(x => x === 1).length);
             
             this.currentData = { titre, infected };
             
@@ -388,6 +509,11 @@ class SeroCOPApp {
         const useHierarchical = hierarchicalCheckbox ? hierarchicalCheckbox.checked : false;
         const chains = parseInt(document.getElementById('chains').value);
         const iter = parseInt(document.getElementById('iter').value);
+        const earlyStopCheckbox = document.getElementById('early-stop-check');
+        this.stoppingRule = earlyStopCheckbox && earlyStopCheckbox.checked ? {
+            rhat: parseFloat(document.getElementById('target-rhat').value),
+            ess: parseFloat(document.getElementById('target-ess').value)
+        } : null;
 
         this.log('Starting model fitting...');
         this.log(`Configuration: ${chains} chains, ${iter} iterations`);
@@ -581,6 +707,268 @@ class SeroCOPApp {
         }
     }
     
+    // Build a native Data object: the whole arrays in one typed-array copy
+    // straight into the Data buffers
+    createMCMCData(titreArray, infectedArray) {
+        const Module = this.mcmcModule;
+        const mcmcData = new Module.Data();
+        mcmcData.resize(titreArray.length);
+        mcmcData.titre_view().set(titreArray);
+        mcmcData.infected_view().set(infectedArray);
+        mcmcData.finalize();
+        
+        // Collapse repeated titres into binomial cells (exact, cheaper likelihood)
+        mcmcData.compress();
+        if (Module.simd_enabled()) {
+            // Mixed: double on the cold chain, float on the heated rungs
+            mcmcData.set_engine(Module.ENGINE_MIXED);
+        }
+        return mcmcData;
+    }
+    
+    // Run all chains as one native ensemble: one data copy, chains stepped
+    // together, and rank-normalized R-hat / bulk and tail ESS from C++.
+    // Sampling runs in chunks, yielding to the browser between them so the
+    // status line updates; with a stopping rule it ends once converged.
+    async runEnsemble(mcmcData, priors, chains, iter, label = '', titreArray = null) {
+        const ensemble = new this.mcmcModule.ParallelTemperingEnsemble(chains, 10, mcmcData, priors);
+        // Tune the ladder during warmup and drop the rungs it does not need
+        ensemble.set_ladder_policy({
+            adapt_until: Math.floor(iter / 2),
+            max_temperature: 10,
+            target_swap_rate: 0.5,
+            min_rungs: 3,
+            trim: true
+        });
+        // Very large cohorts: random-walk steps estimate the likelihood ratio
+        // from a subsample against a proxy anchored at the posterior mode.
+        // NUTS and pointwise LOO need full passes, so they stay off.
+        const terms = mcmcData.get_num_cells();
+        const subsampled = terms > SUBSAMPLE_MIN_TERMS;
+        if (subsampled) {
+            ensemble.set_subsampling(SUBSAMPLE_BATCH);
+            this.log(`${label}${terms.toLocaleString()} likelihood terms: subsampling ${SUBSAMPLE_BATCH} per step on the cold rung`);
+        }
+        // Gradient-based NUTS moves for the cold chains, adapted over warmup
+        if (!subsampled) {
+            ensemble.set_cold_move(this.mcmcModule.MOVE_NUTS, Math.floor(iter / 2));
+        }
+        // Pointwise log-likelihood statistics for PSIS-LOO / WAIC, post-warmup
+        if (!subsampled) {
+            ensemble.set_pointwise_loo(Math.floor(iter / 2));
+        }
+        if (this.stoppingRule) {
+            ensemble.set_stopping_rule(this.stoppingRule.rhat, this.stoppingRule.ess, 1000);
+        }
+        
+        const status = document.getElementById('fitting-status');
+        const chunk = Math.max(100, Math.floor(iter / 50));
+        while (ensemble.get_iteration() < iter && !ensemble.is_converged()) {
+            ensemble.run_chunk(Math.min(chunk, iter - ensemble.get_iteration()));
+            const pct = Math.round(100 * ensemble.get_iteration() / iter);
+            status.innerHTML = `<div class="spinner-small"></div><p>${label}${chains} chains: ${ensemble.get_iteration()}/${iter} iterations (${pct}%)</p>`;
+            await new Promise(resolve => setTimeout(resolve, 0));
+        }
+        if (ensemble.is_converged()) {
+            this.log(`${label}Converged after ${ensemble.get_iteration()} iterations; stopping early`);
+        }
+        const rungs = ensemble.get_num_chains();
+        const counts = [];
+        for (let i = 0; i < rungs.size(); i++) counts.push(rungs.get(i));
+        rungs.delete();
+        this.log(`${label}Adapted temperature ladders: ${counts.join(', ')} rungs (from 10)`);
+        
+        const readStart = performance.now();
+        // Same warmup as the stopping rule: never before adaptation has finished
+        const warmup = ensemble.get_warmup();
+        const results = this.readNativeResults(ensemble, chains, warmup, titreArray);
+        this.logRunStats(label, ensemble.get_stats(), (performance.now() - readStart) / 1000);
+        ensemble.delete();
+        return results;
+    }
+    
+    // Read post-warmup draws and diagnostics from a finished native fit.
+    // `source` exposes the ParallelTemperingEnsemble result methods.
+    readNativeResults(source, chains, warmup, titreArray = null) {
+        const allChainPosteriors = [];
+        
+        // Columns [floor | ceiling | ec50 | slope] over the WASM heap; each
+        // column holds the replicas back to back. One copy per column, taken
+        // before anything can grow the heap and detach the view.
+        const total = source.export_draws(warmup, 1);
+        const view = source.get_draws_view();
+        const perChain = total / chains;
+        const params = ['floor', 'ceiling', 'ec50', 'slope'];
+        for (let chain = 0; chain < chains; chain++) {
+            const chainPosteriors = {};
+            params.forEach((param, p) => {
+                const start = p * total + chain * perChain;
+                chainPosteriors[param] = Array.from(view.subarray(start, start + perChain));
+            });
+            allChainPosteriors.push(chainPosteriors);
+        }
+        
+        const toParams = vec => {
+            const out = { floor: vec.get(0), ceiling: vec.get(1), ec50: vec.get(2), slope: vec.get(3) };
+            vec.delete();
+            return out;
+        };
+        const nativeDiagnostics = {
+            rhat: toParams(source.compute_rhat(warmup)),
+            ess: toParams(source.compute_ess_bulk(warmup)),
+            ess_tail: toParams(source.compute_ess_tail(warmup))
+        };
+        const swapRates = source.get_swap_rates();
+        let swapSum = 0;
+        for (let i = 0; i < swapRates.size(); i++) swapSum += swapRates.get(i);
+        nativeDiagnostics.swap_rate = swapSum / swapRates.size();
+        swapRates.delete();
+        
+        // PSIS-LOO and WAIC, when the run accumulated any post-warmup draws
+        const loo = source.get_loo();
+        if (loo.n_draws > 0) nativeDiagnostics.loo = loo;
+        
+        // 95% bands of P(infection) over the plotting grid, from every draw
+        let bands = null;
+        if (titreArray) {
+            const grid = this.titreGrid(titreArray);
+            const gridVec = new this.mcmcModule.VectorDouble();
+            grid.forEach(t => gridVec.push_back(t));
+            const probVec = new this.mcmcModule.VectorDouble();
+            [0.025, 0.975].forEach(q => probVec.push_back(q));
+            const out = source.curve_bands(gridVec, warmup, probVec);
+            const G = grid.length;
+            bands = { titre: grid, mean: [], lower: [], upper: [] };
+            for (let g = 0; g < G; g++) {
+                bands.mean.push(out.get(g));
+                bands.lower.push(out.get(G + g));
+                bands.upper.push(out.get(2 * G + g));
+            }
+            out.delete();
+            gridVec.delete();
+            probVec.delete();
+        }
+        
+        // Mean, sd and 95% interval of each parameter over the pooled draws
+        const probVec = new this.mcmcModule.VectorDouble();
+        [0.025, 0.975].forEach(q => probVec.push_back(q));
+        const summaryOut = source.summarize(warmup, probVec);
+        const summaries = {};
+        params.forEach((param, p) => {
+            summaries[param] = {
+                mean: summaryOut.get(4 * p),
+                sd: summaryOut.get(4 * p + 1),
+                q025: summaryOut.get(4 * p + 2),
+                q975: summaryOut.get(4 * p + 3)
+            };
+        });
+        summaryOut.delete();
+        
+        // Exact ROC from the presorted titre index, and observed vs predicted
+        // risk over ten titre bins with 95% posterior bands
+        const curve = source.roc_curve();
+        const n = curve.size() / 2;
+        const roc = { fpr: [], tpr: [], auc: source.get_auc() };
+        for (let i = 0; i < n; i++) {
+            roc.fpr.push(curve.get(i));
+            roc.tpr.push(curve.get(n + i));
+        }
+        curve.delete();
+        
+        const calibrationOut = source.calibration_bands(10, warmup, probVec);
+        const K = calibrationOut.size() / 6;
+        const calibration = { titre: [], observed: [], count: [], mean: [], lower: [], upper: [] };
+        ['titre', 'observed', 'count', 'mean', 'lower', 'upper'].forEach((key, block) => {
+            for (let b = 0; b < K; b++) calibration[key].push(calibrationOut.get(block * K + b));
+        });
+        calibrationOut.delete();
+        probVec.delete();
+        return { allChainPosteriors, nativeDiagnostics, bands, summaries, roc, calibration };
+    }
+    
+    // Evenly spaced titre grid spanning the observed range
+    titreGrid(titreArray, nPoints = 100) {
+        const titreMin = Math.min(...titreArray);
+        const titreMax = Math.max(...titreArray);
+        return Array.from({length: nPoints}, (_, i) => 
+            titreMin + (titreMax - titreMin) * i / (nPoints - 1)
+        );
+    }
+    
+    // Fit every biomarker in one native call: the titre matrix and the shared
+    // outcome vector are copied in once, and all biomarker x chain jobs are
+    // stepped together on the worker pool. Returns per-biomarker results in
+    // the same shape as runEnsemble, plus the priors used.
+    async runPanel(biomarkerNames, infectedArray, chains, iter) {
+        const Module = this.mcmcModule;
+        const nSubjects = infectedArray.length;
+        const panel = new Module.BiomarkerPanel(biomarkerNames.length, nSubjects);
+        const titreMatrix = new Float64Array(biomarkerNames.length * nSubjects);
+        biomarkerNames.forEach((name, b) => titreMatrix.set(this.currentData[name], b * nSubjects));
+        panel.titre_view().set(titreMatrix);
+        panel.infected_view().set(infectedArray);
+        
+        // R package defaults; ec50 prior centred on each biomarker's titre range
+        const basePriors = {
+            floor_alpha: 1.0, floor_beta: 9.0,
+            ceiling_alpha: 9.0, ceiling_beta: 1.0,
+            ec50_mean: 0.0, ec50_sd: 1.0,
+            slope_mean: 0.0, slope_sd: 2.0
+        };
+        const engine = Module.simd_enabled() ? Module.ENGINE_MIXED : Module.ENGINE_SCALAR;
+        panel.prepare(chains, 10, basePriors, true, engine);
+        panel.set_ladder_policy({
+            adapt_until: Math.floor(iter / 2),
+            max_temperature: 10,
+            target_swap_rate: 0.5,
+            min_rungs: 3,
+            trim: true
+        });
+        panel.set_cold_move(Module.MOVE_NUTS, Math.floor(iter / 2));
+        panel.set_pointwise_loo(Math.floor(iter / 2));
+        if (this.stoppingRule) {
+            panel.set_stopping_rule(this.stoppingRule.rhat, this.stoppingRule.ess, 1000);
+        }
+        
+        const status = document.getElementById('fitting-status');
+        const chunk = Math.max(100, Math.floor(iter / 50));
+        while (panel.get_iteration() < iter && !panel.is_converged()) {
+            panel.run_chunk(Math.min(chunk, iter - panel.get_iteration()));
+            const pct = Math.round(100 * panel.get_iteration() / iter);
+            status.innerHTML = `<div class="spinner-small"></div><p>${biomarkerNames.length} biomarkers x ${chains} chains: ${panel.get_iteration()}/${iter} iterations (${pct}%)</p>`;
+            await new Promise(resolve => setTimeout(resolve, 0));
+        }
+        if (panel.is_converged()) {
+            this.log(`All biomarkers converged after ${panel.get_iteration()} iterations; stopping early`);
+        }
+        
+        // Same warmup as the stopping rule: never before adaptation has finished
+        const warmup = panel.get_warmup();
+        const readStart = performance.now();
+        const results = {};
+        biomarkerNames.forEach((name, b) => {
+            const source = {
+                export_draws: (w, thin) => panel.export_draws(b, w, thin),
+                get_draws_view: () => panel.get_draws_view(b),
+                compute_rhat: w => panel.compute_rhat(b, w),
+                compute_ess_bulk: w => panel.compute_ess_bulk(b, w),
+                compute_ess_tail: w => panel.compute_ess_tail(b, w),
+                get_swap_rates: () => panel.get_swap_rates(b),
+                get_loo: () => panel.get_loo(b),
+                roc_curve: () => panel.roc_curve(b),
+                get_auc: () => panel.get_auc(b),
+                calibration_bands: (bins, w, probs) => panel.calibration_bands(b, bins, w, probs),
+                curve_bands: (grid, w, probs) => panel.curve_bands(b, grid, w, probs),
+                summarize: (w, probs) => panel.summarize(b, w, probs)
+            };
+            results[name] = this.readNativeResults(source, chains, warmup, this.currentData[name]);
+            results[name].priors = panel.get_priors(b);
+        });
+        this.logRunStats('Panel: ', panel.get_stats(), (performance.now() - readStart) / 1000);
+        panel.delete();
+        return results;
+    }
+    
     async fitSingleBiomarker(useHierarchical, chains, iter) {
         this.log('Using parallel tempering MCMC for Bayesian inference...');
         
@@ -591,18 +979,11 @@ class SeroCOPApp {
         this.log(`Loaded ${titreArray.length} observations`);
         
         // Prepare data for MCMC
-        const titreVec = new this.mcmcModule.VectorDouble();
-        for (let i = 0; i < titreArray.length; i++) {
-            titreVec.push_back(titreArray[i]);
+        const mcmcData = this.createMCMCData(titreArray, infectedArray);
+        if (mcmcData.compressed) {
+            this.log(`Compressed to ${mcmcData.get_num_cells()} distinct titre cells`);
         }
         
-        const infectedVec = new this.mcmcModule.VectorInt();
-        for (let i = 0; i < infectedArray.length; i++) {
-            infectedVec.push_back(infectedArray[i]);
-        }
-        
-        const mcmcData = new this.mcmcModule.Data(titreVec, infectedVec);
-        
         // Calculate data-driven priors (matching R package defaults)
         const titreMidpoint = (Math.max(...titreArray) + Math.min(...titreArray)) / 2;
         const titreRange = Math.max(...titreArray) - Math.min(...titreArray);
@@ -627,37 +1008,9 @@ class SeroCOPApp {
         // Note: Each chain gets independent random initialization
         // MCMC is stochastic and will produce slightly different results each run
         
-        const allChainPosteriors = [];
-        
-        for (let chain = 0; chain < chains; chain++) {
-            this.log(`Running chain ${chain + 1}/${chains}: ${iter} iterations...`);
-            document.getElementById('fitting-status').innerHTML = 
-                `<div class="spinner-small"></div><p>Running chain ${chain + 1}/${chains}: ${iter} iterations...</p>`;
-            
-            const sampler = new this.mcmcModule.ParallelTemperingMCMC(10, mcmcData, priors);
-            sampler.run(iter);
-            
-            // Extract samples from this chain
-            const samples = sampler.get_samples();
-            const warmup = Math.floor(iter / 2);
-            
-            const chainPosteriors = {
-                floor: [],
-                ceiling: [],
-                ec50: [],
-                slope: []
-            };
-            
-            for (let i = warmup; i < samples.size(); i++) {
-                const s = samples.get(i);
-                chainPosteriors.floor.push(s.floor);
-                chainPosteriors.ceiling.push(s.ceiling);
-                chainPosteriors.ec50.push(s.ec50);
-                chainPosteriors.slope.push(s.slope);
-            }
-            
-            allChainPosteriors.push(chainPosteriors);
-        }
+        this.log(`Running ${chains} chains together: ${iter} iterations...`);
+        const { allChainPosteriors, nativeDiagnostics, bands, summaries, roc, calibration } =
+            await this.runEnsemble(mcmcData, priors, chains, iter, '', titreArray);
         
         const elapsed = (performance.now() - startTime) / 1000;
         this.log(`✓ All chains complete in ${elapsed.toFixed(1)}s`);
@@ -677,69 +1030,7 @@ class SeroCOPApp {
             posteriors.slope.push(...chain.slope);
         });
         
-        // Compute summaries
-        const computeMean = arr => arr.reduce((a, b) => a + b) / arr.length;
-        const computeSD = (arr, mean) => Math.sqrt(arr.reduce((a, b) => a + Math.pow(b - mean, 2), 0) / arr.length);
-        const computeQuantile = (arr, q) => {
-            const sorted = [...arr].sort((a, b) => a - b);
-            return sorted[Math.floor(sorted.length * q)];
-        };
-        
-        // Compute R-hat across chains
-        const computeRhat = (chainValues) => {
-            const n = chainValues[0].length;
-            const m = chainValues.length;
-            
-            // Within-chain variance
-            const chainMeans = chainValues.map(chain => 
-                chain.reduce((a, b) => a + b) / n
-            );
-            const chainVars = chainValues.map((chain, i) => 
-                chain.reduce((a, b) => a + Math.pow(b - chainMeans[i], 2), 0) / (n - 1)
-            );
-            const W = chainVars.reduce((a, b) => a + b) / m;
-            
-            // Between-chain variance
-            const grandMean = chainMeans.reduce((a, b) => a + b) / m;
-            const B = n * chainMeans.reduce((a, b) => a + Math.pow(b - grandMean, 2), 0) / (m - 1);
-            
-            // Pooled variance estimate
-            const varPlus = ((n - 1) * W + B) / n;
-            
-            return Math.sqrt(varPlus / W);
-        };
-        
-        // Compute ESS (simple autocorrelation-based)
-        const computeESS = (values) => {
-            const n = values.length;
-            const mean = values.reduce((a, b) => a + b) / n;
-            const variance = values.reduce((a, b) => a + Math.pow(b - mean, 2), 0) / n;
-            
-            // Lag-1 autocorrelation
-            let acf = 0;
-            for (let i = 1; i < n; i++) {
-                acf += (values[i] - mean) * (values[i-1] - mean);
-            }
-            acf = acf / ((n - 1) * variance);
-            
-            return n / (1 + 2 * Math.max(0, acf));
-        };
-        
-        const diagnostics = {
-            rhat: {
-                floor: computeRhat(allChainPosteriors.map(c => c.floor)),
-                ceiling: computeRhat(allChainPosteriors.map(c => c.ceiling)),
-                ec50: computeRhat(allChainPosteriors.map(c => c.ec50)),
-                slope: computeRhat(allChainPosteriors.map(c => c.slope))
-            },
-            ess: {
-                floor: computeESS(posteriors.floor),
-                ceiling: computeESS(posteriors.ceiling),
-                ec50: computeESS(posteriors.ec50),
-                slope: computeESS(posteriors.slope)
-            },
-            elapsed_seconds: elapsed
-        };
+        const diagnostics = { ...nativeDiagnostics, elapsed_seconds: elapsed };
         
         this.log(`Diagnostics: R-hat range [${Math.min(...Object.values(diagnostics.rhat)).toFixed(3)}, ${Math.max(...Object.values(diagnostics.rhat)).toFixed(3)}]`);
         this.log(`ESS range [${Math.floor(Math.min(...Object.values(diagnostics.ess)))}, ${Math.floor(Math.max(...Object.values(diagnostics.ess)))}]`);
@@ -750,36 +1041,14 @@ class SeroCOPApp {
             posteriors: posteriors,
             chains: allChainPosteriors,
             diagnostics: diagnostics,
+            bands: bands,
+            roc: roc,
+            calibration: calibration,
             data: {
                 titre: titreArray,
                 infected: infectedArray
             },
-            summaries: {
-                floor: {
-                    mean: computeMean(posteriors.floor),
-                    sd: computeSD(posteriors.floor, computeMean(posteriors.floor)),
-                    q025: computeQuantile(posteriors.floor, 0.025),
-                    q975: computeQuantile(posteriors.floor, 0.975)
-                },
-                ceiling: {
-                    mean: computeMean(posteriors.ceiling),
-                    sd: computeSD(posteriors.ceiling, computeMean(posteriors.ceiling)),
-                    q025: computeQuantile(posteriors.ceiling, 0.025),
-                    q975: computeQuantile(posteriors.ceiling, 0.975)
-                },
-                ec50: {
-                    mean: computeMean(posteriors.ec50),
-                    sd: computeSD(posteriors.ec50, computeMean(posteriors.ec50)),
-                    q025: computeQuantile(posteriors.ec50, 0.025),
-                    q975: computeQuantile(posteriors.ec50, 0.975)
-                },
-                slope: {
-                    mean: computeMean(posteriors.slope),
-                    sd: computeSD(posteriors.slope, computeMean(posteriors.slope)),
-                    q025: computeQuantile(posteriors.slope, 0.025),
-                    q975: computeQuantile(posteriors.slope, 0.975)
-                }
-            }
+            summaries: summaries
         };
     }
 
@@ -796,78 +1065,20 @@ class SeroCOPApp {
         const infectedArray = this.currentData.infected;
         const biomarkerModels = {};
         
-        // Fit each biomarker separately
+        // Fit the whole panel in one batched call
+        this.log(`Fitting ${biomarkerNames.length} biomarkers x ${chains} chains in one batch, ${iter} iterations...`);
+        const batchStart = performance.now();
+        const batched = await this.runPanel(biomarkerNames, infectedArray, chains, iter);
+        const elapsed = (performance.now() - batchStart) / 1000;
+        this.log(`✓ Panel complete in ${elapsed.toFixed(1)}s`);
+        
+        // Collect each biomarker's batched results
         for (let idx = 0; idx < biomarkerNames.length; idx++) {
             const biomarker = biomarkerNames[idx];
-            this.log(`\n[${idx + 1}/${biomarkerNames.length}] Fitting ${biomarker}...`);
+            this.log(`\n[${idx + 1}/${biomarkerNames.length}] Summarizing ${biomarker}...`);
             
             const titreArray = this.currentData[biomarker];
-            
-            // Prepare data for MCMC
-            const titreVec = new this.mcmcModule.VectorDouble();
-            for (let i = 0; i < titreArray.length; i++) {
-                titreVec.push_back(titreArray[i]);
-            }
-            
-            const infectedVec = new this.mcmcModule.VectorInt();
-            for (let i = 0; i < infectedArray.length; i++) {
-                infectedVec.push_back(infectedArray[i]);
-            }
-            
-            const mcmcData = new this.mcmcModule.Data(titreVec, infectedVec);
-            
-            // Calculate data-driven priors for this biomarker (matching R package)
-            const titreMidpoint = (Math.max(...titreArray) + Math.min(...titreArray)) / 2;
-            const titreRange = Math.max(...titreArray) - Math.min(...titreArray);
-            const titreSd = titreRange / 4;
-            
-            // Set priors to match R package defaults
-            const priors = {
-                floor_alpha: 1.0,      // Beta(1, 9) - weak prior favoring low floor
-                floor_beta: 9.0,
-                ceiling_alpha: 9.0,    // Beta(9, 1) - weak prior favoring high ceiling
-                ceiling_beta: 1.0,
-                ec50_mean: titreMidpoint,  // Data-driven
-                ec50_sd: titreSd,          // Data-driven
-                slope_mean: 0.0,       // Centered at 0
-                slope_sd: 2.0          // Weakly informative
-            };
-            
-            // Run multiple chains for this biomarker
-            const startTime = performance.now();
-            const allChainPosteriors = [];
-            
-            for (let chain = 0; chain < chains; chain++) {
-                this.log(`${biomarker} chain ${chain + 1}/${chains}: ${iter} iterations...`);
-                document.getElementById('fitting-status').innerHTML = 
-                    `<div class="spinner-small"></div><p>${biomarker} chain ${chain + 1}/${chains}: ${iter} iterations...</p>`;
-                
-                const sampler = new this.mcmcModule.ParallelTemperingMCMC(10, mcmcData, priors);
-                sampler.run(iter);
-                
-                const samples = sampler.get_samples();
-                const warmup = Math.floor(iter / 2);
-                
-                const chainPosteriors = {
-                    floor: [],
-                    ceiling: [],
-                    ec50: [],
-                    slope: []
-                };
-                
-                for (let i = warmup; i < samples.size(); i++) {
-                    const s = samples.get(i);
-                    chainPosteriors.floor.push(s.floor);
-                    chainPosteriors.ceiling.push(s.ceiling);
-                    chainPosteriors.ec50.push(s.ec50);
-                    chainPosteriors.slope.push(s.slope);
-                }
-                
-                allChainPosteriors.push(chainPosteriors);
-            }
-            
-            const elapsed = (performance.now() - startTime) / 1000;
-            this.log(`✓ ${biomarker} complete in ${elapsed.toFixed(1)}s`);
+            const { allChainPosteriors, nativeDiagnostics, bands, summaries, roc, calibration } = batched[biomarker];
             
             // Combine chains
             const posteriors = {
@@ -884,56 +1095,7 @@ class SeroCOPApp {
                 posteriors.slope.push(...chain.slope);
             });
             
-            // Compute summaries
-            const computeMean = arr => arr.reduce((a, b) => a + b) / arr.length;
-            const computeSD = (arr, mean) => Math.sqrt(arr.reduce((a, b) => a + Math.pow(b - mean, 2), 0) / arr.length);
-            const computeQuantile = (arr, q) => {
-                const sorted = [...arr].sort((a, b) => a - b);
-                return sorted[Math.floor(sorted.length * q)];
-            };
-            
-            // Compute R-hat across chains
-            const computeRhat = (chainValues) => {
-                const n = chainValues[0].length;
-                const m = chainValues.length;
-                const chainMeans = chainValues.map(chain => chain.reduce((a, b) => a + b) / n);
-                const chainVars = chainValues.map((chain, i) => 
-                    chain.reduce((a, b) => a + Math.pow(b - chainMeans[i], 2), 0) / (n - 1)
-                );
-                const W = chainVars.reduce((a, b) => a + b) / m;
-                const grandMean = chainMeans.reduce((a, b) => a + b) / m;
-                const B = n * chainMeans.reduce((a, b) => a + Math.pow(b - grandMean, 2), 0) / (m - 1);
-                const varPlus = ((n - 1) * W + B) / n;
-                return Math.sqrt(varPlus / W);
-            };
-            
-            const computeESS = (values) => {
-                const n = values.length;
-                const mean = values.reduce((a, b) => a + b) / n;
-                const variance = values.reduce((a, b) => a + Math.pow(b - mean, 2), 0) / n;
-                let acf = 0;
-                for (let i = 1; i < n; i++) {
-                    acf += (values[i] - mean) * (values[i-1] - mean);
-                }
-                acf = acf / ((n - 1) * variance);
-                return n / (1 + 2 * Math.max(0, acf));
-            };
-            
-            const diagnostics = {
-                rhat: {
-                    floor: computeRhat(allChainPosteriors.map(c => c.floor)),
-                    ceiling: computeRhat(allChainPosteriors.map(c => c.ceiling)),
-                    ec50: computeRhat(allChainPosteriors.map(c => c.ec50)),
-                    slope: computeRhat(allChainPosteriors.map(c => c.slope))
-                },
-                ess: {
-                    floor: computeESS(posteriors.floor),
-                    ceiling: computeESS(posteriors.ceiling),
-                    ec50: computeESS(posteriors.ec50),
-                    slope: computeESS(posteriors.slope)
-                },
-                elapsed_seconds: elapsed
-            };
+            const diagnostics = { ...nativeDiagnostics, elapsed_seconds: elapsed };
             
             this.log(`${biomarker} R-hat: [${Math.min(...Object.values(diagnostics.rhat)).toFixed(3)}, ${Math.max(...Object.values(diagnostics.rhat)).toFixed(3)}]`);
             this.log(`${biomarker} ESS: [${Math.floor(Math.min(...Object.values(diagnostics.ess)))}, ${Math.floor(Math.max(...Object.values(diagnostics.ess)))}]`);
@@ -944,36 +1106,14 @@ class SeroCOPApp {
                 posteriors: posteriors,
                 chains: allChainPosteriors,
                 diagnostics: diagnostics,
+                bands: bands,
+                roc: roc,
+                calibration: calibration,
                 data: {
                     titre: titreArray,
                     infected: infectedArray
                 },
-                summaries: {
-                    floor: {
-                        mean: computeMean(posteriors.floor),
-                        sd: computeSD(posteriors.floor, computeMean(posteriors.floor)),
-                        q025: computeQuantile(posteriors.floor, 0.025),
-                        q975: computeQuantile(posteriors.floor, 0.975)
-                    },
-                    ceiling: {
-                        mean: computeMean(posteriors.ceiling),
-                        sd: computeSD(posteriors.ceiling, computeMean(posteriors.ceiling)),
-                        q025: computeQuantile(posteriors.ceiling, 0.025),
-                        q975: computeQuantile(posteriors.ceiling, 0.975)
-                    },
-                    ec50: {
-                        mean: computeMean(posteriors.ec50),
-                        sd: computeSD(posteriors.ec50, computeMean(posteriors.ec50)),
-                        q025: computeQuantile(posteriors.ec50, 0.025),
-                        q975: computeQuantile(posteriors.ec50, 0.975)
-                    },
-                    slope: {
-                        mean: computeMean(posteriors.slope),
-                        sd: computeSD(posteriors.slope, computeMean(posteriors.slope)),
-                        q025: computeQuantile(posteriors.slope, 0.025),
-                        q975: computeQuantile(posteriors.slope, 0.975)
-                    }
-                }
+                summaries: summaries
             };
         }
         
@@ -1036,6 +1176,7 @@ class SeroCOPApp {
                 html += '</tbody></table>';
                 html += `<p><strong>Swap rate:</strong> ${(diagnostics.swap_rate * 100).toFixed(1)}%</p>`;
                 html += `<p><strong>Runtime:</strong> ${diagnostics.elapsed_seconds.toFixed(1)}s</p>`;
+                html += this.looHtml(diagnostics.loo);
             });
             
             metricsDiv.innerHTML = html;
@@ -1069,11 +1210,46 @@ class SeroCOPApp {
             html += '</tbody></table>';
             html += `<p><strong>Swap rate:</strong> ${(diagnostics.swap_rate * 100).toFixed(1)}%</p>`;
             html += `<p><strong>Runtime:</strong> ${diagnostics.elapsed_seconds.toFixed(1)}s</p>`;
+            html += this.looHtml(diagnostics.loo);
             
             metricsDiv.innerHTML = html;
         }
     }
     
+    // One-line profile of a native run from get_stats(): time per phase,
+    // including reading results back into JS, likelihood work and swap
+    // acceptance per adjacent rung pair (summed over replicas)
+    logRunStats(label, stats, readSeconds) {
+        const pairs = [];
+        for (let i = 0; i < stats.pair_attempts.size(); i++) {
+            const n = stats.pair_attempts.get(i);
+            pairs.push(n > 0 ? `${Math.round(100 * stats.pair_accepts.get(i) / n)}%` : '-');
+        }
+        stats.pair_attempts.delete();
+        stats.pair_accepts.delete();
+        if (!stats.enabled) return;
+        
+        const evals = stats.likelihood_evals + stats.gradient_evals;
+        const rate = stats.time_step > 0 ? evals / stats.time_step : 0;
+        this.log(`${label}Profile: step ${stats.time_step.toFixed(2)}s, swaps ${stats.time_swap.toFixed(3)}s, ` +
+                 `checks ${stats.time_check.toFixed(3)}s, export ${stats.time_export.toFixed(3)}s, ` +
+                 `read ${readSeconds.toFixed(3)}s; ${evals.toLocaleString()} likelihood evaluations ` +
+                 `(${(rate / 1e6).toFixed(2)}M/s), ${stats.prior_rejections.toLocaleString()} skipped by the prior; ` +
+                 `pair swap rates ${pairs.join(' ')}`);
+    }
+    
+    // ELPD-LOO, p_LOO and WAIC lines for a native fit (empty when not computed)
+    looHtml(loo) {
+        if (!loo) return '';
+        let html = `<p><strong>ELPD-LOO:</strong> ${loo.elpd_loo.toFixed(2)} (SE ${loo.se_elpd_loo.toFixed(2)}), ` +
+                   `<strong>p_LOO:</strong> ${loo.p_loo.toFixed(2)}</p>`;
+        html += `<p><strong>WAIC:</strong> ${loo.waic.toFixed(2)}, <strong>p_WAIC:</strong> ${loo.p_waic.toFixed(2)}</p>`;
+        if (loo.n_high_k > 0) {
+            html += `<p>⚠ ${loo.n_high_k} observation(s) with Pareto k &gt; 0.7 (max ${loo.max_pareto_k.toFixed(2)}); LOO estimate may be unreliable</p>`;
+        }
+        return html;
+    }
+    
     displayTracePlots() {
         const plotsDiv = document.getElementById('posterior-plots');
         plotsDiv.innerHTML = '<h3>Trace Plots</h3>';
@@ -1351,38 +1527,15 @@ class SeroCOPApp {
             biomarkerNames.forEach((biomarker, idx) => {
                 const model = this.model.biomarkers[biomarker];
                 const data = model.data;
-                const summaries = model.summaries;
-                
-                // Create prediction grid
-                const titreMin = Math.min(...data.titre);
-                const titreMax = Math.max(...data.titre);
-                const nPoints = 100;
-                const titreGrid = Array.from({length: nPoints}, (_, i) => 
-                    titreMin + (titreMax - titreMin) * i / (nPoints - 1)
-                );
-                
-                // Compute protection curve using posterior mean
-                const floor = summaries.floor.mean;
-                const ceiling = summaries.ceiling.mean;
-                const ec50 = summaries.ec50.mean;
-                const slope = summaries.slope.mean;
-                
-                const probProtection = titreGrid.map(t => {
-                    const sigmoid = 1 / (1 + Math.exp(slope * (t - ec50)));
-                    const pInfection = ceiling * (sigmoid * (1 - floor) + floor);
-                    return 1 - pInfection; // Protection probability
-                });
-                
-                const probRisk = titreGrid.map(t => {
-                    const sigmoid = 1 / (1 + Math.exp(slope * (t - ec50)));
-                    return ceiling * (sigmoid * (1 - floor) + floor); // Risk probability
-                });
+                const curve = this.curveFromModel(model);
                 
                 allData.push({
                     name: biomarker,
-                    titre: titreGrid,
-                    probProtection: probProtection,
-                    probRisk: probRisk,
+                    titre: curve.titre,
+                    probProtection: curve.probProtection,
+                    probRisk: curve.probRisk,
+                    bandRisk: curve.bandRisk,
+                    bandProtection: curve.bandProtection,
                     obsTitre: data.titre,
                     obsProtected: data.infected.map(x => 1 - x),
                     obsInfected: data.infected,
@@ -1395,40 +1548,54 @@ class SeroCOPApp {
         } else {
             // Single biomarker
             const data = this.model.data;
-            const summaries = this.model.summaries;
+            const curve = this.curveFromModel(this.model);
             
-            // Create prediction grid
-            const titreMin = Math.min(...data.titre);
-            const titreMax = Math.max(...data.titre);
-            const nPoints = 100;
-            const titreGrid = Array.from({length: nPoints}, (_, i) => 
-                titreMin + (titreMax - titreMin) * i / (nPoints - 1)
-            );
-            
-            // Compute protection curve using posterior mean
-            const floor = summaries.floor.mean;
-            const ceiling = summaries.ceiling.mean;
-            const ec50 = summaries.ec50.mean;
-            const slope = summaries.slope.mean;
-            
-            const probProtection = titreGrid.map(t => {
-                const sigmoid = 1 / (1 + Math.exp(slope * (t - ec50)));
-                const pInfection = ceiling * (sigmoid * (1 - floor) + floor);
-                return 1 - pInfection; // Protection probability
-            });
-            
-            const probRisk = titreGrid.map(t => {
-                const sigmoid = 1 / (1 + Math.exp(slope * (t - ec50)));
-                return ceiling * (sigmoid * (1 - floor) + floor); // Risk probability
-            });
-            
-            this.plotProtectionCurve(protectionCanvas, titreGrid, probProtection, data.titre, 
-                data.infected.map(x => 1 - x), 'Probability of Protection');
-            this.plotProtectionCurve(riskCanvas, titreGrid, probRisk, data.titre, 
-                data.infected, 'Probability of Infection');
+            this.plotProtectionCurve(protectionCanvas, curve.titre, curve.probProtection, data.titre, 
+                data.infected.map(x => 1 - x), 'Probability of Protection', curve.bandProtection);
+            this.plotProtectionCurve(riskCanvas, curve.titre, curve.probRisk, data.titre, 
+                data.infected, 'Probability of Infection', curve.bandRisk);
         }
     }
     
+    // Risk and protection curves of a fitted model. Native fits carry
+    // posterior-predictive means with 95% bands; otherwise the 4PL is
+    // evaluated at the posterior mean.
+    curveFromModel(model) {
+        if (model.bands) {
+            const b = model.bands;
+            return {
+                titre: b.titre,
+                probRisk: b.mean,
+                probProtection: b.mean.map(p => 1 - p),
+                bandRisk: { lower: b.lower, upper: b.upper },
+                bandProtection: { lower: b.upper.map(p => 1 - p), upper: b.lower.map(p => 1 - p) }
+            };
+        }
+        
+        // Create prediction grid
+        const titreGrid = this.titreGrid(model.data.titre);
+        
+        // Compute protection curve using posterior mean
+        const summaries = model.summaries;
+        const floor = summaries.floor.mean;
+        const ceiling = summaries.ceiling.mean;
+        const ec50 = summaries.ec50.mean;
+        const slope = summaries.slope.mean;
+        
+        const probRisk = titreGrid.map(t => {
+            const sigmoid = 1 / (1 + Math.exp(slope * (t - ec50)));
+            return ceiling * (sigmoid * (1 - floor) + floor); // Risk probability
+        });
+        
+        return {
+            titre: titreGrid,
+            probRisk: probRisk,
+            probProtection: probRisk.map(p => 1 - p), // Protection probability
+            bandRisk: null,
+            bandProtection: null
+        };
+    }
+    
     plotMultiProtectionCurve(canvas, allData, curveType = 'protection') {
         const ctx = canvas.getContext('2d');
         canvas.width = 600;
@@ -1465,6 +1632,16 @@ class SeroCOPApp {
             }
         });
         
+        // Draw 95% credible bands
+        allData.forEach(bioData => {
+            const band = curveType === 'protection' ? bioData.bandProtection : bioData.bandRisk;
+            if (band) {
+                ctx.globalAlpha = 0.12;
+                this.fillBand(ctx, bioData.titre, band, toX, toY, bioData.color);
+                ctx.globalAlpha = 1.0;
+            }
+        });
+        
         // Draw curves
         allData.forEach((bioData, idx) => {
             ctx.strokeStyle = bioData.color;
@@ -1533,7 +1710,7 @@ class SeroCOPApp {
         });
     }
     
-    plotProtectionCurve(canvas, titre, prob, obsTitre, obsData, yLabel = 'Probability of Protection') {
+    plotProtectionCurve(canvas, titre, prob, obsTitre, obsData, yLabel = 'Probability of Protection', band = null) {
         const ctx = canvas.getContext('2d');
         canvas.width = 550;
         canvas.height = 380;
@@ -1564,6 +1741,11 @@ class SeroCOPApp {
             ctx.fill();
         }
         
+        // Draw 95% credible band
+        if (band) {
+            this.fillBand(ctx, titre, band, toX, toY, 'rgba(0, 0, 0, 0.15)');
+        }
+        
         // Draw curve
         ctx.strokeStyle = '#000';
         ctx.lineWidth = 2;
@@ -1606,6 +1788,21 @@ class SeroCOPApp {
         ctx.fillText('1.0', padding - 5, padding);
     }
     
+    // Fill the region between band.lower and band.upper over the titre grid
+    fillBand(ctx, titre, band, toX, toY, fillStyle) {
+        ctx.fillStyle = fillStyle;
+        ctx.beginPath();
+        ctx.moveTo(toX(titre[0]), toY(band.upper[0]));
+        for (let i = 1; i < titre.length; i++) {
+            ctx.lineTo(toX(titre[i]), toY(band.upper[i]));
+        }
+        for (let i = titre.length - 1; i >= 0; i--) {
+            ctx.lineTo(toX(titre[i]), toY(band.lower[i]));
+        }
+        ctx.closePath();
+        ctx.fill();
+    }
+    
     displayROCCurve() {
         this.log('Generating ROC curve...');
         
@@ -1618,105 +1815,154 @@ class SeroCOPApp {
         if (this.model.type === 'multi') {
             // Multi-biomarker: compute ROC for each
             const biomarkerNames = Object.keys(this.model.biomarkers);
-            const allROC = [];
             const colors = ['#000000', '#555555', '#999999'];
-            
-            biomarkerNames.forEach((biomarker, idx) => {
-                const model = this.model.biomarkers[biomarker];
-                const data = model.data;
-                const summaries = model.summaries;
-                
-                // Compute predicted probabilities using posterior mean
-                const floor = summaries.floor.mean;
-                const ceiling = summaries.ceiling.mean;
-                const ec50 = summaries.ec50.mean;
-                const slope = summaries.slope.mean;
-                
-                const predictions = data.titre.map(t => {
-                    const sigmoid = 1 / (1 + Math.exp(slope * (t - ec50)));
-                    return ceiling * (sigmoid * (1 - floor) + floor);
-                });
-                
-                // Calculate ROC curve points
-                const thresholds = Array.from({length: 100}, (_, i) => i / 99);
-                const tpr = [];
-                const fpr = [];
-                
-                thresholds.forEach(threshold => {
-                    const predClass = predictions.map(p => p >= threshold ? 1 : 0);
-                    
-                    let tp = 0, fp = 0, tn = 0, fn = 0;
-                    for (let i = 0; i < predClass.length; i++) {
-                        if (predClass[i] === 1 && data.infected[i] === 1) tp++;
-                        else if (predClass[i] === 1 && data.infected[i] === 0) fp++;
-                        else if (predClass[i] === 0 && data.infected[i] === 0) tn++;
-                        else fn++;
-                    }
-                    
-                    tpr.push(tp + fn > 0 ? tp / (tp + fn) : 0);
-                    fpr.push(fp + tn > 0 ? fp / (fp + tn) : 0);
-                });
-                
-                // Calculate AUC
-                let auc = 0;
-                for (let i = 1; i < fpr.length; i++) {
-                    auc += (fpr[i] - fpr[i-1]) * (tpr[i] + tpr[i-1]) / 2;
-                }
-                
-                allROC.push({
-                    name: biomarker,
-                    fpr: fpr,
-                    tpr: tpr,
-                    auc: auc,
-                    color: colors[idx % colors.length]
-                });
-            });
+            const allROC = biomarkerNames.map((biomarker, idx) => ({
+                name: biomarker,
+                ...this.rocFromModel(this.model.biomarkers[biomarker]),
+                color: colors[idx % colors.length]
+            }));
             
             this.plotMultiROCCurve(canvas, allROC);
+            biomarkerNames.forEach(biomarker => {
+                this.appendCalibrationPlot(rocDiv, this.model.biomarkers[biomarker].calibration, `Calibration - ${biomarker}`);
+            });
         } else {
             // Single biomarker
-            const data = this.model.data;
-            const summaries = this.model.summaries;
-            
-            // Compute predicted probabilities using posterior mean
-            const floor = summaries.floor.mean;
-            const ceiling = summaries.ceiling.mean;
-            const ec50 = summaries.ec50.mean;
-            const slope = summaries.slope.mean;
-            
-            const predictions = data.titre.map(t => {
-                const sigmoid = 1 / (1 + Math.exp(slope * (t - ec50)));
-                return ceiling * (sigmoid * (1 - floor) + floor);
-            });
-            
-            // Calculate ROC curve points
-            const thresholds = Array.from({length: 100}, (_, i) => i / 99);
-            const tpr = [];
-            const fpr = [];
-            
-            thresholds.forEach(threshold => {
-                const predClass = predictions.map(p => p >= threshold ? 1 : 0);
-                
-                let tp = 0, fp = 0, tn = 0, fn = 0;
-                for (let i = 0; i < predClass.length; i++) {
-                    if (predClass[i] === 1 && data.infected[i] === 1) tp++;
-                    else if (predClass[i] === 1 && data.infected[i] === 0) fp++;
-                    else if (predClass[i] === 0 && data.infected[i] === 0) tn++;
-                    else fn++;
-                }
-                
-                tpr.push(tp + fn > 0 ? tp / (tp + fn) : 0);
-                fpr.push(fp + tn > 0 ? fp / (fp + tn) : 0);
-            });
+            const { fpr, tpr, auc } = this.rocFromModel(this.model);
+            this.plotROCCurve(canvas, fpr, tpr, auc);
+            this.appendCalibrationPlot(rocDiv, this.model.calibration, 'Calibration');
+        }
+    }
+    
+    // ROC points and AUC of a fitted model: exact from the native titre index
+    // when available, otherwise thresholding the posterior-mean curve
+    rocFromModel(model) {
+        if (model.roc) return model.roc;
+        
+        const data = model.data;
+        const summaries = model.summaries;
+        
+        // Compute predicted probabilities using posterior mean
+        const floor = summaries.floor.mean;
+        const ceiling = summaries.ceiling.mean;
+        const ec50 = summaries.ec50.mean;
+        const slope = summaries.slope.mean;
+        
+        const predictions = data.titre.map(t => {
+            const sigmoid = 1 / (1 + Math.exp(slope * (t - ec50)));
+            return ceiling * (sigmoid * (1 - floor) + floor);
+        });
+        
+        // Calculate ROC curve points
+        const thresholds = Array.from({length: 100}, (_, i) => i / 99);
+        const tpr = [];
+        const fpr = [];
+        
+        thresholds.forEach(threshold => {
+            const predClass = predictions.map(p => p >= threshold ? 1 : 0);
             
-            // Calculate AUC using trapezoidal rule
-            let auc = 0;
-            for (let i = 1; i < fpr.length; i++) {
-                auc += (fpr[i] - fpr[i-1]) * (tpr[i] + tpr[i-1]) / 2;
+            let tp = 0, fp = 0, tn = 0, fn = 0;
+            for (let i = 0; i < predClass.length; i++) {
+                if (predClass[i] === 1 && data.infected[i] === 1) tp++;
+                else if (predClass[i] === 1 && data.infected[i] === 0) fp++;
+                else if (predClass[i] === 0 && data.infected[i] === 0) tn++;
+                else fn++;
             }
             
-            this.plotROCCurve(canvas, fpr, tpr, auc);
+            tpr.push(tp + fn > 0 ? tp / (tp + fn) : 0);
+            fpr.push(fp + tn > 0 ? fp / (fp + tn) : 0);
+        });
+        
+        // Calculate AUC using trapezoidal rule
+        let auc = 0;
+        for (let i = 1; i < fpr.length; i++) {
+            auc += (fpr[i] - fpr[i-1]) * (tpr[i] + tpr[i-1]) / 2;
         }
+        
+        return { fpr, tpr, auc };
+    }
+    
+    appendCalibrationPlot(container, calibration, title) {
+        if (!calibration || calibration.titre.length === 0) return;
+        const canvas = document.createElement('canvas');
+        canvas.className = 'calibration-plot';
+        container.appendChild(canvas);
+        this.plotCalibration(canvas, calibration, title);
+    }
+    
+    // Observed infection rate per titre bin (points, sized by count) against
+    // the posterior-predicted rate (line with 95% band)
+    plotCalibration(canvas, calibration, title) {
+        const ctx = canvas.getContext('2d');
+        canvas.width = 500;
+        canvas.height = 350;
+        
+        const padding = 60;
+        const width = canvas.width - 2 * padding;
+        const height = canvas.height - 2 * padding;
+        
+        ctx.fillStyle = 'white';
+        ctx.fillRect(0, 0, canvas.width, canvas.height);
+        
+        const titre = calibration.titre;
+        const titreMin = Math.min(...titre);
+        const titreMax = Math.max(...titre);
+        const titreRange = Math.max(titreMax - titreMin, 1e-9);
+        const toX = (t) => padding + (t - titreMin) / titreRange * width;
+        const toY = (p) => padding + height - p * height;
+        
+        // Predicted band and mean
+        this.fillBand(ctx, titre, calibration, toX, toY, 'rgba(0, 0, 0, 0.12)');
+        ctx.strokeStyle = '#000';
+        ctx.lineWidth = 2;
+        ctx.beginPath();
+        titre.forEach((t, b) => {
+            if (b === 0) ctx.moveTo(toX(t), toY(calibration.mean[b]));
+            else ctx.lineTo(toX(t), toY(calibration.mean[b]));
+        });
+        ctx.stroke();
+        
+        // Observed rates
+        const maxCount = Math.max(...calibration.count);
+        ctx.fillStyle = '#666';
+        titre.forEach((t, b) => {
+            const r = 3 + 4 * Math.sqrt(calibration.count[b] / maxCount);
+            ctx.beginPath();
+            ctx.arc(toX(t), toY(calibration.observed[b]), r, 0, 2 * Math.PI);
+            ctx.fill();
+        });
+        
+        // Axes
+        ctx.strokeStyle = '#333';
+        ctx.lineWidth = 1;
+        ctx.beginPath();
+        ctx.moveTo(padding, padding);
+        ctx.lineTo(padding, padding + height);
+        ctx.lineTo(padding + width, padding + height);
+        ctx.stroke();
+        
+        // Labels
+        ctx.fillStyle = '#000';
+        ctx.font = '16px Avenir, sans-serif';
+        ctx.textAlign = 'center';
+        ctx.fillText(title, canvas.width / 2, 30);
+        
+        ctx.font = '14px Avenir, sans-serif';
+        ctx.fillText('Titre (bin mean)', canvas.width / 2, canvas.height - 10);
+        
+        ctx.save();
+        ctx.translate(15, canvas.height / 2);
+        ctx.rotate(-Math.PI / 2);
+        ctx.fillText('P(infection)', 0, 0);
+        ctx.restore();
+        
+        ctx.font = '11px Avenir, sans-serif';
+        ctx.textAlign = 'center';
+        ctx.fillText(titreMin.toFixed(1), padding, canvas.height - 30);
+        ctx.fillText(titreMax.toFixed(1), padding + width, canvas.height - 30);
+        ctx.textAlign = 'right';
+        ctx.fillText('0.0', padding - 5, padding + height);
+        ctx.fillText('1.0', padding - 5, padding);
     }
     
     plotMultiROCCurve(canvas, allROC) {
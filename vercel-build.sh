@@ -1,5 +1,17 @@
 #!/bin/bash
-# Vercel build script - replaces __API_URL__ with environment variable
+# Vercel build script - builds the WebAssembly modules and replaces
+# __API_URL__ with environment variable
+set -e
+
+# Same Emscripten release as .github/workflows/deploy.yml
+EMSDK_VERSION=3.1.74
+if ! command -v em++ &> /dev/null; then
+  git clone --depth 1 https://github.com/emscripten-core/emsdk.git /tmp/emsdk
+  /tmp/emsdk/emsdk install "$EMSDK_VERSION"
+  /tmp/emsdk/emsdk activate "$EMSDK_VERSION"
+  source /tmp/emsdk/emsdk_env.sh
+fi
+make -C wasm site
 
 # Replace placeholder with actual API URL from environment
 if [ -n "$API_URL" ]; then
@@ -0,0 +1,171 @@
+/*
+ * Native throughput benchmark for the parallel tempering sampler.
+ *
+ * Reports likelihood evaluations/sec, sampler iterations/sec and minimum
+ * bulk ESS/sec over cohort sizes, rung counts and engine variants:
+ *   - scalar:   ENGINE_SCALAR, one thread
+ *   - simd:     ENGINE_SIMD, one thread
+ *   - mixed:    ENGINE_MIXED, one thread; lik_evals/s is the float kernel
+ *               used on heated rungs
+ *   - threaded: ENGINE_SIMD on the worker pool (builds with MCMC_THREADS)
+ * Data and chains use fixed seeds, so runs on one machine are comparable
+ * from build to build. Build and run with `make bench`.
+ *
+ * Usage: bench_mcmc [--quick] [--iter N] [--replicas R] [--threads T]
+ */
+
+#include "parallel_tempering_mcmc.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Synthetic cohort from a known 4PL: titres ~ N(2, 1.5) at assay
+// resolution 0.01, so compression leaves most subjects in their own cell
+Data make_cohort(int n, uint64_t seed) {
+    RngStream stream(seed);
+    const Params truth(0.05, 0.7, 2.0, 1.5);
+    std::vector<double> titre(n);
+    std::vector<int> infected(n);
+    for (int i = 0; i < n; ++i) {
+        titre[i] = std::round((2.0 + 1.5 * stream.normal()) * 100.0) / 100.0;
+        infected[i] = stream.uniform() < prob_infection(truth, titre[i]) ? 1 : 0;
+    }
+    Data data;
+    data.assign(titre.data(), infected.data(), n);
+    data.compress();
+    return data;
+}
+
+// Heated-rung likelihood evaluations per second (the cold-rung kernel for
+// every engine but ENGINE_MIXED) at parameters that vary per call, so the
+// compiler cannot hoist the evaluation out of the loop
+double likelihood_rate(const Data& data, double min_seconds) {
+    Params p(0.05, 0.7, 2.0, 1.5);
+    volatile double sink = 0.0;
+    long evals = 0;
+    auto start = Clock::now();
+    double elapsed = 0.0;
+    while (elapsed < min_seconds) {
+        for (int k = 0; k < 256; ++k) {
+            p.ec50 = 2.0 + 1e-4 * (k - 128);
+            sink = sink + log_likelihood_heated(p, data);
+        }
+        evals += 256;
+        elapsed = seconds_since(start);
+    }
+    return evals / elapsed;
+}
+
+struct Variant {
+    const char* name;
+    int engine;
+    int threads;
+};
+
+struct Options {
+    bool quick;
+    int iterations;
+    int replicas;
+    int threads;
+
+    Options() : quick(false), iterations(4000), replicas(4), threads(0) {}
+};
+
+Options parse_options(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--quick")) {
+            opt.quick = true;
+            opt.iterations = 1000;
+        } else if (!std::strcmp(argv[i], "--iter") && i + 1 < argc) {
+            opt.iterations = std::max(100, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--replicas") && i + 1 < argc) {
+            opt.replicas = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) {
+            opt.threads = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::fprintf(stderr, "usage: %s [--quick] [--iter N] [--replicas R] [--threads T]\n", argv[0]);
+            std::exit(2);
+        }
+    }
+    return opt;
+}
+
+// The app's defaults (SeroCOP::get_default_priors), ec50 centred on the data
+Priors default_priors(const Data& data) {
+    Priors p;
+    p.floor_alpha = 1.0;
+    p.floor_beta = 9.0;
+    p.ceiling_alpha = 9.0;
+    p.ceiling_beta = 1.0;
+    auto range = std::minmax_element(data.titre.begin(), data.titre.end());
+    p.ec50_mean = 0.5 * (*range.first + *range.second);
+    p.ec50_sd = std::max(1e-3, (*range.second - *range.first) / 4.0);
+    p.slope_mean = 0.0;
+    p.slope_sd = 2.0;
+    return p;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const Options opt = parse_options(argc, argv);
+    const int hw_threads = opt.threads > 0 ? opt.threads : get_num_threads();
+
+    std::vector<Variant> variants = {
+        {"scalar", ENGINE_SCALAR, 1},
+        {"simd", ENGINE_SIMD, 1},
+        {"mixed", ENGINE_MIXED, 1},
+    };
+    if (MCMC_HAVE_THREADS && hw_threads > 1) variants.push_back({"threaded", ENGINE_SIMD, hw_threads});
+
+    const std::vector<int> cohorts = opt.quick ? std::vector<int>{200, 2000} : std::vector<int>{200, 1000, 5000, 20000};
+    const std::vector<int> rungs = opt.quick ? std::vector<int>{4} : std::vector<int>{4, 10};
+    const int warmup = opt.iterations / 2;
+
+    std::printf("# simd_enabled=%d threads=%d replicas=%d iterations=%d\n",
+                simd_enabled() ? 1 : 0, hw_threads, opt.replicas, opt.iterations);
+    std::printf("%-9s %7s %6s %5s %14s %10s %10s %9s\n",
+                "variant", "N", "cells", "rungs", "lik_evals/s", "iter/s", "ess/s", "min_ess");
+
+    for (int n : cohorts) {
+        Data base = make_cohort(n, 20240601u + n);
+        for (const Variant& v : variants) {
+            Data data = base;
+            data.set_engine(v.engine);
+            set_num_threads(v.threads);
+            double lik_rate = likelihood_rate(data, opt.quick ? 0.1 : 0.3);
+
+            for (int r : rungs) {
+                set_random_seed(12345);
+                ParallelTemperingEnsemble ensemble(opt.replicas, r, data, default_priors(data));
+                LadderPolicy ladder;
+                ladder.adapt_until = warmup;
+                ensemble.set_ladder_policy(ladder);
+
+                auto start = Clock::now();
+                ensemble.run(opt.iterations);
+                double elapsed = seconds_since(start);
+
+                std::vector<double> ess = ensemble.compute_ess_bulk(warmup);
+                double min_ess = *std::min_element(ess.begin(), ess.end());
+                std::printf("%-9s %7d %6d %5d %14.0f %10.1f %10.1f %9.0f\n",
+                            v.name, n, data.get_num_cells(), r, lik_rate,
+                            opt.iterations / elapsed, min_ess / elapsed, min_ess);
+                std::fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
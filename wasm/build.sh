@@ -24,13 +24,13 @@ em++ --version
 echo ""
 echo "Compiling C++ to WebAssembly..."
 make clean
-make
+make site
 
 echo ""
 echo "=== Build Complete ==="
 echo "Output files:"
-ls -lh parallel_tempering_mcmc.js parallel_tempering_mcmc.wasm
+ls -lh parallel_tempering_mcmc*.js parallel_tempering_mcmc*.wasm
 
 echo ""
-echo "To use in your web application, include:"
-echo "  <script src='wasm/parallel_tempering_mcmc.js'></script>"
+echo "Copied the baseline, SIMD and threaded builds next to index.html;"
+echo "app.js picks the fastest one the browser supports."
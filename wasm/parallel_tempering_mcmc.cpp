@@ -1,429 +1,193 @@
 /*
- * Parallel Tempering MCMC for 4-Parameter Logistic Model
- * 
- * Implements Bayesian inference for correlates of protection analysis
- * Model: P(infection) = ceiling * (sigmoid(-slope*(titre-ec50)) * (1-floor) + floor)
- * 
- * Parameters:
- *   - floor: [0,1] proportion of max risk at high titre (Beta prior)
- *   - ceiling: [0,1] max infection probability at low titre (Beta prior)
- *   - ec50: inflection point titre (Normal prior)
- *   - slope: [0,∞) steepness of curve (truncated Normal prior)
- *
- * Algorithm: Parallel Tempering with 15 temperature ladders
- * - Samples from tempered distributions: p(θ|data)^(1/T)
- * - Proposes swaps between adjacent chains
- * - Provides improved mixing for multimodal posteriors
+ * JavaScript bindings for the parallel tempering sampler
+ * (parallel_tempering_mcmc.h). Built with em++ by the Makefile.
  */
 
-#include <vector>
-#include <cmath>
-#include <random>
-#include <algorithm>
-#include <numeric>
+#include "parallel_tempering_mcmc.h"
 #include <emscripten/bind.h>
+#include <string>
 
 using namespace emscripten;
 
-// Random number generator
-std::mt19937 rng(std::random_device{}());
-
-// Function to reseed the RNG (called from JavaScript)
-void set_random_seed(unsigned int seed) {
-    rng.seed(seed);
-}
-
-// Sigmoid function
-inline double sigmoid(double x) {
-    return 1.0 / (1.0 + std::exp(-x));
-}
-
-// Log-density for Beta distribution
-inline double log_beta_pdf(double x, double alpha, double beta) {
-    if (x <= 0.0 || x >= 1.0) return -INFINITY;
-    return (alpha - 1.0) * std::log(x) + (beta - 1.0) * std::log(1.0 - x);
-}
-
-// Log-density for Normal distribution
-inline double log_normal_pdf(double x, double mean, double sd) {
-    double z = (x - mean) / sd;
-    return -0.5 * z * z - std::log(sd) - 0.5 * std::log(2.0 * M_PI);
-}
-
-// Log-density for truncated Normal (lower bound = 0)
-inline double log_truncated_normal_pdf(double x, double mean, double sd) {
-    if (x <= 0.0) return -INFINITY;
-    double z = (x - mean) / sd;
-    double log_normalization = std::log(1.0 - 0.5 * std::erfc(-mean / (sd * std::sqrt(2.0))));
-    return -0.5 * z * z - std::log(sd) - 0.5 * std::log(2.0 * M_PI) - log_normalization;
-}
-
-// Log-density for Bernoulli likelihood
-inline double log_bernoulli_pmf(int y, double p) {
-    if (p <= 0.0 || p >= 1.0) return -INFINITY;
-    return y == 1 ? std::log(p) : std::log(1.0 - p);
-}
-
-// Model parameters structure
-struct Params {
-    double floor;
-    double ceiling;
-    double ec50;
-    double slope;
-    
-    Params() : floor(0.5), ceiling(0.5), ec50(0.0), slope(1.0) {}
-    Params(double f, double c, double e, double s) : floor(f), ceiling(c), ec50(e), slope(s) {}
-};
-
-// Prior hyperparameters
-struct Priors {
-    double floor_alpha, floor_beta;
-    double ceiling_alpha, ceiling_beta;
-    double ec50_mean, ec50_sd;
-    double slope_mean, slope_sd;
-    
-    Priors() : floor_alpha(1.0), floor_beta(1.0), 
-               ceiling_alpha(1.0), ceiling_beta(1.0),
-               ec50_mean(0.0), ec50_sd(1.0),
-               slope_mean(1.0), slope_sd(1.0) {}
-};
-
-// Dataset
-struct Data {
-    std::vector<double> titre;
-    std::vector<int> infected;
-    int N;
-    
-    Data() : N(0) {}
-    Data(const std::vector<double>& t, const std::vector<int>& i) 
-        : titre(t), infected(i), N(t.size()) {}
-};
-
-// Compute log-prior density
-double log_prior(const Params& p, const Priors& priors) {
-    double lp = 0.0;
-    lp += log_beta_pdf(p.floor, priors.floor_alpha, priors.floor_beta);
-    lp += log_beta_pdf(p.ceiling, priors.ceiling_alpha, priors.ceiling_beta);
-    lp += log_normal_pdf(p.ec50, priors.ec50_mean, priors.ec50_sd);
-    lp += log_truncated_normal_pdf(p.slope, priors.slope_mean, priors.slope_sd);
-    return lp;
-}
-
-// Compute log-likelihood
-double log_likelihood(const Params& p, const Data& data) {
-    double ll = 0.0;
-    for (int i = 0; i < data.N; ++i) {
-        double prob_infection = p.ceiling * (sigmoid(-p.slope * (data.titre[i] - p.ec50)) * (1.0 - p.floor) + p.floor);
-        ll += log_bernoulli_pmf(data.infected[i], prob_infection);
-        if (!std::isfinite(ll)) return -INFINITY;
+// Progress callback from JS: fn(iteration), called every `every` iterations
+template <typename Sampler>
+void set_progress_callback(Sampler& sampler, val fn, int every) {
+    sampler.control.progress_every = std::max(1, every);
+    if (fn.isUndefined() || fn.isNull()) {
+        sampler.control.progress = nullptr;
+    } else {
+        sampler.control.progress = [fn](int iteration) { fn(iteration); };
     }
-    return ll;
-}
-
-// Compute tempered log-posterior
-double log_posterior_tempered(const Params& p, const Data& data, const Priors& priors, double temperature) {
-    double lp = log_prior(p, priors);
-    if (!std::isfinite(lp)) return -INFINITY;
-    double ll = log_likelihood(p, data);
-    if (!std::isfinite(ll)) return -INFINITY;
-    return lp + ll / temperature;
 }
 
-// Proposal distribution: Adaptive Gaussian random walk
-class ProposalDistribution {
-private:
-    std::vector<double> step_sizes;
-    std::normal_distribution<double> normal_dist;
-    std::uniform_real_distribution<double> uniform_dist;
-    
-public:
-    ProposalDistribution() : step_sizes(4, 0.1), normal_dist(0.0, 1.0), uniform_dist(0.0, 1.0) {}
-    
-    void adapt(int iteration, double acceptance_rate) {
-        // Adaptive scaling: target acceptance rate ~0.234 for 4D
-        double target = 0.234;
-        double scale = acceptance_rate > target ? 1.01 : 0.99;
-        if (iteration % 50 == 0) {
-            for (auto& s : step_sizes) {
-                s *= scale;
-                s = std::max(0.001, std::min(s, 1.0)); // Keep reasonable bounds
-            }
-        }
-    }
-    
-    Params propose(const Params& current) {
-        Params proposed;
-        
-        // Floor: Beta proposal with reflection at boundaries
-        double floor_prop = current.floor + step_sizes[0] * normal_dist(rng);
-        while (floor_prop <= 0.0 || floor_prop >= 1.0) {
-            if (floor_prop <= 0.0) floor_prop = -floor_prop;
-            if (floor_prop >= 1.0) floor_prop = 2.0 - floor_prop;
-        }
-        proposed.floor = floor_prop;
-        
-        // Ceiling: Beta proposal with reflection
-        double ceiling_prop = current.ceiling + step_sizes[1] * normal_dist(rng);
-        while (ceiling_prop <= 0.0 || ceiling_prop >= 1.0) {
-            if (ceiling_prop <= 0.0) ceiling_prop = -ceiling_prop;
-            if (ceiling_prop >= 1.0) ceiling_prop = 2.0 - ceiling_prop;
-        }
-        proposed.ceiling = ceiling_prop;
-        
-        // EC50: Normal proposal (unbounded)
-        proposed.ec50 = current.ec50 + step_sizes[2] * normal_dist(rng);
-        
-        // Slope: Truncated normal proposal with reflection at 0
-        double slope_prop = current.slope + step_sizes[3] * normal_dist(rng);
-        while (slope_prop <= 0.0) {
-            slope_prop = -slope_prop; // Reflect at zero
-        }
-        proposed.slope = slope_prop;
-        
-        return proposed;
-    }
-};
-
-// Single MCMC chain at given temperature
-class MCMCChain {
-private:
-    Params current;
-    double current_log_posterior;
-    double temperature;
-    ProposalDistribution proposal;
-    std::uniform_real_distribution<double> uniform;
-    int accepted;
-    int total;
-    
-public:
-    std::vector<Params> samples;
-    
-    MCMCChain(double temp, const Params& init, const Data& data, const Priors& priors)
-        : current(init), temperature(temp), uniform(0.0, 1.0), accepted(0), total(0) {
-        current_log_posterior = log_posterior_tempered(current, data, priors, temperature);
-        samples.reserve(10000);
-    }
-    
-    void step(const Data& data, const Priors& priors) {
-        // Propose new state
-        Params proposed = proposal.propose(current);
-        double proposed_log_posterior = log_posterior_tempered(proposed, data, priors, temperature);
-        
-        // Metropolis-Hastings acceptance
-        double log_alpha = proposed_log_posterior - current_log_posterior;
-        total++;
-        
-        if (std::log(uniform(rng)) < log_alpha) {
-            current = proposed;
-            current_log_posterior = proposed_log_posterior;
-            accepted++;
-        }
-        
-        // Store sample (every chain stores, but we'll use only cold chain)
-        samples.push_back(current);
-        
-        // Adapt proposal
-        if (total % 50 == 0) {
-            double acceptance_rate = static_cast<double>(accepted) / total;
-            proposal.adapt(total, acceptance_rate);
-        }
-    }
-    
-    double get_log_posterior() const { return current_log_posterior; }
-    Params get_current() const { return current; }
-    void set_current(const Params& p, const Data& data, const Priors& priors) {
-        current = p;
-        current_log_posterior = log_posterior_tempered(current, data, priors, temperature);
-    }
-    double get_acceptance_rate() const {
-        return total > 0 ? static_cast<double>(accepted) / total : 0.0;
-    }
-};
-
-// Parallel Tempering MCMC Engine
-class ParallelTemperingMCMC {
-private:
-    std::vector<MCMCChain> chains;
-    std::vector<double> temperatures;
-    Data data;
-    Priors priors;
-    int num_chains;
-    int swap_accepted;
-    int swap_total;
-    std::uniform_real_distribution<double> uniform;
-    
-public:
-    ParallelTemperingMCMC(int n_chains, const Data& d, const Priors& p)
-        : data(d), priors(p), num_chains(n_chains), swap_accepted(0), swap_total(0), uniform(0.0, 1.0) {
-        
-        // Set up temperature ladder: geometric spacing
-        temperatures.resize(num_chains);
-        double max_temp = 10.0; // Hottest chain
-        for (int i = 0; i < num_chains; ++i) {
-            temperatures[i] = std::pow(max_temp, static_cast<double>(i) / (num_chains - 1));
-        }
-        
-        // Initialize chains with random starting points
-        std::uniform_real_distribution<double> init_floor(0.01, 0.5);
-        std::uniform_real_distribution<double> init_ceiling(0.1, 0.9);
-        std::uniform_real_distribution<double> init_ec50(-2.0, 2.0);
-        std::uniform_real_distribution<double> init_slope(0.1, 3.0);
-        
-        for (int i = 0; i < num_chains; ++i) {
-            Params init(init_floor(rng), init_ceiling(rng), init_ec50(rng), init_slope(rng));
-            chains.emplace_back(temperatures[i], init, data, priors);
-        }
-    }
-    
-    void run(int n_iterations) {
-        for (int iter = 0; iter < n_iterations; ++iter) {
-            // Update all chains
-            for (auto& chain : chains) {
-                chain.step(data, priors);
-            }
-            
-            // Attempt swaps every 10 iterations
-            if (iter % 10 == 0 && num_chains > 1) {
-                // Randomly select adjacent pair to swap
-                std::uniform_int_distribution<int> pair_dist(0, num_chains - 2);
-                int i = pair_dist(rng);
-                int j = i + 1;
-                
-                // Compute swap probability
-                double log_alpha = (chains[i].get_log_posterior() - chains[j].get_log_posterior()) *
-                                   (1.0 / temperatures[j] - 1.0 / temperatures[i]);
-                
-                swap_total++;
-                if (std::log(uniform(rng)) < log_alpha) {
-                    // Swap states
-                    Params temp_params = chains[i].get_current();
-                    chains[i].set_current(chains[j].get_current(), data, priors);
-                    chains[j].set_current(temp_params, data, priors);
-                    swap_accepted++;
-                }
-            }
-        }
-    }
-    
-    // Get samples from cold chain (temperature = 1)
-    std::vector<Params> get_samples() const {
-        return chains[0].samples;
-    }
+// Sampler classes for one curve model, registered under the 4PL class name
+// plus suffix (e.g. ParallelTemperingEnsemble2PL)
+template <class Model>
+void bind_samplers(const char* suffix) {
+    typedef ParallelTemperingMCMCT<Model> S;
+    typedef ParallelTemperingEnsembleT<Model> E;
+    typedef BiomarkerPanelT<Model> P;
+    typedef SimulationStudyT<Model> T;
     
-    // Convergence diagnostics: R-hat (Gelman-Rubin statistic)
-    std::vector<double> compute_rhat(int warmup) const {
-        // Use multiple chains at same temperature for R-hat
-        // For simplicity, use cold chain split into 2 halves
-        const auto& samples = chains[0].samples;
-        int n = samples.size() - warmup;
-        if (n < 100) return {1.0, 1.0, 1.0, 1.0}; // Not enough samples
-        
-        int half = n / 2;
-        std::vector<double> chain1_floor, chain1_ceiling, chain1_ec50, chain1_slope;
-        std::vector<double> chain2_floor, chain2_ceiling, chain2_ec50, chain2_slope;
-        
-        for (int i = warmup; i < warmup + half; ++i) {
-            chain1_floor.push_back(samples[i].floor);
-            chain1_ceiling.push_back(samples[i].ceiling);
-            chain1_ec50.push_back(samples[i].ec50);
-            chain1_slope.push_back(samples[i].slope);
-        }
-        
-        for (int i = warmup + half; i < samples.size(); ++i) {
-            chain2_floor.push_back(samples[i].floor);
-            chain2_ceiling.push_back(samples[i].ceiling);
-            chain2_ec50.push_back(samples[i].ec50);
-            chain2_slope.push_back(samples[i].slope);
-        }
-        
-        auto compute_rhat_param = [](const std::vector<double>& c1, const std::vector<double>& c2) {
-            double mean1 = std::accumulate(c1.begin(), c1.end(), 0.0) / c1.size();
-            double mean2 = std::accumulate(c2.begin(), c2.end(), 0.0) / c2.size();
-            double overall_mean = (mean1 + mean2) / 2.0;
-            
-            auto compute_var = [](const std::vector<double>& v, double m) {
-                double sum = 0.0;
-                for (double x : v) sum += (x - m) * (x - m);
-                return sum / (v.size() - 1);
-            };
-            
-            double var1 = compute_var(c1, mean1);
-            double var2 = compute_var(c2, mean2);
-            double W = (var1 + var2) / 2.0; // Within-chain variance
-            
-            double B = c1.size() * ((mean1 - overall_mean) * (mean1 - overall_mean) +
-                                     (mean2 - overall_mean) * (mean2 - overall_mean)); // Between-chain variance
-            
-            double var_plus = ((c1.size() - 1.0) / c1.size()) * W + (1.0 / c1.size()) * B;
-            return std::sqrt(var_plus / W);
-        };
-        
-        return {
-            compute_rhat_param(chain1_floor, chain2_floor),
-            compute_rhat_param(chain1_ceiling, chain2_ceiling),
-            compute_rhat_param(chain1_ec50, chain2_ec50),
-            compute_rhat_param(chain1_slope, chain2_slope)
-        };
-    }
+    class_<S>((std::string("ParallelTemperingMCMC") + suffix).c_str())
+        .template constructor<int, const Data&, const Priors&>()
+        .template constructor<>()
+        .function("run", &S::run)
+        .function("run_chunk", &S::run_chunk)
+        .function("get_iteration", &S::get_iteration)
+        .function("is_converged", &S::is_converged)
+        .function("get_warmup", &S::get_warmup)
+        .function("set_stopping_rule", &S::set_stopping_rule)
+        .function("set_progress_callback", &set_progress_callback<S>)
+        .function("get_samples", &S::get_samples)
+        .function("curve_bands", &S::curve_bands)
+        .function("summarize", &S::summarize)
+        .function("warm_start", &S::warm_start)
+        .function("reweight_priors", &S::reweight_priors)
+        .function("summarize_reweighted", &S::summarize_reweighted)
+        .function("curve_bands_reweighted", &S::curve_bands_reweighted)
+        .function("set_pointwise_loo", &S::set_pointwise_loo)
+        .function("get_loo", &S::get_loo)
+        .function("calibration_bands", &S::calibration_bands)
+        .function("roc_curve", &S::roc_curve)
+        .function("get_auc", &S::get_auc)
+        .function("set_retention", &S::set_retention)
+        .function("get_retention", &S::get_retention)
+        .function("export_draws", &S::export_draws)
+        .function("get_draws_view", &S::get_draws_view)
+        .function("compute_rhat", &S::compute_rhat)
+        .function("compute_ess", &S::compute_ess)
+        .function("get_swap_rate", &S::get_swap_rate)
+        .function("get_pair_swap_rates", &S::get_pair_swap_rates)
+        .function("set_ladder_policy", &S::set_ladder_policy)
+        .function("get_ladder_policy", &S::get_ladder_policy)
+        .function("set_cold_move", &S::set_cold_move)
+        .function("set_subsampling", &S::set_subsampling)
+        .function("get_subsample_anchor", &S::get_subsample_anchor)
+        .function("get_cold_move_stats", &S::get_cold_move_stats)
+        .function("get_temperatures", &S::get_temperatures)
+        .function("get_barrier", &S::get_barrier)
+        .function("recommend_num_chains", &S::recommend_num_chains)
+        .function("get_acceptance_rates", &S::get_acceptance_rates)
+        .function("serialize", &S::serialize)
+        .function("deserialize", select_overload<bool()>(&S::deserialize))
+        .function("resize_checkpoint", &S::resize_checkpoint)
+        .function("get_checkpoint_view", &S::get_checkpoint_view)
+        .function("get_stats", &S::get_stats);
     
-    // Effective sample size (ESS) using autocorrelation
-    std::vector<double> compute_ess(int warmup) const {
-        const auto& samples = chains[0].samples;
-        int n = samples.size() - warmup;
-        if (n < 100) return {0.0, 0.0, 0.0, 0.0};
-        
-        auto compute_ess_param = [n](const std::vector<double>& x) {
-            double mean = std::accumulate(x.begin(), x.end(), 0.0) / x.size();
-            double var = 0.0;
-            for (double v : x) var += (v - mean) * (v - mean);
-            var /= (x.size() - 1);
-            
-            // Compute autocorrelation up to lag 100
-            std::vector<double> acf;
-            for (int lag = 1; lag < std::min(100, static_cast<int>(x.size()) / 2); ++lag) {
-                double sum = 0.0;
-                for (size_t i = lag; i < x.size(); ++i) {
-                    sum += (x[i] - mean) * (x[i - lag] - mean);
-                }
-                acf.push_back(sum / ((x.size() - lag) * var));
-                
-                // Stop when autocorrelation becomes negative
-                if (acf.back() < 0.0) break;
-            }
-            
-            // ESS = n / (1 + 2 * sum(acf))
-            double sum_acf = std::accumulate(acf.begin(), acf.end(), 0.0);
-            return x.size() / (1.0 + 2.0 * sum_acf);
-        };
-        
-        std::vector<double> floor_vec, ceiling_vec, ec50_vec, slope_vec;
-        for (int i = warmup; i < samples.size(); ++i) {
-            floor_vec.push_back(samples[i].floor);
-            ceiling_vec.push_back(samples[i].ceiling);
-            ec50_vec.push_back(samples[i].ec50);
-            slope_vec.push_back(samples[i].slope);
-        }
-        
-        return {
-            compute_ess_param(floor_vec),
-            compute_ess_param(ceiling_vec),
-            compute_ess_param(ec50_vec),
-            compute_ess_param(slope_vec)
-        };
-    }
+    class_<E>((std::string("ParallelTemperingEnsemble") + suffix).c_str())
+        .template constructor<int, int, const Data&, const Priors&>()
+        .template constructor<>()
+        .function("run", &E::run)
+        .function("run_chunk", &E::run_chunk)
+        .function("get_iteration", &E::get_iteration)
+        .function("is_converged", &E::is_converged)
+        .function("get_warmup", &E::get_warmup)
+        .function("set_stopping_rule", &E::set_stopping_rule)
+        .function("set_progress_callback", &set_progress_callback<E>)
+        .function("get_num_replicas", &E::get_num_replicas)
+        .function("get_samples", &E::get_samples)
+        .function("set_retention", &E::set_retention)
+        .function("get_retention", &E::get_retention)
+        .function("export_draws", &E::export_draws)
+        .function("get_draws_view", &E::get_draws_view)
+        .function("curve_bands", &E::curve_bands)
+        .function("summarize", &E::summarize)
+        .function("warm_start", &E::warm_start)
+        .function("reweight_priors", &E::reweight_priors)
+        .function("summarize_reweighted", &E::summarize_reweighted)
+        .function("curve_bands_reweighted", &E::curve_bands_reweighted)
+        .function("set_pointwise_loo", &E::set_pointwise_loo)
+        .function("get_loo", &E::get_loo)
+        .function("calibration_bands", &E::calibration_bands)
+        .function("roc_curve", &E::roc_curve)
+        .function("get_auc", &E::get_auc)
+        .function("compute_rhat", &E::compute_rhat)
+        .function("compute_ess_bulk", &E::compute_ess_bulk)
+        .function("compute_ess_tail", &E::compute_ess_tail)
+        .function("compute_rhat_online", &E::compute_rhat_online)
+        .function("compute_ess_online", &E::compute_ess_online)
+        .function("get_swap_rates", &E::get_swap_rates)
+        .function("set_ladder_policy", &E::set_ladder_policy)
+        .function("get_ladder_policy", &E::get_ladder_policy)
+        .function("set_cold_move", &E::set_cold_move)
+        .function("set_subsampling", &E::set_subsampling)
+        .function("get_subsample_anchor", &E::get_subsample_anchor)
+        .function("get_divergences", &E::get_divergences)
+        .function("get_num_chains", &E::get_num_chains)
+        .function("get_temperatures", &E::get_temperatures)
+        .function("recommend_num_chains", &E::recommend_num_chains)
+        .function("serialize", &E::serialize)
+        .function("deserialize", select_overload<bool()>(&E::deserialize))
+        .function("resize_checkpoint", &E::resize_checkpoint)
+        .function("get_checkpoint_view", &E::get_checkpoint_view)
+        .function("get_stats", &E::get_stats);
     
-    double get_swap_rate() const {
-        return swap_total > 0 ? static_cast<double>(swap_accepted) / swap_total : 0.0;
-    }
+    class_<P>((std::string("BiomarkerPanel") + suffix).c_str())
+        .template constructor<int, int>()
+        .function("titre_view", &P::titre_view)
+        .function("infected_view", &P::infected_view)
+        .function("assign_csv", &P::assign_csv)
+        .function("prepare", &P::prepare)
+        .function("get_num_biomarkers", &P::get_num_biomarkers)
+        .function("get_priors", &P::get_priors)
+        .function("warm_start", &P::warm_start)
+        .function("run", &P::run)
+        .function("run_chunk", &P::run_chunk)
+        .function("get_iteration", &P::get_iteration)
+        .function("is_converged", &P::is_converged)
+        .function("get_warmup", &P::get_warmup)
+        .function("set_stopping_rule", &P::set_stopping_rule)
+        .function("set_progress_callback", &set_progress_callback<P>)
+        .function("set_retention", &P::set_retention)
+        .function("set_ladder_policy", &P::set_ladder_policy)
+        .function("set_cold_move", &P::set_cold_move)
+        .function("set_subsampling", &P::set_subsampling)
+        .function("export_draws", &P::export_draws)
+        .function("get_draws_view", &P::get_draws_view)
+        .function("compute_rhat", &P::compute_rhat)
+        .function("compute_ess_bulk", &P::compute_ess_bulk)
+        .function("compute_ess_tail", &P::compute_ess_tail)
+        .function("get_swap_rates", &P::get_swap_rates)
+        .function("get_num_chains", &P::get_num_chains)
+        .function("curve_bands", &P::curve_bands)
+        .function("summarize", &P::summarize)
+        .function("set_pointwise_loo", &P::set_pointwise_loo)
+        .function("get_loo", &P::get_loo)
+        .function("calibration_bands", &P::calibration_bands)
+        .function("roc_curve", &P::roc_curve)
+        .function("get_auc", &P::get_auc)
+        .function("serialize", &P::serialize)
+        .function("deserialize", select_overload<bool()>(&P::deserialize))
+        .function("resize_checkpoint", &P::resize_checkpoint)
+        .function("get_checkpoint_view", &P::get_checkpoint_view)
+        .function("get_stats", &P::get_stats);
     
-    std::vector<double> get_acceptance_rates() const {
-        std::vector<double> rates;
-        for (const auto& chain : chains) {
-            rates.push_back(chain.get_acceptance_rate());
-        }
-        return rates;
-    }
-};
+    class_<T>((std::string("SimulationStudy") + suffix).c_str())
+        .template constructor<int, int>()
+        .function("set_titre_distribution", &T::set_titre_distribution)
+        .function("simulate", &T::simulate)
+        .function("simulate_from_prior", &T::simulate_from_prior)
+        .function("get_num_datasets", &T::get_num_datasets)
+        .function("get_num_subjects", &T::get_num_subjects)
+        .function("get_truths", &T::get_truths)
+        .function("run", &T::run)
+        .function("run_chunk", &T::run_chunk)
+        .function("get_iteration", &T::get_iteration)
+        .function("is_converged", &T::is_converged)
+        .function("get_warmup", &T::get_warmup)
+        .function("set_stopping_rule", &T::set_stopping_rule)
+        .function("set_progress_callback", &set_progress_callback<T>)
+        .function("set_retention", &T::set_retention)
+        .function("set_ladder_policy", &T::set_ladder_policy)
+        .function("set_cold_move", &T::set_cold_move)
+        .function("summarize", &T::summarize)
+        .function("get_max_rhat", &T::get_max_rhat)
+        .function("power", &T::power)
+        .function("sbc_ranks", &T::sbc_ranks)
+        .function("sbc_histogram", &T::sbc_histogram)
+        .function("get_stats", &T::get_stats);
+}
 
 // JavaScript bindings
 EMSCRIPTEN_BINDINGS(parallel_tempering_module) {
@@ -443,23 +207,176 @@ EMSCRIPTEN_BINDINGS(parallel_tempering_module) {
         .field("slope_mean", &Priors::slope_mean)
         .field("slope_sd", &Priors::slope_sd);
     
+    value_object<GroupPriors>("GroupPriors")
+        .field("population", &GroupPriors::population)
+        .field("tau_floor", &GroupPriors::tau_floor)
+        .field("tau_ceiling", &GroupPriors::tau_ceiling)
+        .field("tau_ec50", &GroupPriors::tau_ec50)
+        .field("tau_slope", &GroupPriors::tau_slope);
+    
+    value_object<RetentionPolicy>("RetentionPolicy")
+        .field("store_rungs", &RetentionPolicy::store_rungs)
+        .field("thin", &RetentionPolicy::thin)
+        .field("discard_warmup", &RetentionPolicy::discard_warmup)
+        .field("capacity", &RetentionPolicy::capacity);
+    
+    value_object<LadderPolicy>("LadderPolicy")
+        .field("adapt_until", &LadderPolicy::adapt_until)
+        .field("max_temperature", &LadderPolicy::max_temperature)
+        .field("target_swap_rate", &LadderPolicy::target_swap_rate)
+        .field("min_rungs", &LadderPolicy::min_rungs)
+        .field("trim", &LadderPolicy::trim);
+    
+    value_object<LooSummary>("LooSummary")
+        .field("elpd_loo", &LooSummary::elpd_loo)
+        .field("se_elpd_loo", &LooSummary::se_elpd_loo)
+        .field("p_loo", &LooSummary::p_loo)
+        .field("looic", &LooSummary::looic)
+        .field("elpd_waic", &LooSummary::elpd_waic)
+        .field("se_elpd_waic", &LooSummary::se_elpd_waic)
+        .field("p_waic", &LooSummary::p_waic)
+        .field("waic", &LooSummary::waic)
+        .field("max_pareto_k", &LooSummary::max_pareto_k)
+        .field("n_high_k", &LooSummary::n_high_k)
+        .field("n_draws", &LooSummary::n_draws);
+    
+    value_object<PriorSensitivity>("PriorSensitivity")
+        .field("pareto_k", &PriorSensitivity::pareto_k)
+        .field("k_threshold", &PriorSensitivity::k_threshold)
+        .field("ess", &PriorSensitivity::ess)
+        .field("n_draws", &PriorSensitivity::n_draws)
+        .field("stable", &PriorSensitivity::stable);
+    
+    value_object<StudyPower>("StudyPower")
+        .field("precision", &StudyPower::precision)
+        .field("coverage", &StudyPower::coverage)
+        .field("mean_half_width", &StudyPower::mean_half_width)
+        .field("rmse", &StudyPower::rmse)
+        .field("n_datasets", &StudyPower::n_datasets);
+    
+    value_object<SamplerStats>("SamplerStats")
+        .field("enabled", &SamplerStats::enabled)
+        .field("iterations", &SamplerStats::iterations)
+        .field("likelihood_evals", &SamplerStats::likelihood_evals)
+        .field("gradient_evals", &SamplerStats::gradient_evals)
+        .field("prior_rejections", &SamplerStats::prior_rejections)
+        .field("proposals", &SamplerStats::proposals)
+        .field("subsampled_steps", &SamplerStats::subsampled_steps)
+        .field("subsampled_terms", &SamplerStats::subsampled_terms)
+        .field("swap_attempts", &SamplerStats::swap_attempts)
+        .field("swap_accepts", &SamplerStats::swap_accepts)
+        .field("pair_attempts", &SamplerStats::pair_attempts)
+        .field("pair_accepts", &SamplerStats::pair_accepts)
+        .field("time_step", &SamplerStats::time_step)
+        .field("time_swap", &SamplerStats::time_swap)
+        .field("time_check", &SamplerStats::time_check)
+        .field("time_progress", &SamplerStats::time_progress)
+        .field("time_export", &SamplerStats::time_export);
+    
     register_vector<double>("VectorDouble");
     register_vector<int>("VectorInt");
     register_vector<Params>("VectorParams");
+    register_vector<std::string>("VectorString");
     
     function("set_random_seed", &set_random_seed);
+    function("simd_enabled", &simd_enabled);
+    function("set_num_threads", &set_num_threads);
+    function("get_num_threads", &get_num_threads);
+    
+    constant("ENGINE_SCALAR", static_cast<int>(ENGINE_SCALAR));
+    constant("ENGINE_SIMD", static_cast<int>(ENGINE_SIMD));
+    constant("ENGINE_MIXED", static_cast<int>(ENGINE_MIXED));
+    constant("MOVE_METROPOLIS", static_cast<int>(MOVE_METROPOLIS));
+    constant("MOVE_NUTS", static_cast<int>(MOVE_NUTS));
+    constant("DRAWS_FLOAT64", static_cast<int>(DRAWS_FLOAT64));
+    constant("DRAWS_FLOAT32", static_cast<int>(DRAWS_FLOAT32));
+    constant("DRAWS_DELTA", static_cast<int>(DRAWS_DELTA));
+    constant("CSV_OK", static_cast<int>(CSV_OK));
+    constant("CSV_ERR_COLUMN", static_cast<int>(CSV_ERR_COLUMN));
+    constant("CSV_ERR_NUMBER", static_cast<int>(CSV_ERR_NUMBER));
+    constant("CSV_ERR_OUTCOME", static_cast<int>(CSV_ERR_OUTCOME));
+    constant("CSV_ERR_EMPTY", static_cast<int>(CSV_ERR_EMPTY));
+    constant("CSV_ERR_QUOTE", static_cast<int>(CSV_ERR_QUOTE));
     
     class_<Data>("Data")
         .constructor<>()
         .constructor<const std::vector<double>&, const std::vector<int>&>()
+        .function("resize", &Data::resize)
+        .function("titre_view", &Data::titre_view)
+        .function("infected_view", &Data::infected_view)
+        .function("finalize", &Data::finalize)
+        .function("compress", &Data::compress)
+        .function("get_num_cells", &Data::get_num_cells)
+        .function("roc_curve", &Data::roc_curve)
+        .function("auc", &Data::auc)
+        .function("set_engine", &Data::set_engine)
+        .property("engine", &Data::engine)
+        .property("compressed", &Data::compressed)
         .property("N", &Data::N);
     
-    class_<ParallelTemperingMCMC>("ParallelTemperingMCMC")
-        .constructor<int, const Data&, const Priors&>()
-        .function("run", &ParallelTemperingMCMC::run)
-        .function("get_samples", &ParallelTemperingMCMC::get_samples)
-        .function("compute_rhat", &ParallelTemperingMCMC::compute_rhat)
-        .function("compute_ess", &ParallelTemperingMCMC::compute_ess)
-        .function("get_swap_rate", &ParallelTemperingMCMC::get_swap_rate)
-        .function("get_acceptance_rates", &ParallelTemperingMCMC::get_acceptance_rates);
+    class_<CsvParser>("CsvParser")
+        .constructor<>()
+        .function("set_delimiter", &CsvParser::set_delimiter)
+        .function("set_titre_column", &CsvParser::set_titre_column)
+        .function("set_infected_column", &CsvParser::set_infected_column)
+        .function("set_group_column", &CsvParser::set_group_column)
+        .function("add_biomarker_column", &CsvParser::add_biomarker_column)
+        .function("resize_chunk", &CsvParser::resize_chunk)
+        .function("get_chunk_view", &CsvParser::get_chunk_view)
+        .function("push_chunk", &CsvParser::push_chunk)
+        .function("finish", &CsvParser::finish)
+        .function("get_error", &CsvParser::get_error)
+        .function("get_error_row", &CsvParser::get_error_row)
+        .function("get_error_message", &CsvParser::get_error_message)
+        .function("get_num_rows", &CsvParser::get_num_rows)
+        .function("get_num_skipped", &CsvParser::get_num_skipped)
+        .function("get_num_infected", &CsvParser::get_num_infected)
+        .function("get_num_biomarkers", &CsvParser::get_num_biomarkers)
+        .function("has_groups", &CsvParser::has_groups)
+        .function("get_column_names", &CsvParser::get_column_names)
+        .function("get_biomarker_names", &CsvParser::get_biomarker_names)
+        .function("get_group_names", &CsvParser::get_group_names)
+        .function("get_titre_range", &CsvParser::get_titre_range)
+        .function("column_view", &CsvParser::column_view)
+        .function("infected_view", &CsvParser::infected_view)
+        .function("into_data", &CsvParser::into_data);
+    
+    class_<GroupedData>("GroupedData")
+        .constructor<>()
+        .constructor<const std::vector<double>&, const std::vector<int>&, const std::vector<int>&>()
+        .function("assign_csv", &GroupedData::assign_csv)
+        .function("compress", &GroupedData::compress)
+        .function("set_engine", &GroupedData::set_engine)
+        .function("get_num_groups", &GroupedData::get_num_groups)
+        .function("get_labels", &GroupedData::get_labels)
+        .function("get_offsets", &GroupedData::get_offsets)
+        .property("N", &GroupedData::N);
+    
+    class_<ParallelTemperingHierarchical>("ParallelTemperingHierarchical")
+        .constructor<int, const GroupedData&, const GroupPriors&>()
+        .function("run", &ParallelTemperingHierarchical::run)
+        .function("run_chunk", &ParallelTemperingHierarchical::run_chunk)
+        .function("get_iteration", &ParallelTemperingHierarchical::get_iteration)
+        .function("is_converged", &ParallelTemperingHierarchical::is_converged)
+        .function("set_stopping_rule", &ParallelTemperingHierarchical::set_stopping_rule)
+        .function("set_progress_callback", &set_progress_callback<ParallelTemperingHierarchical>)
+        .function("get_num_groups", &ParallelTemperingHierarchical::get_num_groups)
+        .function("get_group_labels", &ParallelTemperingHierarchical::get_group_labels)
+        .function("set_max_temperature", &ParallelTemperingHierarchical::set_max_temperature)
+        .function("get_temperatures", &ParallelTemperingHierarchical::get_temperatures)
+        .function("set_retention", &ParallelTemperingHierarchical::set_retention)
+        .function("export_draws", &ParallelTemperingHierarchical::export_draws)
+        .function("get_draws_view", &ParallelTemperingHierarchical::get_draws_view)
+        .function("curve_bands", &ParallelTemperingHierarchical::curve_bands)
+        .function("summarize", &ParallelTemperingHierarchical::summarize)
+        .function("compute_rhat", &ParallelTemperingHierarchical::compute_rhat)
+        .function("compute_ess", &ParallelTemperingHierarchical::compute_ess)
+        .function("get_swap_rate", &ParallelTemperingHierarchical::get_swap_rate)
+        .function("get_acceptance_rates", &ParallelTemperingHierarchical::get_acceptance_rates)
+        .function("get_stats", &ParallelTemperingHierarchical::get_stats);
+    
+    bind_samplers<Model4PL>("");
+    bind_samplers<Model3PLZeroFloor>("3PLZeroFloor");
+    bind_samplers<Model3PLUnitCeiling>("3PLUnitCeiling");
+    bind_samplers<Model2PL>("2PL");
 }
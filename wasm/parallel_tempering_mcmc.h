@@ -0,0 +1,6498 @@
+/*
+ * Parallel Tempering MCMC for 4-Parameter Logistic Model
+ * 
+ * Implements Bayesian inference for correlates of protection analysis
+ * Model: P(infection) = ceiling * (sigmoid(-slope*(titre-ec50)) * (1-floor) + floor)
+ * 
+ * Parameters:
+ *   - floor: [0,1] proportion of max risk at high titre (Beta prior)
+ *   - ceiling: [0,1] max infection probability at low titre (Beta prior)
+ *   - ec50: inflection point titre (Normal prior)
+ *   - slope: [0,∞) steepness of curve (truncated Normal prior)
+ * Reduced models fix floor = 0 and/or ceiling = 1 at compile time (CurveModel);
+ * the samplers are class templates over the model, with ParallelTemperingMCMC,
+ * ParallelTemperingEnsemble and BiomarkerPanel naming the 4PL instances.
+ *
+ * Algorithm: Parallel Tempering with 15 temperature ladders
+ * - Samples from tempered distributions: p(θ|data)^(1/T)
+ * - Swaps states between adjacent chains on a deterministic even/odd schedule
+ * - Provides improved mixing for multimodal posteriors
+ *
+ * Likelihood engines:
+ *   - ENGINE_SCALAR: reference loop using libm exp/log
+ *   - ENGINE_SIMD: 2-lane f64 kernel over aligned structure-of-arrays buffers.
+ *     Compiled with -msimd128 this lowers to WebAssembly SIMD128; without it
+ *     the same code is scalarized by the compiler.
+ *   - ENGINE_MIXED: ENGINE_SIMD on the cold rung, and the same kernel
+ *     instantiated for float (4 lanes, half the memory traffic) on heated rungs.
+ *
+ * Checkpoints: serialize() / deserialize() on the ladder, ensemble and panel
+ * samplers write and read the full state, data and priors as one versioned,
+ * checksummed byte stream (ByteWriter / ByteReader), shared by the
+ * WebAssembly module and the C ABI.
+ *
+ * CSV ingest: CsvParser reads uploads in chunks as they stream in and parses
+ * the selected columns straight into the buffers Data, GroupedData and
+ * BiomarkerPanel are built from.
+ *
+ * Simulation studies: SimulationStudy fits many synthetic cohorts in one
+ * batched run for power analysis and simulation-based calibration.
+ *
+ * Threading: with MCMC_HAVE_THREADS, chains step independently on a shared
+ * worker pool between swap points. Each chain owns an xoshiro256++ stream
+ * (a jump-ahead block of the seeded root stream), so the draws are
+ * bit-identical for a given seed whatever the number of threads. Samplers
+ * may be built and run from several threads at once, each sampler from one
+ * thread at a time; a SeedScope gives a thread's samplers their own seed.
+ *
+ * This header is the whole sampler; parallel_tempering_mcmc.cpp adds the
+ * JavaScript bindings. It also builds natively (g++/clang++ -std=c++17,
+ * plus -DMCMC_THREADS -pthread for the worker pool), as bench.cpp does.
+ */
+
+#ifndef PARALLEL_TEMPERING_MCMC_H
+#define PARALLEL_TEMPERING_MCMC_H
+
+#include <vector>
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <new>
+#include <cstdint>
+#include <cfloat>
+#include <functional>
+#include <memory>
+#include <array>
+#include <cstring>
+#include <type_traits>
+#include <string>
+#include <map>
+#include <cstdlib>
+#include <cctype>
+
+// Threaded builds step the tempered chains concurrently (Emscripten -pthread,
+// or -DMCMC_THREADS for host builds)
+#if defined(__EMSCRIPTEN_PTHREADS__) || defined(MCMC_THREADS)
+#define MCMC_HAVE_THREADS 1
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#else
+#define MCMC_HAVE_THREADS 0
+#endif
+
+// Hot-path counters and phase timers (get_stats()); -DMCMC_NO_STATS compiles
+// them out, and get_stats() then reports only the swap counts the sampler
+// keeps anyway, with enabled = false
+#ifdef MCMC_NO_STATS
+#define MCMC_HAVE_STATS 0
+#else
+#define MCMC_HAVE_STATS 1
+#include <chrono>
+#endif
+
+// Zero-copy typed-array views are only built for the WebAssembly module;
+// host builds (benchmarks, native callers) compile everything else
+#ifdef __EMSCRIPTEN__
+#include <emscripten/val.h>
+using namespace emscripten;
+#endif
+
+// Checkpoint byte streams (see ParallelTemperingMCMC::serialize). Values are
+// stored in host byte order: every supported target (WebAssembly, x86-64,
+// AArch64) is little-endian. Variable-width types (long, size_t) are written
+// as 64-bit so that 32-bit WebAssembly and 64-bit native builds agree.
+class ByteWriter {
+public:
+    std::vector<uint8_t> bytes;
+    
+    template <typename T>
+    void put(const T& v) {
+        static_assert(std::is_trivially_copyable<T>::value, "raw bytes only");
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+        bytes.insert(bytes.end(), p, p + sizeof(T));
+    }
+    
+    template <typename T, class A>
+    void put_vector(const std::vector<T, A>& v) {
+        static_assert(std::is_trivially_copyable<T>::value, "raw bytes only");
+        put<uint64_t>(v.size());
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(v.data());
+        bytes.insert(bytes.end(), p, p + v.size() * sizeof(T));
+    }
+    
+    // LEB128: 7 bits per byte, low bits first
+    void put_varint(uint64_t v) {
+        while (v >= 0x80) {
+            bytes.push_back(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(v));
+    }
+};
+
+// Bounds-checked reader over a checkpoint. A failed read leaves the value
+// untouched and makes every later read fail, so callers check good() once.
+class ByteReader {
+private:
+    const uint8_t* pos;
+    const uint8_t* end;
+    bool ok;
+    
+public:
+    ByteReader(const uint8_t* p, size_t n) : pos(p), end(p + n), ok(p != nullptr || n == 0) {}
+    
+    bool good() const { return ok; }
+    size_t remaining() const { return static_cast<size_t>(end - pos); }
+    bool fail() { return ok = false; }
+    
+    template <typename T>
+    bool get(T& v) {
+        static_assert(std::is_trivially_copyable<T>::value, "raw bytes only");
+        if (!ok || remaining() < sizeof(T)) return fail();
+        std::memcpy(&v, pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+    
+    // Vectors larger than the rest of the stream are rejected before allocating
+    template <typename T, class A>
+    bool get_vector(std::vector<T, A>& v) {
+        uint64_t n;
+        if (!get(n) || n > remaining() / sizeof(T)) return fail();
+        v.resize(static_cast<size_t>(n));
+        if (n > 0) std::memcpy(v.data(), pos, static_cast<size_t>(n) * sizeof(T));
+        pos += static_cast<size_t>(n) * sizeof(T);
+        return true;
+    }
+    
+    bool get_varint(uint64_t& v) {
+        uint64_t out = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (!ok || pos == end) return fail();
+            uint8_t b = *pos++;
+            out |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) {
+                v = out;
+                return true;
+            }
+        }
+        return fail();
+    }
+};
+
+// xoshiro256++ (Blackman & Vigna 2019) with jump-ahead. Every chain and
+// every ladder owns one stream; split() hands out consecutive
+// non-overlapping blocks of 2^128 draws, so a run is a function of the seed
+// and construction order only, never of thread count or scheduling.
+class RngStream {
+private:
+    uint64_t s[4];
+    
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    
+    static uint64_t splitmix64(uint64_t& x) {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+    
+    // Advance by 2^128 draws
+    void jump() {
+        static const uint64_t JUMP[] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                        0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+        uint64_t t[4] = {0, 0, 0, 0};
+        for (uint64_t word : JUMP) {
+            for (int b = 0; b < 64; ++b) {
+                if (word & (1ULL << b)) {
+                    for (int i = 0; i < 4; ++i) t[i] ^= s[i];
+                }
+                next();
+            }
+        }
+        std::copy(t, t + 4, s);
+    }
+    
+public:
+    typedef uint64_t result_type;
+    static constexpr uint64_t min() { return 0; }
+    static constexpr uint64_t max() { return ~0ULL; }
+    
+    explicit RngStream(uint64_t seed = 0) { reseed(seed); }
+    
+    void reseed(uint64_t seed) {
+        for (auto& w : s) w = splitmix64(seed);
+    }
+    
+    uint64_t next() {
+        uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+    
+    uint64_t operator()() { return next(); }
+    
+    // Stream for a new consumer: this stream's current block; this stream then
+    // jumps past it
+    RngStream split() {
+        RngStream child = *this;
+        jump();
+        return child;
+    }
+    
+    void save(ByteWriter& out) const {
+        for (uint64_t w : s) out.put(w);
+    }
+    
+    bool load(ByteReader& in) {
+        for (uint64_t& w : s) in.get(w);
+        return in.good();
+    }
+    
+    // Uniform on [0, 1) with 53 random bits
+    double uniform() { return (next() >> 11) * 0x1.0p-53; }
+    
+    // Uniform on (0, 1], safe to take the log of
+    double uniform_pos() { return ((next() >> 11) + 1) * 0x1.0p-53; }
+    
+    inline double normal();
+};
+
+// 128-layer ziggurat for the standard normal (Marsaglia & Tsang 2000, in
+// Doornik's 2005 formulation). Layer edges x[i] and ratios x[i+1]/x[i] are
+// built once on first use.
+struct ZigguratTables {
+    static constexpr int LAYERS = 128;
+    static constexpr double R = 3.442619855899;      // Start of the tail
+    static constexpr double V = 9.91256303526217e-3; // Area of each layer
+    double x[LAYERS + 1];
+    double ratio[LAYERS];
+    
+    ZigguratTables() {
+        double f = std::exp(-0.5 * R * R);
+        x[0] = V / f;
+        x[1] = R;
+        x[LAYERS] = 0.0;
+        for (int i = 2; i < LAYERS; ++i) {
+            x[i] = std::sqrt(-2.0 * std::log(V / x[i - 1] + f));
+            f = std::exp(-0.5 * x[i] * x[i]);
+        }
+        for (int i = 0; i < LAYERS; ++i) ratio[i] = x[i + 1] / x[i];
+    }
+    
+    static const ZigguratTables& get() {
+        static const ZigguratTables tables;
+        return tables;
+    }
+};
+
+// One 64-bit draw per attempt: the low 7 bits pick the layer, the top 53 the
+// position; ~98.8% of draws return from the rectangle test alone
+inline double RngStream::normal() {
+    const ZigguratTables& z = ZigguratTables::get();
+    for (;;) {
+        uint64_t bits = next();
+        int i = static_cast<int>(bits & (ZigguratTables::LAYERS - 1));
+        double u = 2.0 * ((bits >> 11) * 0x1.0p-53) - 1.0;
+        if (std::fabs(u) < z.ratio[i]) return u * z.x[i];
+        if (i == 0) {
+            // Tail beyond R (Marsaglia 1964)
+            double xt, yt;
+            do {
+                xt = std::log(uniform_pos()) / ZigguratTables::R;
+                yt = std::log(uniform_pos());
+            } while (-2.0 * yt < xt * xt);
+            return u < 0.0 ? xt - ZigguratTables::R : ZigguratTables::R - xt;
+        }
+        double x = u * z.x[i];
+        double f0 = std::exp(-0.5 * (z.x[i] * z.x[i] - x * x));
+        double f1 = std::exp(-0.5 * (z.x[i + 1] * z.x[i + 1] - x * x));
+        if (f1 + uniform() * (f0 - f1) < 1.0) return x;
+    }
+}
+
+// Root stream: each new ladder and chain takes the next block from it
+inline RngStream rng(std::random_device{}());
+
+#if MCMC_HAVE_THREADS
+inline std::mutex rng_mutex; // Samplers may be built from several threads
+#endif
+
+// Stream that root_split() draws from on this thread instead of rng while a
+// SeedScope is alive
+inline RngStream*& seed_override() {
+    thread_local RngStream* stream = nullptr;
+    return stream;
+}
+
+// Next block of the root stream, for a new ladder or chain
+inline RngStream root_split() {
+    if (RngStream* s = seed_override()) return s->split();
+#if MCMC_HAVE_THREADS
+    std::lock_guard<std::mutex> lock(rng_mutex);
+#endif
+    return rng.split();
+}
+
+// Function to reseed the RNG (called from JavaScript)
+inline void set_random_seed(unsigned int seed) {
+#if MCMC_HAVE_THREADS
+    std::lock_guard<std::mutex> lock(rng_mutex);
+#endif
+    rng.reseed(seed);
+}
+
+// Seeds the samplers built on this thread during its lifetime from their own
+// root stream, as if set_random_seed(seed) had just been called, without
+// touching the process-wide one: concurrent callers each reproduce their run
+class SeedScope {
+private:
+    RngStream stream;
+    RngStream* saved;
+    
+public:
+    explicit SeedScope(unsigned int seed) : stream(seed), saved(seed_override()) { seed_override() = &stream; }
+    ~SeedScope() { seed_override() = saved; }
+    SeedScope(const SeedScope&) = delete;
+    SeedScope& operator=(const SeedScope&) = delete;
+};
+
+#if MCMC_HAVE_THREADS
+// Fixed-size worker pool. parallel_for hands out task indices to the
+// workers and the calling thread, and returns once every task is done.
+// Calls made from inside a task run inline, so nesting cannot deadlock.
+class WorkerPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex submit_mutex; // One parallel_for in flight at a time
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+    const std::function<void(int)>* task;
+    int n_tasks;
+    int next_task;
+    int pending;
+    unsigned long generation;
+    bool stopping;
+    
+    static bool& inside_task() {
+        thread_local bool flag = false;
+        return flag;
+    }
+    
+    // Claim and run tasks until none remain; expects the lock to be held
+    void drain(std::unique_lock<std::mutex>& lock) {
+        while (next_task < n_tasks) {
+            int t = next_task++;
+            const std::function<void(int)>& fn = *task;
+            lock.unlock();
+            inside_task() = true;
+            fn(t);
+            inside_task() = false;
+            lock.lock();
+            if (--pending == 0) done_cv.notify_all();
+        }
+    }
+    
+    void worker_loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        unsigned long seen = generation;
+        while (true) {
+            work_cv.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+            drain(lock);
+        }
+    }
+    
+public:
+    explicit WorkerPool(int n_threads)
+        : task(nullptr), n_tasks(0), next_task(0), pending(0), generation(0), stopping(false) {
+        for (int i = 1; i < n_threads; ++i) {
+            workers.emplace_back(&WorkerPool::worker_loop, this);
+        }
+    }
+    
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_cv.notify_all();
+        for (auto& w : workers) w.join();
+    }
+    
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+    
+    void parallel_for(int n, const std::function<void(int)>& fn) {
+        if (n <= 1 || workers.empty() || inside_task()) {
+            for (int i = 0; i < n; ++i) fn(i);
+            return;
+        }
+        std::lock_guard<std::mutex> submit(submit_mutex);
+        std::unique_lock<std::mutex> lock(mutex);
+        task = &fn;
+        n_tasks = n;
+        next_task = 0;
+        pending = n;
+        generation++;
+        work_cv.notify_all();
+        drain(lock);
+        done_cv.wait(lock, [&] { return pending == 0; });
+        task = nullptr;
+    }
+};
+
+inline std::atomic<int> num_threads{static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))};
+inline std::mutex worker_pool_mutex;
+inline std::shared_ptr<WorkerPool> worker_pool;
+
+// A pool replaced after a thread-count change stays alive until the runs
+// already using it return
+inline std::shared_ptr<WorkerPool> shared_pool() {
+    std::lock_guard<std::mutex> lock(worker_pool_mutex);
+    const int n = num_threads;
+    if (!worker_pool || worker_pool->size() != n) worker_pool = std::make_shared<WorkerPool>(n);
+    return worker_pool;
+}
+#endif
+
+// Number of threads used to step chains (1 in single-threaded builds)
+inline void set_num_threads(int n) {
+#if MCMC_HAVE_THREADS
+    num_threads = std::max(1, n);
+#else
+    (void)n;
+#endif
+}
+
+inline int get_num_threads() {
+#if MCMC_HAVE_THREADS
+    return num_threads;
+#else
+    return 1;
+#endif
+}
+
+// Run fn(0..n-1), concurrently when threads are available
+inline void parallel_for(int n, const std::function<void(int)>& fn) {
+#if MCMC_HAVE_THREADS
+    if (num_threads > 1) {
+        shared_pool()->parallel_for(n, fn);
+        return;
+    }
+#endif
+    for (int i = 0; i < n; ++i) fn(i);
+}
+
+// Sigmoid function
+template <typename Real>
+inline Real sigmoid(Real x) {
+    return Real(1) / (Real(1) + std::exp(-x));
+}
+
+// Log-density for Beta distribution
+inline double log_beta_pdf(double x, double alpha, double beta) {
+    if (x <= 0.0 || x >= 1.0) return -INFINITY;
+    return (alpha - 1.0) * std::log(x) + (beta - 1.0) * std::log(1.0 - x);
+}
+
+// Log-density for Normal distribution
+inline double log_normal_pdf(double x, double mean, double sd) {
+    double z = (x - mean) / sd;
+    return -0.5 * z * z - std::log(sd) - 0.5 * std::log(2.0 * M_PI);
+}
+
+// Log-density for truncated Normal (lower bound = 0)
+inline double log_truncated_normal_pdf(double x, double mean, double sd) {
+    if (x <= 0.0) return -INFINITY;
+    double z = (x - mean) / sd;
+    double log_normalization = std::log(1.0 - 0.5 * std::erfc(-mean / (sd * std::sqrt(2.0))));
+    return -0.5 * z * z - std::log(sd) - 0.5 * std::log(2.0 * M_PI) - log_normalization;
+}
+
+// Log-density for Bernoulli likelihood
+template <typename Real>
+inline Real log_bernoulli_pmf(int y, Real p) {
+    if (p <= Real(0) || p >= Real(1)) return -INFINITY;
+    return y == 1 ? std::log(p) : std::log(Real(1) - p);
+}
+
+// Log-density for Binomial likelihood (binomial coefficient omitted: constant in the parameters)
+template <typename Real>
+inline Real log_binomial_kernel(int k, int n, Real p) {
+    if (p <= Real(0) || p >= Real(1)) return -INFINITY;
+    Real lp = 0;
+    if (k > 0) lp += k * std::log(p);
+    if (n > k) lp += (n - k) * std::log(Real(1) - p);
+    return lp;
+}
+
+// Likelihood engines
+enum LikelihoodEngine {
+    ENGINE_SCALAR = 0,
+    ENGINE_SIMD = 1,
+    ENGINE_MIXED = 2  // ENGINE_SIMD, single precision on heated rungs
+};
+
+#if defined(__wasm_simd128__) || defined(__SSE2__) || defined(__ARM_NEON)
+#define MCMC_HAVE_SIMD 1
+#else
+#define MCMC_HAVE_SIMD 0
+#endif
+
+// True when the SIMD engine maps onto hardware vector instructions
+inline bool simd_enabled() {
+    return MCMC_HAVE_SIMD != 0;
+}
+
+// Per-chain work counters. Each chain is stepped by one thread at a time, so
+// plain integers suffice; samplers sum them when asked.
+struct HotCounters {
+#if MCMC_HAVE_STATS
+    uint64_t likelihood_evals; // Full likelihood passes (random-walk proposals, restarts)
+    uint64_t gradient_evals;   // Likelihood-and-gradient passes (NUTS leapfrog steps)
+    uint64_t prior_rejections; // Proposals outside the prior's support: no likelihood pass
+    uint64_t proposals;        // Random-walk proposals drawn
+    uint64_t subsampled_steps; // Steps that estimated the likelihood ratio from a subsample
+    uint64_t subsampled_terms; // Likelihood terms those steps touched
+    
+    HotCounters()
+        : likelihood_evals(0), gradient_evals(0), prior_rejections(0), proposals(0),
+          subsampled_steps(0), subsampled_terms(0) {}
+    
+    void likelihood() { likelihood_evals++; }
+    void gradient() { gradient_evals++; }
+    void prior_rejection() { prior_rejections++; }
+    void proposal() { proposals++; }
+    void subsample(int terms) {
+        subsampled_steps++;
+        subsampled_terms += terms;
+    }
+    
+    void save(ByteWriter& out) const {
+        for (uint64_t c : {likelihood_evals, gradient_evals, prior_rejections, proposals, subsampled_steps, subsampled_terms}) {
+            out.put(c);
+        }
+    }
+    
+    bool load(ByteReader& in) {
+        for (uint64_t* c : {&likelihood_evals, &gradient_evals, &prior_rejections, &proposals, &subsampled_steps, &subsampled_terms}) {
+            in.get(*c);
+        }
+        return in.good();
+    }
+#else
+    void likelihood() {}
+    void gradient() {}
+    void prior_rejection() {}
+    void proposal() {}
+    void subsample(int) {}
+    
+    // Same layout as the counting build, so checkpoints move between the two
+    void save(ByteWriter& out) const {
+        for (int i = 0; i < 6; ++i) out.put<uint64_t>(0);
+    }
+    
+    bool load(ByteReader& in) {
+        uint64_t skip;
+        for (int i = 0; i < 6; ++i) in.get(skip);
+        return in.good();
+    }
+#endif
+};
+
+// Wall-clock seconds spent in each phase of run_schedule and in export
+struct PhaseTimes {
+    double step;     // Stepping chains (includes pool dispatch and waits)
+    double swap;     // Swap rounds and ladder adaptation
+    double check;    // Stopping-rule diagnostics
+    double progress; // Progress callbacks (JS marshalling in the module)
+    double output;   // Filling the draw export buffer
+    
+    PhaseTimes() : step(0.0), swap(0.0), check(0.0), progress(0.0), output(0.0) {}
+};
+
+// Adds the lifetime of the scope to a PhaseTimes field
+class PhaseTimer {
+#if MCMC_HAVE_STATS
+    double& total;
+    std::chrono::steady_clock::time_point start;
+    
+public:
+    explicit PhaseTimer(double& t) : total(t), start(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() {
+        total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+#else
+public:
+    explicit PhaseTimer(double&) {}
+#endif
+};
+
+// Snapshot returned by get_stats(). Counts are doubles so they cross into
+// JavaScript as plain numbers; pair vectors are indexed by the lower rung.
+struct SamplerStats {
+    bool enabled; // False when built with MCMC_NO_STATS
+    int iterations;
+    double likelihood_evals;
+    double gradient_evals;
+    double prior_rejections;
+    double proposals;
+    double subsampled_steps;
+    double subsampled_terms;
+    double swap_attempts;
+    double swap_accepts;
+    std::vector<double> pair_attempts;
+    std::vector<double> pair_accepts;
+    double time_step;
+    double time_swap;
+    double time_check;
+    double time_progress;
+    double time_export;
+    
+    SamplerStats()
+        : enabled(MCMC_HAVE_STATS != 0), iterations(0), likelihood_evals(0.0), gradient_evals(0.0),
+          prior_rejections(0.0), proposals(0.0), subsampled_steps(0.0), subsampled_terms(0.0),
+          swap_attempts(0.0), swap_accepts(0.0), time_step(0.0), time_swap(0.0), time_check(0.0),
+          time_progress(0.0), time_export(0.0) {}
+    
+    void add_counters(const HotCounters& c) {
+#if MCMC_HAVE_STATS
+        likelihood_evals += static_cast<double>(c.likelihood_evals);
+        gradient_evals += static_cast<double>(c.gradient_evals);
+        prior_rejections += static_cast<double>(c.prior_rejections);
+        proposals += static_cast<double>(c.proposals);
+        subsampled_steps += static_cast<double>(c.subsampled_steps);
+        subsampled_terms += static_cast<double>(c.subsampled_terms);
+#else
+        (void)c;
+#endif
+    }
+    
+    void add_times(const PhaseTimes& t) {
+        time_step += t.step;
+        time_swap += t.swap;
+        time_check += t.check;
+        time_progress += t.progress;
+        time_export += t.output;
+    }
+    
+    // Fold in another sampler's counters and swaps; times and iterations are
+    // left to the caller, since nested samplers share one schedule
+    void merge_work(const SamplerStats& o) {
+        likelihood_evals += o.likelihood_evals;
+        gradient_evals += o.gradient_evals;
+        prior_rejections += o.prior_rejections;
+        proposals += o.proposals;
+        subsampled_steps += o.subsampled_steps;
+        subsampled_terms += o.subsampled_terms;
+        swap_attempts += o.swap_attempts;
+        swap_accepts += o.swap_accepts;
+        if (pair_attempts.size() < o.pair_attempts.size()) {
+            pair_attempts.resize(o.pair_attempts.size(), 0.0);
+            pair_accepts.resize(o.pair_accepts.size(), 0.0);
+        }
+        for (size_t i = 0; i < o.pair_attempts.size(); ++i) {
+            pair_attempts[i] += o.pair_attempts[i];
+            pair_accepts[i] += o.pair_accepts[i];
+        }
+    }
+};
+
+// Allocator returning 16-byte aligned storage for SIMD loads
+template <typename T, std::size_t Align = 16>
+struct AlignedAllocator {
+    typedef T value_type;
+    template <typename U> struct rebind { typedef AlignedAllocator<U, Align> other; };
+    
+    AlignedAllocator() {}
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+    
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+    }
+    void deallocate(T* ptr, std::size_t) {
+        ::operator delete(ptr, std::align_val_t(Align));
+    }
+    bool operator==(const AlignedAllocator&) const { return true; }
+    bool operator!=(const AlignedAllocator&) const { return false; }
+};
+
+typedef std::vector<double, AlignedAllocator<double>> AlignedVector;
+
+// Two-lane double vectors (GCC/Clang vector extensions)
+typedef double f64x2 __attribute__((vector_size(16)));
+typedef int64_t i64x2 __attribute__((vector_size(16)));
+
+const int SIMD_LANES = 2;
+
+inline f64x2 simd_splat(double x) {
+    f64x2 v = {x, x};
+    return v;
+}
+
+inline i64x2 simd_splat_i64(int64_t x) {
+    i64x2 v = {x, x};
+    return v;
+}
+
+// Lane-wise mask ? a : b
+inline f64x2 simd_select(i64x2 mask, f64x2 a, f64x2 b) {
+    return (f64x2)(((i64x2)a & mask) | ((i64x2)b & ~mask));
+}
+
+// Vector exp. Range reduction x = k*ln2 + r with |r| <= ln2/2, then a
+// degree-13 Taylor polynomial: relative error < 1e-15 on [-708, 709].
+// Inputs outside that range are clamped.
+inline f64x2 simd_exp(f64x2 x) {
+    const f64x2 hi = simd_splat(709.0);
+    const f64x2 lo = simd_splat(-708.0);
+    x = simd_select(x > hi, hi, x);
+    x = simd_select(x < lo, lo, x);
+    
+    // Round x/ln2 to nearest integer using the 1.5*2^52 shifter
+    const f64x2 shifter = simd_splat(6755399441055744.0);
+    f64x2 t = x * simd_splat(1.4426950408889634) + shifter;
+    i64x2 k = (i64x2)t - (i64x2)shifter;
+    f64x2 kd = t - shifter;
+    
+    f64x2 r = x - kd * simd_splat(6.93147180369123816490e-01);
+    r = r - kd * simd_splat(1.90821492927058770002e-10);
+    
+    f64x2 poly = simd_splat(1.0 / 6227020800.0);
+    poly = poly * r + simd_splat(1.0 / 479001600.0);
+    poly = poly * r + simd_splat(1.0 / 39916800.0);
+    poly = poly * r + simd_splat(1.0 / 3628800.0);
+    poly = poly * r + simd_splat(1.0 / 362880.0);
+    poly = poly * r + simd_splat(1.0 / 40320.0);
+    poly = poly * r + simd_splat(1.0 / 5040.0);
+    poly = poly * r + simd_splat(1.0 / 720.0);
+    poly = poly * r + simd_splat(1.0 / 120.0);
+    poly = poly * r + simd_splat(1.0 / 24.0);
+    poly = poly * r + simd_splat(1.0 / 6.0);
+    poly = poly * r + simd_splat(0.5);
+    poly = poly * r + simd_splat(1.0);
+    poly = poly * r + simd_splat(1.0);
+    
+    // Scale by 2^k by building the exponent field directly
+    f64x2 scale = (f64x2)((k + simd_splat_i64(1023)) << 52);
+    return poly * scale;
+}
+
+// Vector natural log for normal positive inputs. Writes x = 2^e * m with
+// m in [sqrt(1/2), sqrt(2)) and evaluates log(m) = 2*atanh(s), s = (m-1)/(m+1),
+// |s| <= 0.1716, by its odd series to s^19: relative error < 1e-15.
+// Zero, negative, subnormal and non-finite inputs must be masked by the caller.
+inline f64x2 simd_log(f64x2 x) {
+    const i64x2 mantissa_mask = simd_splat_i64(0x000FFFFFFFFFFFFFLL);
+    const i64x2 exponent_one = simd_splat_i64(0x3FF0000000000000LL);
+    
+    i64x2 bits = (i64x2)x;
+    i64x2 e = ((bits >> 52) & simd_splat_i64(0x7FF)) - simd_splat_i64(1023);
+    f64x2 m = (f64x2)((bits & mantissa_mask) | exponent_one);
+    
+    i64x2 big = m > simd_splat(1.4142135623730951);
+    m = simd_select(big, m * simd_splat(0.5), m);
+    e = e - big; // big lanes are -1, so this adds one to the exponent
+    
+    // int64 -> double for small integers via the 1.5*2^52 shifter
+    const f64x2 shifter = simd_splat(6755399441055744.0);
+    f64x2 ed = (f64x2)(e + (i64x2)shifter) - shifter;
+    
+    f64x2 s = (m - simd_splat(1.0)) / (m + simd_splat(1.0));
+    f64x2 s2 = s * s;
+    f64x2 poly = simd_splat(1.0 / 19.0);
+    poly = poly * s2 + simd_splat(1.0 / 17.0);
+    poly = poly * s2 + simd_splat(1.0 / 15.0);
+    poly = poly * s2 + simd_splat(1.0 / 13.0);
+    poly = poly * s2 + simd_splat(1.0 / 11.0);
+    poly = poly * s2 + simd_splat(1.0 / 9.0);
+    poly = poly * s2 + simd_splat(1.0 / 7.0);
+    poly = poly * s2 + simd_splat(1.0 / 5.0);
+    poly = poly * s2 + simd_splat(1.0 / 3.0);
+    poly = poly * s2 + simd_splat(1.0);
+    
+    return ed * simd_splat(0.6931471805599453) + simd_splat(2.0) * s * poly;
+}
+
+// Four-lane float vectors for the single-precision engine
+typedef float f32x4 __attribute__((vector_size(16)));
+typedef int32_t i32x4 __attribute__((vector_size(16)));
+
+inline f32x4 simd_splat_f32(float x) {
+    f32x4 v = {x, x, x, x};
+    return v;
+}
+
+inline i32x4 simd_splat_i32(int32_t x) {
+    i32x4 v = {x, x, x, x};
+    return v;
+}
+
+inline f32x4 simd_select(i32x4 mask, f32x4 a, f32x4 b) {
+    return (f32x4)(((i32x4)a & mask) | ((i32x4)b & ~mask));
+}
+
+// Float exp as simd_exp above with a degree-7 polynomial: relative error
+// < 2e-7 on [-87, 88]
+inline f32x4 simd_exp(f32x4 x) {
+    const f32x4 hi = simd_splat_f32(88.0f);
+    const f32x4 lo = simd_splat_f32(-87.0f);
+    x = simd_select(x > hi, hi, x);
+    x = simd_select(x < lo, lo, x);
+    
+    const f32x4 shifter = simd_splat_f32(12582912.0f); // 1.5 * 2^23
+    f32x4 t = x * simd_splat_f32(1.44269504f) + shifter;
+    i32x4 k = (i32x4)t - (i32x4)shifter;
+    f32x4 kd = t - shifter;
+    
+    f32x4 r = x - kd * simd_splat_f32(0.693145752f);
+    r = r - kd * simd_splat_f32(1.42860677e-6f);
+    
+    f32x4 poly = simd_splat_f32(1.0f / 5040.0f);
+    poly = poly * r + simd_splat_f32(1.0f / 720.0f);
+    poly = poly * r + simd_splat_f32(1.0f / 120.0f);
+    poly = poly * r + simd_splat_f32(1.0f / 24.0f);
+    poly = poly * r + simd_splat_f32(1.0f / 6.0f);
+    poly = poly * r + simd_splat_f32(0.5f);
+    poly = poly * r + simd_splat_f32(1.0f);
+    poly = poly * r + simd_splat_f32(1.0f);
+    
+    f32x4 scale = (f32x4)((k + simd_splat_i32(127)) << 23);
+    return poly * scale;
+}
+
+// Float log as simd_log above, series to s^9: relative error < 1e-7.
+// Zero, negative, subnormal and non-finite inputs must be masked by the caller.
+inline f32x4 simd_log(f32x4 x) {
+    i32x4 bits = (i32x4)x;
+    i32x4 e = ((bits >> 23) & simd_splat_i32(0xFF)) - simd_splat_i32(127);
+    f32x4 m = (f32x4)((bits & simd_splat_i32(0x007FFFFF)) | simd_splat_i32(0x3F800000));
+    
+    i32x4 big = m > simd_splat_f32(1.41421356f);
+    m = simd_select(big, m * simd_splat_f32(0.5f), m);
+    e = e - big;
+    
+    const f32x4 shifter = simd_splat_f32(12582912.0f);
+    f32x4 ed = (f32x4)(e + (i32x4)shifter) - shifter;
+    
+    f32x4 s = (m - simd_splat_f32(1.0f)) / (m + simd_splat_f32(1.0f));
+    f32x4 s2 = s * s;
+    f32x4 poly = simd_splat_f32(1.0f / 9.0f);
+    poly = poly * s2 + simd_splat_f32(1.0f / 7.0f);
+    poly = poly * s2 + simd_splat_f32(1.0f / 5.0f);
+    poly = poly * s2 + simd_splat_f32(1.0f / 3.0f);
+    poly = poly * s2 + simd_splat_f32(1.0f);
+    
+    return ed * simd_splat_f32(0.693147181f) + simd_splat_f32(2.0f) * s * poly;
+}
+
+// Vector types and helpers per scalar type, so the likelihood kernel is
+// written once. flush_every > 0 moves the lane sums into a double every that
+// many vectors, which keeps float accumulation error at the block level.
+template <typename Real> struct SimdLanes;
+
+template <> struct SimdLanes<double> {
+    typedef f64x2 vec;
+    typedef i64x2 mask;
+    static constexpr int width = 2;
+    static constexpr int flush_every = 0;
+    static vec splat(double x) { return simd_splat(x); }
+    static mask none() { return simd_splat_i64(0); }
+    static bool any(mask m) { return (m[0] | m[1]) != 0; }
+    static double tiny() { return DBL_MIN; }
+    static double sum(vec v) { return v[0] + v[1]; }
+};
+
+template <> struct SimdLanes<float> {
+    typedef f32x4 vec;
+    typedef i32x4 mask;
+    static constexpr int width = 4;
+    static constexpr int flush_every = 64;
+    static vec splat(float x) { return simd_splat_f32(x); }
+    static mask none() { return simd_splat_i32(0); }
+    static bool any(mask m) { return (m[0] | m[1] | m[2] | m[3]) != 0; }
+    static float tiny() { return FLT_MIN; }
+    static double sum(vec v) { return (static_cast<double>(v[0]) + v[1]) + (static_cast<double>(v[2]) + v[3]); }
+};
+
+// Model parameters structure
+template <typename Real>
+struct ParamsT {
+    Real floor;
+    Real ceiling;
+    Real ec50;
+    Real slope;
+    
+    ParamsT() : floor(0.5), ceiling(0.5), ec50(0.0), slope(1.0) {}
+    ParamsT(Real f, Real c, Real e, Real s) : floor(f), ceiling(c), ec50(e), slope(s) {}
+    template <typename Other>
+    explicit ParamsT(const ParamsT<Other>& o)
+        : floor(static_cast<Real>(o.floor)), ceiling(static_cast<Real>(o.ceiling)),
+          ec50(static_cast<Real>(o.ec50)), slope(static_cast<Real>(o.slope)) {}
+};
+
+typedef ParamsT<double> Params;
+
+// Structure-of-arrays likelihood terms for the SIMD engines: titre plus the
+// weights on log(p) and log(1-p), padded to whole vectors
+template <typename Real>
+struct SoaBlock {
+    typedef std::vector<Real, AlignedAllocator<Real>> Column;
+    Column titre;
+    Column w_pos;
+    Column w_neg;
+    
+    void clear() {
+        Column().swap(titre);
+        Column().swap(w_pos);
+        Column().swap(w_neg);
+    }
+};
+
+// Prior hyperparameters
+struct Priors {
+    double floor_alpha, floor_beta;
+    double ceiling_alpha, ceiling_beta;
+    double ec50_mean, ec50_sd;
+    double slope_mean, slope_sd;
+    
+    Priors() : floor_alpha(1.0), floor_beta(1.0), 
+               ceiling_alpha(1.0), ceiling_beta(1.0),
+               ec50_mean(0.0), ec50_sd(1.0),
+               slope_mean(1.0), slope_sd(1.0) {}
+};
+
+// Dataset
+struct Data {
+    std::vector<double> titre;
+    std::vector<int> infected;
+    int N;
+    
+    // Compressed layout: one binomial cell per distinct titre value.
+    // Observations sharing a titre are exchangeable in the likelihood, so the
+    // (infected, total) counts are sufficient statistics for each cell.
+    bool compressed;
+    std::vector<double> cell_titre;
+    std::vector<int> cell_infected;
+    std::vector<int> cell_total;
+    
+    // Row indices in ascending titre order, built once when the rows are
+    // finalized. The 4PL risk is monotone in titre for slope > 0, so this one
+    // sort ranks the observations for every posterior draw: it drives cell
+    // compression, the ROC curve and the calibration bins.
+    std::vector<int> titre_order;
+    
+    // Blocks used by the SIMD engines; soa32 only with ENGINE_MIXED
+    int engine;
+    SoaBlock<double> soa;
+    SoaBlock<float> soa32;
+    
+    Data() : N(0), compressed(false), engine(ENGINE_SCALAR) {}
+    Data(const std::vector<double>& t, const std::vector<int>& i) 
+        : titre(t), infected(i), N(t.size()), compressed(false), engine(ENGINE_SCALAR) {
+        build_index();
+    }
+    
+    // Bulk ingest from raw buffers in one pass (no per-element marshalling)
+    void assign(const double* t, const int* inf, int n) {
+        titre.assign(t, t + n);
+        infected.assign(inf, inf + n);
+        finalize();
+    }
+    
+    // Bulk ingest from JS: resize(n), fill titre_view()/infected_view() with
+    // Float64Array/Int32Array.set(), then finalize()
+    void resize(int n) {
+        titre.resize(std::max(0, n));
+        infected.resize(std::max(0, n));
+        N = static_cast<int>(titre.size());
+    }
+    
+#ifdef __EMSCRIPTEN__
+    // Zero-copy views of the raw buffers; invalidated by heap growth
+    val titre_view() {
+        return val(typed_memory_view(titre.size(), titre.data()));
+    }
+    val infected_view() {
+        return val(typed_memory_view(infected.size(), infected.data()));
+    }
+#endif
+    
+    // Refresh derived layouts after the raw buffers changed.
+    // Returns the number of outcomes that are not 0/1 (those count as uninfected).
+    int finalize() {
+        N = static_cast<int>(titre.size());
+        int invalid = 0;
+        for (int y : infected) invalid += (y != 0 && y != 1) ? 1 : 0;
+        build_index();
+        if (compressed) compress();
+        else if (engine != ENGINE_SCALAR) build_soa();
+        return invalid;
+    }
+    
+    // Select the likelihood engine (LikelihoodEngine)
+    void set_engine(int e) {
+        engine = (e == ENGINE_SIMD || e == ENGINE_MIXED) ? e : ENGINE_SCALAR;
+        if (engine != ENGINE_SCALAR) build_soa();
+    }
+    
+    // Lay out the active representation (cells or raw rows) as aligned SoA buffers
+    void build_soa() {
+        fill_soa(soa);
+        if (engine == ENGINE_MIXED) fill_soa(soa32);
+        else soa32.clear();
+    }
+    
+    template <typename Real>
+    void fill_soa(SoaBlock<Real>& block) const {
+        const int lanes = SimdLanes<Real>::width;
+        const int n = get_num_cells();
+        const int padded = (n + lanes - 1) / lanes * lanes;
+        // Padding lanes reuse a real titre with zero weight so they cannot trip the validity mask
+        const double pad_titre = n > 0 ? (compressed ? cell_titre[0] : titre[0]) : 0.0;
+        block.titre.assign(padded, static_cast<Real>(pad_titre));
+        block.w_pos.assign(padded, Real(0));
+        block.w_neg.assign(padded, Real(0));
+        for (int i = 0; i < n; ++i) {
+            if (compressed) {
+                block.titre[i] = static_cast<Real>(cell_titre[i]);
+                block.w_pos[i] = static_cast<Real>(cell_infected[i]);
+                block.w_neg[i] = static_cast<Real>(cell_total[i] - cell_infected[i]);
+            } else {
+                block.titre[i] = static_cast<Real>(titre[i]);
+                block.w_pos[i] = infected[i] == 1 ? Real(1) : Real(0);
+                block.w_neg[i] = infected[i] == 1 ? Real(0) : Real(1);
+            }
+        }
+    }
+    
+    void build_index() {
+        titre_order.resize(N);
+        std::iota(titre_order.begin(), titre_order.end(), 0);
+        std::stable_sort(titre_order.begin(), titre_order.end(), [this](int a, int b) { return titre[a] < titre[b]; });
+    }
+    
+    // Visit each distinct titre in ascending order as fn(titre, infected, total)
+    template <typename Fn>
+    void for_each_titre_group(Fn fn) const {
+        size_t i = 0;
+        while (i < titre_order.size()) {
+            double t = titre[titre_order[i]];
+            int k = 0, m = 0;
+            for (; i < titre_order.size() && titre[titre_order[i]] == t; ++i) {
+                k += infected[titre_order[i]] == 1 ? 1 : 0;
+                m++;
+            }
+            fn(t, k, m);
+        }
+    }
+    
+    // Collapse repeated titres into binomial cells (sorted by titre)
+    void compress() {
+        if (static_cast<int>(titre_order.size()) != N) build_index();
+        cell_titre.clear();
+        cell_infected.clear();
+        cell_total.clear();
+        for_each_titre_group([this](double t, int k, int m) {
+            cell_titre.push_back(t);
+            cell_infected.push_back(k);
+            cell_total.push_back(m);
+        });
+        compressed = true;
+        if (engine != ENGINE_SCALAR) build_soa();
+    }
+    
+    // Raw rows and layout choices; load() rebuilds every derived layout the
+    // same way the original calls did, so the likelihood is bit-identical
+    void save(ByteWriter& out) const {
+        out.put_vector(titre);
+        out.put_vector(infected);
+        out.put<uint8_t>(compressed ? 1 : 0);
+        out.put<int32_t>(engine);
+    }
+    
+    bool load(ByteReader& in) {
+        std::vector<double> t;
+        std::vector<int> inf;
+        uint8_t comp = 0;
+        int32_t e = ENGINE_SCALAR;
+        in.get_vector(t);
+        in.get_vector(inf);
+        in.get(comp);
+        in.get(e);
+        if (!in.good() || t.size() != inf.size()) return in.fail();
+        *this = Data();
+        assign(t.data(), inf.data(), static_cast<int>(t.size()));
+        if (comp) compress();
+        set_engine(e);
+        return true;
+    }
+    
+    // Number of terms the likelihood sums over
+    int get_num_cells() const {
+        return compressed ? static_cast<int>(cell_titre.size()) : N;
+    }
+    
+    // ROC curve of the 4PL risk score as [fpr_0..fpr_D | tpr_0..tpr_D]. For
+    // slope > 0 the risk falls with titre, so every draw ranks subjects the
+    // same way and the curve is one walk up the titre index: one point per
+    // distinct titre, ties sharing a threshold. No parameters needed.
+    std::vector<double> roc_curve() const {
+        int positives = 0;
+        for (int y : infected) positives += y == 1 ? 1 : 0;
+        const int negatives = N - positives;
+        std::vector<double> fpr{0.0}, tpr{0.0};
+        int tp = 0, fp = 0;
+        for_each_titre_group([&](double, int k, int m) {
+            tp += k;
+            fp += m - k;
+            fpr.push_back(negatives > 0 ? static_cast<double>(fp) / negatives : 0.0);
+            tpr.push_back(positives > 0 ? static_cast<double>(tp) / positives : 0.0);
+        });
+        fpr.insert(fpr.end(), tpr.begin(), tpr.end());
+        return fpr;
+    }
+    
+    // Area under roc_curve() (trapezoidal, i.e. Mann-Whitney with half-credit ties)
+    double auc() const {
+        std::vector<double> roc = roc_curve();
+        const size_t n = roc.size() / 2;
+        double area = 0.0;
+        for (size_t i = 1; i < n; ++i) {
+            area += (roc[i] - roc[i - 1]) * (roc[n + i] + roc[n + i - 1]) / 2.0;
+        }
+        return area;
+    }
+};
+
+// Streaming CSV ingest. Bytes arrive in chunks of any size (e.g. from
+// File.stream()) and go through a byte-level state machine, so only the
+// field in progress is ever buffered: selected columns are parsed straight
+// into the column buffers that into_data() hands to a Data, and that
+// GroupedData and BiomarkerPanel copy from once.
+//
+// Format: a header row, then RFC 4180 rows. Fields may be quoted ("" is a
+// literal quote, quoted fields may span lines), CRLF and a UTF-8 byte order
+// mark are accepted, and fields are trimmed of blanks. Blank lines are
+// ignored; rows with an empty selected field are skipped and counted.
+//
+// Columns are matched by header name, case-insensitively: the titre (or
+// titer, antibody, ab), the outcome (infected, outcome, status, infection)
+// and an optional group column. add_biomarker_column() selects several
+// titre columns instead, for a panel. Group values are labels: the g-th
+// distinct value seen becomes group id g (see get_group_names()).
+//
+// Parsing stops at the first error. Rows are numbered by line, with the
+// header as row 1.
+enum CsvError {
+    CSV_OK = 0,
+    CSV_ERR_COLUMN = 1,  // Selected column missing from the header
+    CSV_ERR_NUMBER = 2,  // Titre not numeric
+    CSV_ERR_OUTCOME = 3, // Outcome not 0 or 1
+    CSV_ERR_EMPTY = 4,   // No header or no data rows
+    CSV_ERR_QUOTE = 5    // Input ended inside a quoted field
+};
+
+class CsvParser {
+private:
+    char delimiter;
+    std::string titre_name, infected_name, group_name;
+    std::vector<std::string> biomarker_request;
+    
+    // Header, and the slot each header column is parsed into: biomarkers
+    // 0..B-1, then the outcome, then the group (-1: not read)
+    std::vector<std::string> header;
+    std::vector<std::string> biomarker_names;
+    std::string outcome_name;
+    std::vector<int> slot_of_column;
+    int infected_slot, group_slot;
+    bool header_done;
+    
+    // Parsed columns
+    std::vector<std::vector<double>> columns;
+    std::vector<int> infected;
+    std::vector<int> groups;
+    std::vector<std::string> group_names;
+    std::map<std::string, int> group_ids;
+    std::vector<double> range_min, range_max;
+    int num_infected;
+    int num_skipped;
+    
+    // State machine
+    std::string field;
+    std::vector<std::string> row; // Current row, by slot
+    size_t column;
+    bool blank_row, in_quotes, quote_closed, field_quoted;
+    int line, row_line;
+    int bom;  // Byte order mark bytes matched so far; -1 once past it
+    bool finished;
+    std::vector<double> values;
+    
+    int error;
+    int error_row;
+    std::string message;
+    std::vector<uint8_t> chunk;
+    
+    static bool is_blank(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+    
+    static std::string lower(std::string s) {
+        for (char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return s;
+    }
+    
+    bool set_error(int code, const std::string& text) {
+        error = code;
+        error_row = row_line;
+        message = text;
+        return false;
+    }
+    
+    // Header index of the column called name, or of the first alias when name is empty
+    int find_column(const std::string& name, std::initializer_list<const char*> aliases) const {
+        for (size_t i = 0; i < header.size(); ++i) {
+            const std::string h = lower(header[i]);
+            if (!name.empty()) {
+                if (h == lower(name)) return static_cast<int>(i);
+                continue;
+            }
+            for (const char* a : aliases) {
+                if (h == a) return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+    
+    bool resolve_header() {
+        header_done = true;
+        std::vector<int> picked;
+        if (!biomarker_request.empty()) {
+            for (const auto& name : biomarker_request) {
+                int c = find_column(name, {});
+                if (c < 0) return set_error(CSV_ERR_COLUMN, "Missing column: \"" + name + "\"");
+                picked.push_back(c);
+            }
+        } else {
+            int c = find_column(titre_name, {"titre", "titer", "antibody", "ab"});
+            if (c < 0) {
+                return set_error(CSV_ERR_COLUMN, titre_name.empty()
+                    ? "Missing required column: \"titre\" (or \"titer\", \"antibody\", \"ab\")"
+                    : "Missing column: \"" + titre_name + "\"");
+            }
+            picked.push_back(c);
+        }
+        int inf = find_column(infected_name, {"infected", "outcome", "status", "infection"});
+        if (inf < 0) {
+            return set_error(CSV_ERR_COLUMN, infected_name.empty()
+                ? "Missing required column: \"infected\" (or \"outcome\", \"status\", \"infection\")"
+                : "Missing column: \"" + infected_name + "\"");
+        }
+        picked.push_back(inf);
+        if (!group_name.empty()) {
+            int g = find_column(group_name, {});
+            if (g < 0) return set_error(CSV_ERR_COLUMN, "Missing column: \"" + group_name + "\"");
+            picked.push_back(g);
+        }
+        
+        const int num_biomarkers = static_cast<int>(picked.size()) - (group_name.empty() ? 1 : 2);
+        infected_slot = num_biomarkers;
+        group_slot = group_name.empty() ? -1 : num_biomarkers + 1;
+        slot_of_column.assign(header.size(), -1);
+        for (size_t s = 0; s < picked.size(); ++s) {
+            if (slot_of_column[picked[s]] >= 0) {
+                return set_error(CSV_ERR_COLUMN, "Column \"" + header[picked[s]] + "\" selected twice");
+            }
+            slot_of_column[picked[s]] = static_cast<int>(s);
+        }
+        for (int b = 0; b < num_biomarkers; ++b) biomarker_names.push_back(header[picked[b]]);
+        outcome_name = header[inf];
+        columns.assign(num_biomarkers, std::vector<double>());
+        range_min.assign(num_biomarkers, INFINITY);
+        range_max.assign(num_biomarkers, -INFINITY);
+        row.assign(picked.size(), std::string());
+        values.resize(num_biomarkers);
+        return true;
+    }
+    
+    // Whole-field number; false for empty, partial ("1.5x") or non-finite text
+    static bool parse_number(const std::string& s, double& v) {
+        const char* begin = s.c_str();
+        char* end = nullptr;
+        v = std::strtod(begin, &end);
+        return end != begin && *end == '\0' && std::isfinite(v);
+    }
+    
+    // Validate the whole row before appending, so the columns stay aligned
+    bool parse_row() {
+        for (const auto& f : row) {
+            if (f.empty()) {
+                num_skipped++;
+                return true;
+            }
+        }
+        for (size_t b = 0; b < values.size(); ++b) {
+            if (!parse_number(row[b], values[b])) {
+                return set_error(CSV_ERR_NUMBER, "Invalid " + biomarker_names[b] + " value at row " +
+                                 std::to_string(row_line) + ": \"" + row[b] + "\". Must be numeric.");
+            }
+        }
+        double y;
+        const std::string& outcome = row[infected_slot];
+        if (!parse_number(outcome, y) || (y != 0.0 && y != 1.0)) {
+            return set_error(CSV_ERR_OUTCOME, "Invalid " + outcome_name + " value at row " + std::to_string(row_line) +
+                             ": \"" + outcome + "\". Must be 0 (protected) or 1 (infected).");
+        }
+        
+        for (size_t b = 0; b < values.size(); ++b) {
+            columns[b].push_back(values[b]);
+            range_min[b] = std::min(range_min[b], values[b]);
+            range_max[b] = std::max(range_max[b], values[b]);
+        }
+        infected.push_back(y == 1.0 ? 1 : 0);
+        num_infected += y == 1.0 ? 1 : 0;
+        if (group_slot >= 0) {
+            auto it = group_ids.emplace(row[group_slot], static_cast<int>(group_names.size())).first;
+            if (it->second == static_cast<int>(group_names.size())) group_names.push_back(row[group_slot]);
+            groups.push_back(it->second);
+        }
+        return true;
+    }
+    
+    void end_field() {
+        size_t a = 0, b = field.size();
+        while (a < b && is_blank(field[a])) a++;
+        while (b > a && is_blank(field[b - 1])) b--;
+        if (b - a != field.size()) field = field.substr(a, b - a);
+        if (column > 0 || !field.empty() || field_quoted) blank_row = false;
+        
+        if (!header_done) {
+            header.push_back(field);
+        } else if (column < slot_of_column.size() && slot_of_column[column] >= 0) {
+            row[slot_of_column[column]].swap(field);
+        }
+        field.clear();
+        field_quoted = false;
+        column++;
+    }
+    
+    bool end_row() {
+        end_field();
+        bool ok = true;
+        if (!blank_row) ok = header_done ? parse_row() : resolve_header();
+        for (auto& f : row) f.clear();
+        if (!header_done) header.clear();
+        column = 0;
+        blank_row = true;
+        return ok;
+    }
+    
+    bool consume(char c) {
+        if (in_quotes) {
+            if (c == '"') {
+                in_quotes = false;
+                quote_closed = true;
+            } else {
+                if (c == '\n') line++;
+                field.push_back(c);
+            }
+            return true;
+        }
+        if (c == '"') {
+            if (quote_closed) {
+                // "" inside a quoted field
+                field.push_back('"');
+                in_quotes = true;
+                quote_closed = false;
+                return true;
+            }
+            if (!field_quoted && std::all_of(field.begin(), field.end(), is_blank)) {
+                field.clear();
+                in_quotes = true;
+                field_quoted = true;
+                return true;
+            }
+        }
+        quote_closed = false;
+        if (c == delimiter) {
+            end_field();
+        } else if (c == '\n') {
+            if (!end_row()) return false;
+            line++;
+            row_line = line;
+        } else {
+            field.push_back(c);
+        }
+        return true;
+    }
+    
+public:
+    CsvParser()
+        : delimiter(','), infected_slot(-1), group_slot(-1), header_done(false), num_infected(0), num_skipped(0),
+          column(0), blank_row(true), in_quotes(false), quote_closed(false), field_quoted(false),
+          line(1), row_line(1), bom(0), finished(false), error(CSV_OK), error_row(0) {}
+    
+    // Column selection; call before the first chunk. Empty names restore the defaults.
+    void set_delimiter(const std::string& d) { delimiter = d.empty() ? ',' : d[0]; }
+    void set_titre_column(const std::string& name) { titre_name = name; }
+    void set_infected_column(const std::string& name) { infected_name = name; }
+    void set_group_column(const std::string& name) { group_name = name; }
+    void add_biomarker_column(const std::string& name) { biomarker_request.push_back(name); }
+    
+    // Parse the next chunk; false once an error has been recorded
+    bool push(const char* bytes, size_t n) {
+        static const unsigned char mark[3] = {0xEF, 0xBB, 0xBF};
+        if (error != CSV_OK || finished) return error == CSV_OK;
+        for (size_t i = 0; i < n; ++i) {
+            if (bom >= 0) {
+                if (static_cast<unsigned char>(bytes[i]) == mark[bom]) {
+                    if (++bom == 3) bom = -1;
+                    continue;
+                }
+                const int matched = bom;
+                bom = -1;
+                for (int k = 0; k < matched; ++k) consume(static_cast<char>(mark[k]));
+            }
+            if (!consume(bytes[i])) return false;
+        }
+        return true;
+    }
+    
+    // End of input: parse a final row without a trailing newline
+    bool finish() {
+        if (error != CSV_OK || finished) return error == CSV_OK;
+        finished = true;
+        if (in_quotes) return set_error(CSV_ERR_QUOTE, "Unterminated quoted field in row " + std::to_string(row_line));
+        if ((column > 0 || !field.empty() || field_quoted) && !end_row()) return false;
+        if (!header_done) return set_error(CSV_ERR_EMPTY, "CSV file must have at least a header row and one data row");
+        if (infected.empty()) return set_error(CSV_ERR_EMPTY, "No valid data rows found in CSV");
+        return true;
+    }
+    
+#ifdef __EMSCRIPTEN__
+    // Chunk transfer from JS: resize_chunk(n), fill get_chunk_view() with
+    // Uint8Array.set(), then push_chunk(). The view is invalidated by heap growth.
+    void resize_chunk(int n) {
+        chunk.resize(std::max(0, n));
+    }
+    val get_chunk_view() {
+        return val(typed_memory_view(chunk.size(), chunk.data()));
+    }
+    bool push_chunk() {
+        return push(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+    }
+    
+    // Zero-copy views of the parsed columns; invalidated by heap growth
+    val column_view(int b) const {
+        return val(typed_memory_view(columns[b].size(), columns[b].data()));
+    }
+    val infected_view() const {
+        return val(typed_memory_view(infected.size(), infected.data()));
+    }
+#endif
+    
+    int get_error() const { return error; }
+    int get_error_row() const { return error_row; }
+    std::string get_error_message() const { return message; }
+    
+    int get_num_rows() const { return static_cast<int>(infected.size()); }
+    int get_num_skipped() const { return num_skipped; }
+    int get_num_infected() const { return num_infected; }
+    int get_num_biomarkers() const { return static_cast<int>(columns.size()); }
+    bool has_groups() const { return group_slot >= 0; }
+    std::vector<std::string> get_column_names() const { return header; }
+    std::vector<std::string> get_biomarker_names() const { return biomarker_names; }
+    std::vector<std::string> get_group_names() const { return group_names; }
+    
+    // [min, max] of biomarker b, kept while parsing
+    std::vector<double> get_titre_range(int b) const {
+        if (b < 0 || b >= get_num_biomarkers() || infected.empty()) return {0.0, 0.0};
+        return {range_min[b], range_max[b]};
+    }
+    
+    const std::vector<double>& get_column(int b) const { return columns[b]; }
+    const std::vector<int>& get_infected() const { return infected; }
+    const std::vector<int>& get_groups() const { return groups; }
+    
+    // Move biomarker b's titres into d (no copy; the parser's column is
+    // released) with the outcomes, then finalize d under its current
+    // compression and engine settings. False before a successful finish().
+    bool into_data(Data& d, int b) {
+        if (!finished || error != CSV_OK || b < 0 || b >= get_num_biomarkers()) return false;
+        d.titre.swap(columns[b]);
+        std::vector<double>().swap(columns[b]);
+        d.infected = infected;
+        d.finalize();
+        return true;
+    }
+};
+
+// 4PL infection probability at a given titre
+template <typename Real>
+inline Real prob_infection(const ParamsT<Real>& p, Real titre) {
+    return p.ceiling * (sigmoid(-p.slope * (titre - p.ec50)) * (Real(1) - p.floor) + p.floor);
+}
+
+// Curve models: the 4PL with the floor and/or the ceiling fixed at compile
+// time (floor = 0: no infections at high titre; ceiling = 1: every subject
+// without protection is infected). Fixed parameters hold their value in
+// Params, so likelihoods, draws and summaries keep the 4PL layout, while the
+// random walk, NUTS and the subsampler move only the D free coordinates of
+// z = (logit floor, logit ceiling, ec50, log slope). Support constraints
+// hold by construction.
+template <bool FreeFloor, bool FreeCeiling>
+struct CurveModel {
+    static constexpr int D = 2 + (FreeFloor ? 1 : 0) + (FreeCeiling ? 1 : 0);
+    static constexpr double FIXED_FLOOR = 0.0;
+    static constexpr double FIXED_CEILING = 1.0;
+    
+    // Whether Params field i (floor, ceiling, ec50, slope) is sampled
+    static constexpr bool is_free(int field) {
+        return field == 0 ? FreeFloor : field == 1 ? FreeCeiling : true;
+    }
+    
+    // Params field of free coordinate a
+    static constexpr int field(int a) {
+        return a + (FreeFloor ? 0 : 1) + (FreeCeiling || (FreeFloor && a == 0) ? 0 : 1);
+    }
+    
+    static void fix(Params& p) {
+        if (!FreeFloor) p.floor = FIXED_FLOOR;
+        if (!FreeCeiling) p.ceiling = FIXED_CEILING;
+    }
+    
+    // Log-prior density of the free parameters
+    static double log_prior(const Params& p, const Priors& priors) {
+        double lp = 0.0;
+        if (FreeFloor) lp += log_beta_pdf(p.floor, priors.floor_alpha, priors.floor_beta);
+        if (FreeCeiling) lp += log_beta_pdf(p.ceiling, priors.ceiling_alpha, priors.ceiling_beta);
+        lp += log_normal_pdf(p.ec50, priors.ec50_mean, priors.ec50_sd);
+        lp += log_truncated_normal_pdf(p.slope, priors.slope_mean, priors.slope_sd);
+        return lp;
+    }
+    
+    // Log-prior and its gradient over all four fields (zero where fixed)
+    static double log_prior_gradient(const Params& p, const Priors& priors, double grad[4]) {
+        grad[0] = FreeFloor ? (priors.floor_alpha - 1.0) / p.floor - (priors.floor_beta - 1.0) / (1.0 - p.floor) : 0.0;
+        grad[1] = FreeCeiling ? (priors.ceiling_alpha - 1.0) / p.ceiling - (priors.ceiling_beta - 1.0) / (1.0 - p.ceiling) : 0.0;
+        grad[2] = -(p.ec50 - priors.ec50_mean) / (priors.ec50_sd * priors.ec50_sd);
+        grad[3] = -(p.slope - priors.slope_mean) / (priors.slope_sd * priors.slope_sd);
+        return log_prior(p, priors);
+    }
+    
+    static void to_unconstrained(const Params& p, double z[D]) {
+        int a = 0;
+        if (FreeFloor) z[a++] = std::log(p.floor / (1.0 - p.floor));
+        if (FreeCeiling) z[a++] = std::log(p.ceiling / (1.0 - p.ceiling));
+        z[a++] = p.ec50;
+        z[a] = std::log(p.slope);
+    }
+    
+    static Params from_unconstrained(const double z[D]) {
+        int a = 0;
+        Params p;
+        p.floor = FreeFloor ? sigmoid(z[a++]) : FIXED_FLOOR;
+        p.ceiling = FreeCeiling ? sigmoid(z[a++]) : FIXED_CEILING;
+        p.ec50 = z[a++];
+        p.slope = std::exp(z[a]);
+        return p;
+    }
+    
+    // log |d theta / d z| of the map above; the target density in z-space is
+    // the (tempered) posterior times this Jacobian
+    static double log_jacobian(const Params& p) {
+        double lj = 0.0;
+        if (FreeFloor) {
+            lj += std::log(p.floor);
+            lj += std::log1p(-p.floor);
+        }
+        if (FreeCeiling) {
+            lj += std::log(p.ceiling);
+            lj += std::log1p(-p.ceiling);
+        }
+        return lj + std::log(p.slope);
+    }
+    
+    // Gradient in z of a log density plus log_jacobian, from the density's
+    // gradient g over the four Params fields
+    static void gradient_to_unconstrained(const Params& p, const double g[4], double gz[D]) {
+        int a = 0;
+        if (FreeFloor) gz[a++] = g[0] * p.floor * (1.0 - p.floor) + 1.0 - 2.0 * p.floor;
+        if (FreeCeiling) gz[a++] = g[1] * p.ceiling * (1.0 - p.ceiling) + 1.0 - 2.0 * p.ceiling;
+        gz[a++] = g[2];
+        gz[a] = g[3] * p.slope + 1.0;
+    }
+    
+    // Per-parameter diagnostics: NaN for fixed fields in reported vectors,
+    // and only the free entries for stopping rules
+    static std::vector<double> mask_fixed(std::vector<double> v) {
+        for (int i = 0; i < 4 && i < static_cast<int>(v.size()); ++i) {
+            if (!is_free(i)) v[i] = NAN;
+        }
+        return v;
+    }
+    
+    static std::vector<double> free_values(const std::vector<double>& v) {
+        std::vector<double> out;
+        for (int a = 0; a < D; ++a) out.push_back(v[field(a)]);
+        return out;
+    }
+};
+
+typedef CurveModel<true, true> Model4PL;
+typedef CurveModel<false, true> Model3PLZeroFloor;    // floor = 0
+typedef CurveModel<true, false> Model3PLUnitCeiling;  // ceiling = 1
+typedef CurveModel<false, false> Model2PL;            // floor = 0, ceiling = 1
+
+// Compute log-prior density (4PL)
+inline double log_prior(const Params& p, const Priors& priors) {
+    return Model4PL::log_prior(p, priors);
+}
+
+// Scalar reference log-likelihood over cells or raw rows
+inline double log_likelihood_scalar(const Params& p, const Data& data) {
+    double ll = 0.0;
+    if (data.compressed) {
+        // Binomial sum over distinct titres: cost scales with the number of cells, not N
+        const int n_cells = static_cast<int>(data.cell_titre.size());
+        for (int c = 0; c < n_cells; ++c) {
+            ll += log_binomial_kernel(data.cell_infected[c], data.cell_total[c], prob_infection(p, data.cell_titre[c]));
+            if (!std::isfinite(ll)) return -INFINITY;
+        }
+        return ll;
+    }
+    for (int i = 0; i < data.N; ++i) {
+        ll += log_bernoulli_pmf(data.infected[i], prob_infection(p, data.titre[i]));
+        if (!std::isfinite(ll)) return -INFINITY;
+    }
+    return ll;
+}
+
+// SIMD log-likelihood over an SoA block, written once for the double and
+// float lanes. Invalid probabilities are accumulated into a lane mask and
+// checked once after the loop; in that rare case the scalar engine resolves
+// the exact value.
+// SingleOutcome: each term has weight on only one of log(p), log(1-p)
+// (raw rows), so one log per term suffices.
+template <typename Real, bool SingleOutcome>
+inline double log_likelihood_simd_kernel(const Params& params, const Data& data, const SoaBlock<Real>& block) {
+    typedef SimdLanes<Real> L;
+    typedef typename L::vec vec;
+    typedef typename L::mask mask;
+    const ParamsT<Real> p(params);
+    const int n = static_cast<int>(block.titre.size());
+    const Real* x = block.titre.data();
+    const Real* w_pos = block.w_pos.data();
+    const Real* w_neg = block.w_neg.data();
+    
+    const vec slope = L::splat(p.slope);
+    const vec ec50 = L::splat(p.ec50);
+    const vec ceiling = L::splat(p.ceiling);
+    const vec floor_v = L::splat(p.floor);
+    const vec one_minus_floor = L::splat(Real(1) - p.floor);
+    const vec zero = L::splat(Real(0));
+    const vec one = L::splat(Real(1));
+    const vec tiny = L::splat(L::tiny());
+    
+    vec acc = zero;
+    mask invalid = L::none();
+    double total = 0.0;
+    int pending = 0;
+    for (int i = 0; i < n; i += L::width) {
+        vec t = *reinterpret_cast<const vec*>(x + i);
+        vec wp = *reinterpret_cast<const vec*>(w_pos + i);
+        vec wn = *reinterpret_cast<const vec*>(w_neg + i);
+        
+        // sigmoid(-slope*(t-ec50)) = 1 / (1 + exp(slope*(t-ec50)))
+        vec sig = one / (one + simd_exp(slope * (t - ec50)));
+        vec prob = ceiling * (sig * one_minus_floor + floor_v);
+        vec q = one - prob;
+        invalid |= (prob < tiny) | (q < tiny);
+        
+        if (SingleOutcome) {
+            acc += (wp + wn) * simd_log(simd_select(wp > zero, prob, q));
+        } else {
+            acc += wp * simd_log(prob) + wn * simd_log(q);
+        }
+        if (L::flush_every > 0 && ++pending == L::flush_every) {
+            total += L::sum(acc);
+            acc = zero;
+            pending = 0;
+        }
+    }
+    
+    if (L::any(invalid)) return log_likelihood_scalar(params, data);
+    double ll = total + L::sum(acc);
+    return std::isfinite(ll) ? ll : -INFINITY;
+}
+
+inline double log_likelihood_simd(const Params& p, const Data& data) {
+    return data.compressed ? log_likelihood_simd_kernel<double, false>(p, data, data.soa)
+                           : log_likelihood_simd_kernel<double, true>(p, data, data.soa);
+}
+
+// Single-precision kernel for ENGINE_MIXED's heated rungs: four lanes and
+// half the bytes per term, at a relative error of ~1e-6 on the total
+inline double log_likelihood_simd32(const Params& p, const Data& data) {
+    return data.compressed ? log_likelihood_simd_kernel<float, false>(p, data, data.soa32)
+                           : log_likelihood_simd_kernel<float, true>(p, data, data.soa32);
+}
+
+// Compute log-likelihood with the engine selected on the dataset; always
+// double precision
+inline double log_likelihood(const Params& p, const Data& data) {
+    if (data.engine != ENGINE_SCALAR) return log_likelihood_simd(p, data);
+    return log_likelihood_scalar(p, data);
+}
+
+// Log-likelihood for a rung at temperature > 1, where ENGINE_MIXED trades
+// precision for throughput: the heated rungs then target a float-rounded
+// tempered posterior, and cold swaps score both states at both precisions
+inline double log_likelihood_heated(const Params& p, const Data& data) {
+    if (data.engine == ENGINE_MIXED) return log_likelihood_simd32(p, data);
+    return log_likelihood(p, data);
+}
+
+// Compute tempered log-posterior
+inline double log_posterior_tempered(const Params& p, const Data& data, const Priors& priors, double temperature) {
+    double lp = log_prior(p, priors);
+    if (!std::isfinite(lp)) return -INFINITY;
+    double ll = log_likelihood(p, data);
+    if (!std::isfinite(ll)) return -INFINITY;
+    return lp + ll / temperature;
+}
+
+// Log-likelihood and its gradient with respect to (floor, ceiling, ec50, slope),
+// fused into one scalar pass over the cells (compressed) or rows
+inline double log_likelihood_gradient(const Params& p, const Data& data, double grad[4]) {
+    grad[0] = grad[1] = grad[2] = grad[3] = 0.0;
+    const bool cells = data.compressed;
+    const int n = cells ? static_cast<int>(data.cell_titre.size()) : data.N;
+    double ll = 0.0;
+    for (int i = 0; i < n; ++i) {
+        double t = cells ? data.cell_titre[i] : data.titre[i];
+        int k = cells ? data.cell_infected[i] : (data.infected[i] == 1 ? 1 : 0);
+        int m = cells ? data.cell_total[i] : 1;
+        
+        double s = sigmoid(-p.slope * (t - p.ec50));
+        double q = s * (1.0 - p.floor) + p.floor; // p / ceiling
+        double prob = p.ceiling * q;
+        if (prob <= 0.0 || prob >= 1.0) return -INFINITY;
+        ll += log_binomial_kernel(k, m, prob);
+        
+        // d ll / d prob, then the chain rule through the 4PL curve
+        double dprob = k / prob - (m - k) / (1.0 - prob);
+        double ds = p.ceiling * (1.0 - p.floor) * s * (1.0 - s);
+        grad[0] += dprob * p.ceiling * (1.0 - s);
+        grad[1] += dprob * q;
+        grad[2] += dprob * ds * p.slope;
+        grad[3] -= dprob * ds * (t - p.ec50);
+    }
+    return ll;
+}
+
+// Adaptive Metropolis (Haario et al. 2001) in unconstrained coordinates:
+// proposals are z + lambda * L * eps with L the Cholesky factor of the running
+// covariance of visited states scaled by 2.38^2 / d, so correlated directions
+// (ec50/slope, floor/ceiling) are explored along the posterior's own axes.
+// lambda is tuned towards 23.4% acceptance with a diminishing Robbins-Monro step.
+template <class Model>
+class ProposalDistribution {
+private:
+    static constexpr int D = Model::D;
+    static constexpr int ADAPT_EVERY = 50;  // Iterations per adaptation window
+    static constexpr int COV_START = 200;   // Visits before the empirical covariance is used
+    static constexpr double TARGET = 0.234; // Optimal acceptance (Roberts et al. 1997); flat near it for d = 2-4
+    
+    double chol[D][D]; // Lower-triangular proposal factor (before lambda)
+    double mean[D];
+    double m2[D][D];   // Sum of outer products of deviations (Welford)
+    double n;
+    double log_scale;  // log lambda
+    int window_accepted;
+    int window_total;
+    int rounds;
+    
+    // Factor (2.38^2 / d) * cov + eps * I; keeps the previous factor if the
+    // estimate is not positive definite
+    void refactor() {
+        double a[D][D];
+        const double s2 = 2.38 * 2.38 / D;
+        for (int i = 0; i < D; ++i) {
+            for (int j = 0; j < D; ++j) a[i][j] = s2 * m2[i][j] / (n - 1.0) + (i == j ? 1e-8 : 0.0);
+        }
+        double l[D][D] = {};
+        for (int j = 0; j < D; ++j) {
+            double d = a[j][j];
+            for (int k = 0; k < j; ++k) d -= l[j][k] * l[j][k];
+            if (!(d > 0.0)) return;
+            l[j][j] = std::sqrt(d);
+            for (int i = j + 1; i < D; ++i) {
+                double v = a[i][j];
+                for (int k = 0; k < j; ++k) v -= l[i][k] * l[j][k];
+                l[i][j] = v / l[j][j];
+            }
+        }
+        std::copy(&l[0][0], &l[0][0] + D * D, &chol[0][0]);
+    }
+    
+public:
+    ProposalDistribution() : n(0.0), log_scale(0.0), window_accepted(0), window_total(0), rounds(0) {
+        std::fill(&chol[0][0], &chol[0][0] + D * D, 0.0);
+        std::fill(mean, mean + D, 0.0);
+        std::fill(&m2[0][0], &m2[0][0] + D * D, 0.0);
+        for (int i = 0; i < D; ++i) chol[i][i] = 0.1; // Initial diagonal random walk
+    }
+    
+    // Record the chain's state after each step and adapt every ADAPT_EVERY steps
+    void update(const Params& state, bool accepted) {
+        double z[D];
+        Model::to_unconstrained(state, z);
+        n += 1.0;
+        double delta[D];
+        for (int i = 0; i < D; ++i) {
+            delta[i] = z[i] - mean[i];
+            mean[i] += delta[i] / n;
+        }
+        for (int i = 0; i < D; ++i) {
+            for (int j = 0; j < D; ++j) m2[i][j] += delta[i] * (z[j] - mean[j]);
+        }
+        
+        window_total++;
+        if (accepted) window_accepted++;
+        if (window_total == ADAPT_EVERY) {
+            rounds++;
+            double rate = static_cast<double>(window_accepted) / window_total;
+            log_scale += (rate - TARGET) / std::sqrt(static_cast<double>(rounds));
+            log_scale = std::max(-10.0, std::min(log_scale, 3.0));
+            window_accepted = 0;
+            window_total = 0;
+            if (n >= COV_START) refactor();
+        }
+    }
+    
+    void save(ByteWriter& out) const {
+        out.put(chol);
+        out.put(mean);
+        out.put(m2);
+        out.put(n);
+        out.put(log_scale);
+        out.put<int32_t>(window_accepted);
+        out.put<int32_t>(window_total);
+        out.put<int32_t>(rounds);
+    }
+    
+    bool load(ByteReader& in) {
+        in.get(chol);
+        in.get(mean);
+        in.get(m2);
+        in.get(n);
+        in.get(log_scale);
+        in.get(window_accepted);
+        in.get(window_total);
+        in.get(rounds);
+        return in.good();
+    }
+    
+    // Keep the current factor and scale but forget the moments and the
+    // Robbins-Monro schedule, so a warm-started chain re-tunes at full speed
+    void restart_adaptation() {
+        n = 0.0;
+        std::fill(mean, mean + D, 0.0);
+        std::fill(&m2[0][0], &m2[0][0] + D * D, 0.0);
+        window_accepted = 0;
+        window_total = 0;
+        rounds = 0;
+    }
+    
+    Params propose(const Params& current, RngStream& gen) {
+        double z[D], eps[D];
+        Model::to_unconstrained(current, z);
+        for (int i = 0; i < D; ++i) eps[i] = gen.normal();
+        const double lambda = std::exp(log_scale);
+        for (int i = 0; i < D; ++i) {
+            double step = 0.0;
+            for (int k = 0; k <= i; ++k) step += chol[i][k] * eps[k];
+            z[i] += lambda * step;
+        }
+        return Model::from_unconstrained(z);
+    }
+};
+
+// Running count, mean and sum of squared deviations (Welford)
+struct Moments {
+    double n;
+    double mean;
+    double m2;
+    
+    Moments() : n(0.0), mean(0.0), m2(0.0) {}
+    
+    void push(double x) {
+        n += 1.0;
+        double delta = x - mean;
+        mean += delta / n;
+        m2 += delta * (x - mean);
+    }
+    
+    // Combine with another block (Chan et al.)
+    void merge(const Moments& o) {
+        if (o.n == 0.0) return;
+        double total = n + o.n;
+        double delta = o.mean - mean;
+        mean += delta * o.n / total;
+        m2 += o.m2 + delta * delta * n * o.n / total;
+        n = total;
+    }
+    
+    double variance() const { return n > 1.0 ? m2 / (n - 1.0) : 0.0; }
+};
+
+// Chain move types
+enum MoveType {
+    MOVE_METROPOLIS = 0, // Adaptive-covariance random walk
+    MOVE_NUTS = 1        // No-U-turn HMC on analytic gradients
+};
+
+// Point on a Hamiltonian trajectory in unconstrained coordinates, with the
+// cached prior/likelihood terms of its position
+template <int D>
+struct PhasePoint {
+    double z[D];
+    double r[D];
+    double grad[D];
+    double log_target; // Tempered log-posterior plus log-Jacobian
+    double log_prior;
+    double log_lik;
+};
+
+// No-U-turn sampler (Hoffman & Gelman 2014) with multinomial trajectory
+// sampling and the generalized turning criterion (Betancourt 2017), as in
+// Stan. During warmup the step size follows dual averaging towards an 0.8
+// acceptance statistic and a diagonal metric is estimated from the draws.
+template <class Model>
+class NUTSKernel {
+private:
+    static constexpr int D = Model::D;
+    typedef ::PhasePoint<D> PhasePoint;
+    static constexpr int MAX_DEPTH = 10;
+    static constexpr double MAX_DELTA_H = 1000.0; // Energy error flagged as a divergence
+    
+    const Data* data;
+    const Priors* priors;
+    double inv_temp;
+    double inv_metric[D];
+    RngStream* gen;
+    HotCounters* counters;
+    
+    // Dual averaging state
+    double step_size;
+    double mu, s_bar, x_bar;
+    int da_count;
+    int adapt_until; // Adaptation runs for transitions before this
+    int transitions;
+    Moments metric_window[D];
+    
+    int n_leapfrog;
+    double sum_metro_prob;
+    
+    void evaluate(PhasePoint& pt) const {
+        Params theta = Model::from_unconstrained(pt.z);
+        double gp[4], gl[4] = {0.0, 0.0, 0.0, 0.0};
+        pt.log_prior = Model::log_prior_gradient(theta, *priors, gp);
+        if (std::isfinite(pt.log_prior)) {
+            counters->gradient();
+            pt.log_lik = log_likelihood_gradient(theta, *data, gl);
+        } else {
+            counters->prior_rejection();
+            pt.log_lik = -INFINITY;
+        }
+        pt.log_target = std::isfinite(pt.log_prior) && std::isfinite(pt.log_lik)
+            ? pt.log_prior + pt.log_lik * inv_temp + Model::log_jacobian(theta) : -INFINITY;
+        if (!std::isfinite(pt.log_target)) {
+            std::fill(pt.grad, pt.grad + D, 0.0);
+            return;
+        }
+        // Chain rule through (logit, logit, identity, log) plus the Jacobian's gradient
+        double g[4];
+        for (int i = 0; i < 4; ++i) g[i] = gp[i] + inv_temp * gl[i];
+        Model::gradient_to_unconstrained(theta, g, pt.grad);
+    }
+    
+    double hamiltonian(const PhasePoint& pt) const {
+        double k = 0.0;
+        for (int i = 0; i < D; ++i) k += pt.r[i] * pt.r[i] * inv_metric[i];
+        return -pt.log_target + 0.5 * k;
+    }
+    
+    void leapfrog(PhasePoint& pt, double eps) const {
+        for (int i = 0; i < D; ++i) pt.r[i] += 0.5 * eps * pt.grad[i];
+        for (int i = 0; i < D; ++i) pt.z[i] += eps * inv_metric[i] * pt.r[i];
+        evaluate(pt);
+        for (int i = 0; i < D; ++i) pt.r[i] += 0.5 * eps * pt.grad[i];
+    }
+    
+    void sharp(const double* r, double* out) const {
+        for (int i = 0; i < D; ++i) out[i] = inv_metric[i] * r[i];
+    }
+    
+    static bool no_uturn(const double* p_sharp_minus, const double* p_sharp_plus, const double* rho) {
+        double a = 0.0, b = 0.0;
+        for (int i = 0; i < D; ++i) {
+            a += p_sharp_plus[i] * rho[i];
+            b += p_sharp_minus[i] * rho[i];
+        }
+        return a > 0.0 && b > 0.0;
+    }
+    
+    static double log_sum_exp(double a, double b) {
+        if (a == -INFINITY) return b;
+        if (b == -INFINITY) return a;
+        double m = std::max(a, b);
+        return m + std::log(std::exp(a - m) + std::exp(b - m));
+    }
+    
+    // Extend the trajectory from `pt` by 2^depth leapfrog steps in direction
+    // sign; returns false on a divergence or a U-turn inside the subtree
+    bool build_tree(int depth, PhasePoint& pt, PhasePoint& propose,
+                    double* p_sharp_beg, double* p_sharp_end, double* rho,
+                    double* p_beg, double* p_end, double H0, double sign,
+                    double& log_sum_weight) {
+        if (depth == 0) {
+            leapfrog(pt, sign * step_size);
+            ++n_leapfrog;
+            double h = hamiltonian(pt);
+            if (std::isnan(h)) h = INFINITY;
+            if (h - H0 > MAX_DELTA_H) {
+                divergent = true;
+                return false;
+            }
+            log_sum_weight = log_sum_exp(log_sum_weight, H0 - h);
+            sum_metro_prob += H0 - h > 0.0 ? 1.0 : std::exp(H0 - h);
+            propose = pt;
+            for (int i = 0; i < D; ++i) rho[i] += pt.r[i];
+            sharp(pt.r, p_sharp_beg);
+            std::copy(p_sharp_beg, p_sharp_beg + D, p_sharp_end);
+            std::copy(pt.r, pt.r + D, p_beg);
+            std::copy(pt.r, pt.r + D, p_end);
+            return true;
+        }
+        
+        // First half
+        double p_sharp_init_end[D], p_init_end[D], rho_init[D] = {};
+        double log_sum_weight_init = -INFINITY;
+        if (!build_tree(depth - 1, pt, propose, p_sharp_beg, p_sharp_init_end, rho_init,
+                        p_beg, p_init_end, H0, sign, log_sum_weight_init)) return false;
+        
+        // Second half
+        PhasePoint propose_final;
+        double p_sharp_final_beg[D], p_final_beg[D], rho_final[D] = {};
+        double log_sum_weight_final = -INFINITY;
+        if (!build_tree(depth - 1, pt, propose_final, p_sharp_final_beg, p_sharp_end, rho_final,
+                        p_final_beg, p_end, H0, sign, log_sum_weight_final)) return false;
+        
+        // Multinomial sample between the halves
+        double log_sum_weight_subtree = log_sum_exp(log_sum_weight_init, log_sum_weight_final);
+        log_sum_weight = log_sum_exp(log_sum_weight, log_sum_weight_subtree);
+        if (log_sum_weight_final > log_sum_weight_subtree ||
+            gen->uniform() < std::exp(log_sum_weight_final - log_sum_weight_subtree)) {
+            propose = propose_final;
+        }
+        
+        // Turning checks across the whole subtree and both merged boundaries
+        double rho_subtree[D], rho_extended[D];
+        for (int i = 0; i < D; ++i) rho_subtree[i] = rho_init[i] + rho_final[i];
+        bool persist = no_uturn(p_sharp_beg, p_sharp_end, rho_subtree);
+        for (int i = 0; i < D; ++i) rho_extended[i] = rho_init[i] + p_final_beg[i];
+        persist = persist && no_uturn(p_sharp_beg, p_sharp_final_beg, rho_extended);
+        for (int i = 0; i < D; ++i) rho_extended[i] = rho_final[i] + p_init_end[i];
+        persist = persist && no_uturn(p_sharp_init_end, p_sharp_end, rho_extended);
+        for (int i = 0; i < D; ++i) rho[i] += rho_subtree[i];
+        return persist;
+    }
+    
+    void restart_dual_averaging() {
+        mu = std::log(10.0 * step_size);
+        s_bar = 0.0;
+        x_bar = 0.0;
+        da_count = 0;
+    }
+    
+    void adapt(double accept_stat, const double* z) {
+        // Dual averaging (Nesterov 2009) of log step size towards delta = 0.8
+        const double delta = 0.8, gamma = 0.05, kappa = 0.75, t0 = 10.0;
+        ++da_count;
+        double eta = 1.0 / (da_count + t0);
+        s_bar = (1.0 - eta) * s_bar + eta * (delta - std::min(1.0, accept_stat));
+        double x = mu - s_bar * std::sqrt(static_cast<double>(da_count)) / gamma;
+        double x_eta = std::pow(static_cast<double>(da_count), -kappa);
+        x_bar = (1.0 - x_eta) * x_bar + x_eta * x;
+        step_size = std::exp(x);
+        
+        // Diagonal metric from the middle of warmup (15%-75%), regularized
+        // towards the identity as in Stan; step size adaptation then restarts
+        int metric_begin = adapt_until * 15 / 100;
+        int metric_end = adapt_until * 75 / 100;
+        if (transitions >= metric_begin && transitions < metric_end) {
+            for (int i = 0; i < D; ++i) metric_window[i].push(z[i]);
+        }
+        if (transitions == metric_end - 1 && metric_window[0].n >= 10) {
+            double n = metric_window[0].n;
+            for (int i = 0; i < D; ++i) {
+                inv_metric[i] = (n / (n + 5.0)) * metric_window[i].variance() + 1e-3 * (5.0 / (n + 5.0));
+            }
+            restart_dual_averaging();
+        }
+        if (transitions == adapt_until - 1) step_size = std::exp(x_bar);
+    }
+    
+public:
+    bool divergent;     // Last transition ended in a divergence
+    int divergences;    // Post-warmup divergences
+    double mean_accept; // Running mean acceptance statistic
+    
+    NUTSKernel() : data(nullptr), priors(nullptr), inv_temp(1.0), gen(nullptr), counters(nullptr),
+                   step_size(0.1), adapt_until(0), transitions(0), n_leapfrog(0), sum_metro_prob(0.0),
+                   divergent(false), divergences(0), mean_accept(0.0) {
+        std::fill(inv_metric, inv_metric + D, 1.0);
+        restart_dual_averaging();
+    }
+    
+    // Adapt step size and metric over the next `warmup` transitions
+    void set_adaptation(int warmup) {
+        adapt_until = transitions + std::max(0, warmup);
+        restart_dual_averaging();
+    }
+    
+    double get_step_size() const { return step_size; }
+    
+    // Transitions left before adaptation ends (negative once it has ended)
+    int adaptation_remaining() const { return adapt_until - transitions; }
+    
+    // Adaptation and diagnostic state; the per-transition pointers are rebound
+    // by every transition()
+    void save(ByteWriter& out) const {
+        out.put(inv_metric);
+        out.put(step_size);
+        out.put(mu);
+        out.put(s_bar);
+        out.put(x_bar);
+        out.put<int32_t>(da_count);
+        out.put<int32_t>(adapt_until);
+        out.put<int32_t>(transitions);
+        out.put(metric_window);
+        out.put<int32_t>(n_leapfrog);
+        out.put(sum_metro_prob);
+        out.put<uint8_t>(divergent ? 1 : 0);
+        out.put<int32_t>(divergences);
+        out.put(mean_accept);
+    }
+    
+    bool load(ByteReader& in) {
+        uint8_t div = 0;
+        in.get(inv_metric);
+        in.get(step_size);
+        in.get(mu);
+        in.get(s_bar);
+        in.get(x_bar);
+        in.get(da_count);
+        in.get(adapt_until);
+        in.get(transitions);
+        in.get(metric_window);
+        in.get(n_leapfrog);
+        in.get(sum_metro_prob);
+        in.get(div);
+        in.get(divergences);
+        in.get(mean_accept);
+        divergent = div != 0;
+        return in.good();
+    }
+    
+    // One NUTS transition of the state `theta` (with cached lp/ll) at the given
+    // temperature; writes the new state back and returns true if it moved
+    bool transition(Params& theta, double& lp, double& ll, double temperature,
+                    const Data& d, const Priors& pr, RngStream& g, HotCounters& c) {
+        data = &d;
+        priors = &pr;
+        gen = &g;
+        counters = &c;
+        inv_temp = 1.0 / temperature;
+        
+        PhasePoint start;
+        Model::to_unconstrained(theta, start.z);
+        evaluate(start);
+        for (int i = 0; i < D; ++i) start.r[i] = g.normal() / std::sqrt(inv_metric[i]);
+        const double H0 = hamiltonian(start);
+        
+        PhasePoint fwd = start, bck = start, sample = start, propose = start;
+        double p_fwd_fwd[D], p_fwd_bck[D], p_bck_fwd[D], p_bck_bck[D];
+        double p_sharp_fwd_fwd[D], p_sharp_fwd_bck[D], p_sharp_bck_fwd[D], p_sharp_bck_bck[D];
+        double rho[D];
+        std::copy(start.r, start.r + D, p_fwd_fwd);
+        std::copy(start.r, start.r + D, p_fwd_bck);
+        std::copy(start.r, start.r + D, p_bck_fwd);
+        std::copy(start.r, start.r + D, p_bck_bck);
+        std::copy(start.r, start.r + D, rho);
+        sharp(start.r, p_sharp_fwd_fwd);
+        std::copy(p_sharp_fwd_fwd, p_sharp_fwd_fwd + D, p_sharp_fwd_bck);
+        std::copy(p_sharp_fwd_fwd, p_sharp_fwd_fwd + D, p_sharp_bck_fwd);
+        std::copy(p_sharp_fwd_fwd, p_sharp_fwd_fwd + D, p_sharp_bck_bck);
+        
+        double log_sum_weight = 0.0;
+        n_leapfrog = 0;
+        sum_metro_prob = 0.0;
+        divergent = false;
+        bool moved = false;
+        
+        for (int depth = 0; depth < MAX_DEPTH; ++depth) {
+            double rho_fwd[D] = {}, rho_bck[D] = {};
+            double log_sum_weight_subtree = -INFINITY;
+            bool valid;
+            if (g.uniform() > 0.5) {
+                std::copy(rho, rho + D, rho_bck);
+                std::copy(p_fwd_bck, p_fwd_bck + D, p_bck_fwd);
+                std::copy(p_sharp_fwd_bck, p_sharp_fwd_bck + D, p_sharp_bck_fwd);
+                valid = build_tree(depth, fwd, propose, p_sharp_fwd_bck, p_sharp_fwd_fwd, rho_fwd,
+                                   p_fwd_bck, p_fwd_fwd, H0, 1.0, log_sum_weight_subtree);
+            } else {
+                std::copy(rho, rho + D, rho_fwd);
+                std::copy(p_bck_fwd, p_bck_fwd + D, p_fwd_bck);
+                std::copy(p_sharp_bck_fwd, p_sharp_bck_fwd + D, p_sharp_fwd_bck);
+                valid = build_tree(depth, bck, propose, p_sharp_bck_fwd, p_sharp_bck_bck, rho_bck,
+                                   p_bck_fwd, p_bck_bck, H0, -1.0, log_sum_weight_subtree);
+            }
+            if (!valid) break;
+            
+            // Biased progressive sampling favours the new subtree
+            if (log_sum_weight_subtree > log_sum_weight ||
+                g.uniform() < std::exp(log_sum_weight_subtree - log_sum_weight)) {
+                sample = propose;
+                moved = true;
+            }
+            log_sum_weight = log_sum_exp(log_sum_weight, log_sum_weight_subtree);
+            
+            double rho_extended[D];
+            for (int i = 0; i < D; ++i) rho[i] = rho_bck[i] + rho_fwd[i];
+            bool persist = no_uturn(p_sharp_bck_bck, p_sharp_fwd_fwd, rho);
+            for (int i = 0; i < D; ++i) rho_extended[i] = rho_bck[i] + p_fwd_bck[i];
+            persist = persist && no_uturn(p_sharp_bck_bck, p_sharp_fwd_bck, rho_extended);
+            for (int i = 0; i < D; ++i) rho_extended[i] = rho_fwd[i] + p_bck_fwd[i];
+            persist = persist && no_uturn(p_sharp_bck_fwd, p_sharp_fwd_fwd, rho_extended);
+            if (!persist) break;
+        }
+        
+        double accept_stat = n_leapfrog > 0 ? sum_metro_prob / n_leapfrog : 0.0;
+        if (transitions < adapt_until) {
+            adapt(accept_stat, sample.z);
+        } else if (divergent) {
+            ++divergences;
+        }
+        ++transitions;
+        mean_accept += (accept_stat - mean_accept) / transitions;
+        
+        if (moved) {
+            theta = Model::from_unconstrained(sample.z);
+            lp = sample.log_prior;
+            ll = sample.log_lik;
+        }
+        return moved;
+    }
+};
+
+// Streaming summary of one parameter's trace: adaptive batch means. Draws
+// fill equal-size batches; when MAX_BATCHES are full, adjacent pairs merge
+// and the batch size doubles, so memory stays O(MAX_BATCHES). Diagnostics
+// over the batches starting at or after a given draw cost O(MAX_BATCHES).
+class OnlineTrace {
+private:
+    static constexpr int MAX_BATCHES = 128;
+    std::vector<Moments> batches;
+    Moments partial;
+    long batch_size;
+    
+    // Index of the first complete batch starting at or after draw `first`
+    size_t first_batch(long first) const {
+        long b = first <= 0 ? 0 : (first + batch_size - 1) / batch_size;
+        return std::min(static_cast<size_t>(b), batches.size());
+    }
+    
+public:
+    OnlineTrace() : batch_size(1) { batches.reserve(MAX_BATCHES); }
+    
+    void push(double x) {
+        partial.push(x);
+        if (partial.n < batch_size) return;
+        batches.push_back(partial);
+        partial = Moments();
+        if (static_cast<int>(batches.size()) == MAX_BATCHES) {
+            for (int i = 0; i < MAX_BATCHES / 2; ++i) {
+                Moments merged = batches[2 * i];
+                merged.merge(batches[2 * i + 1]);
+                batches[i] = merged;
+            }
+            batches.resize(MAX_BATCHES / 2);
+            batch_size *= 2;
+        }
+    }
+    
+    void save(ByteWriter& out) const {
+        out.put_vector(batches);
+        out.put(partial);
+        out.put<int64_t>(batch_size);
+    }
+    
+    bool load(ByteReader& in) {
+        int64_t size = 1;
+        in.get_vector(batches);
+        in.get(partial);
+        in.get(size);
+        if (!in.good() || size < 1 || batches.size() >= MAX_BATCHES) return in.fail();
+        batch_size = static_cast<long>(size);
+        batches.reserve(MAX_BATCHES);
+        return true;
+    }
+    
+    // Number of complete batches after draw `first`
+    int num_batches(long first) const {
+        return static_cast<int>(batches.size() - first_batch(first));
+    }
+    
+    // Moments of batches [from, to)
+    Moments range(size_t from, size_t to) const {
+        Moments m;
+        for (size_t i = from; i < to; ++i) m.merge(batches[i]);
+        return m;
+    }
+    
+    // First and second half of the batches after draw `first`, for split R-hat
+    void split_halves(long first, Moments& a, Moments& b) const {
+        size_t start = first_batch(first);
+        size_t half = (batches.size() - start) / 2;
+        a = range(start, start + half);
+        b = range(batches.size() - half, batches.size());
+    }
+    
+    // Batch-means ESS: n * var / (batch_size * var(batch means)), capped at n
+    double ess(long first) const {
+        size_t start = first_batch(first);
+        size_t count = batches.size() - start;
+        if (count < 4) return 0.0;
+        Moments all = range(start, batches.size());
+        Moments means;
+        for (size_t i = start; i < batches.size(); ++i) means.push(batches[i].mean);
+        double var_means = means.variance();
+        if (var_means <= 0.0) return all.n;
+        return std::min(all.n, all.n * all.variance() / (batch_size * var_means));
+    }
+};
+
+// Potential scale reduction from per-chain moments (chains of similar length)
+inline double rhat_from_moments(const std::vector<Moments>& chains) {
+    const size_t m = chains.size();
+    if (m < 2) return 1.0;
+    double n = chains[0].n;
+    Moments means;
+    double w = 0.0;
+    for (const auto& c : chains) {
+        n = std::min(n, c.n);
+        means.push(c.mean);
+        w += c.variance() / m;
+    }
+    if (n < 2.0 || w <= 0.0) return 1.0;
+    return std::sqrt(((n - 1.0) / n * w + means.variance()) / w);
+}
+
+// Which draws a ladder keeps in memory
+struct RetentionPolicy {
+    int store_rungs;    // Number of coldest rungs that store draws (<= 0: all)
+    int thin;           // Keep every thin-th iteration
+    int discard_warmup; // Iterations before this are not stored
+    int capacity;       // > 0: ring buffer holding only the latest `capacity` draws
+    
+    RetentionPolicy() : store_rungs(1), thin(1), discard_warmup(0), capacity(0) {}
+};
+
+// How checkpoints store retained draws (chain states are always exact)
+enum DrawEncoding {
+    DRAWS_FLOAT64 = 0, // Exact, 32 bytes per draw
+    DRAWS_FLOAT32 = 1, // Rounded to single precision, 16 bytes per draw
+    DRAWS_DELTA = 2    // Exact: XOR with the previous draw, varint-packed. A
+                       // repeated draw (rejected proposal) takes 4 bytes.
+};
+
+// Retained draws of one chain. Draw k (in recording order) belongs to
+// iteration start + k * thin; ring mode overwrites the oldest draws.
+// Storage is sized once from the requested iteration count.
+class DrawStore {
+private:
+    std::vector<Params> buffer;
+    bool enabled;
+    int start;
+    int thin;
+    int capacity;
+    long recorded; // Draws recorded so far, including overwritten ones
+    
+    size_t head() const {
+        return capacity > 0 && recorded > capacity ? static_cast<size_t>(recorded % capacity) : 0;
+    }
+    
+public:
+    DrawStore() : enabled(true), start(0), thin(1), capacity(0), recorded(0) {}
+    
+    void configure(bool store, const RetentionPolicy& policy) {
+        enabled = store;
+        start = std::max(0, policy.discard_warmup);
+        thin = std::max(1, policy.thin);
+        capacity = std::max(0, policy.capacity);
+        recorded = 0;
+        buffer.clear();
+        buffer.shrink_to_fit();
+        if (enabled && capacity > 0) buffer.reserve(capacity);
+    }
+    
+    // Preallocate for a run that ends at iteration `end`
+    void reserve_until(int end) {
+        if (!enabled || capacity > 0 || end <= start) return;
+        buffer.reserve((end - start + thin - 1) / thin);
+    }
+    
+    void record(int iteration, const Params& p) {
+        if (!enabled || iteration < start || (iteration - start) % thin != 0) return;
+        if (capacity > 0 && recorded >= capacity) {
+            buffer[recorded % capacity] = p;
+        } else {
+            buffer.push_back(p);
+        }
+        recorded++;
+    }
+    
+    size_t size() const { return buffer.size(); }
+    
+    // i-th retained draw in chronological order
+    const Params& operator[](size_t i) const {
+        size_t idx = head() + i;
+        return buffer[idx >= buffer.size() ? idx - buffer.size() : idx];
+    }
+    
+    int iteration_of(size_t i) const {
+        return start + static_cast<int>(recorded - buffer.size() + i) * thin;
+    }
+    
+    // Index of the first retained draw at or after `iteration`
+    size_t first_index_from(int iteration) const {
+        long k = iteration <= start ? 0 : (iteration - start + thin - 1) / thin;
+        long oldest = recorded - static_cast<long>(buffer.size());
+        return static_cast<size_t>(std::min(std::max(0L, k - oldest), static_cast<long>(buffer.size())));
+    }
+    
+    void save(ByteWriter& out, int encoding) const {
+        out.put<uint8_t>(enabled ? 1 : 0);
+        out.put<int32_t>(start);
+        out.put<int32_t>(thin);
+        out.put<int32_t>(capacity);
+        out.put<int64_t>(recorded);
+        out.put<uint64_t>(buffer.size());
+        static double Params::* const fields[] = {&Params::floor, &Params::ceiling, &Params::ec50, &Params::slope};
+        for (const auto field : fields) {
+            uint64_t prev = 0;
+            for (const Params& p : buffer) {
+                if (encoding == DRAWS_FLOAT32) {
+                    out.put(static_cast<float>(p.*field));
+                } else if (encoding == DRAWS_DELTA) {
+                    uint64_t bits;
+                    std::memcpy(&bits, &(p.*field), sizeof bits);
+                    out.put_varint(bits ^ prev);
+                    prev = bits;
+                } else {
+                    out.put(p.*field);
+                }
+            }
+        }
+    }
+    
+    bool load(ByteReader& in, int encoding) {
+        uint8_t on = 0;
+        int64_t count = 0;
+        uint64_t n = 0;
+        in.get(on);
+        in.get(start);
+        in.get(thin);
+        in.get(capacity);
+        in.get(count);
+        in.get(n);
+        const size_t min_bytes = encoding == DRAWS_FLOAT64 ? 32 : encoding == DRAWS_FLOAT32 ? 16 : 4;
+        // record() and operator[] rely on the buffer holding exactly the
+        // latest min(recorded, capacity) draws (all of them without a ring)
+        const int64_t expected = capacity > 0 ? std::min<int64_t>(count, capacity) : count;
+        if (!in.good() || start < 0 || thin < 1 || capacity < 0 || count < 0 || static_cast<int64_t>(n) != expected ||
+            n > in.remaining() / min_bytes) {
+            return in.fail();
+        }
+        enabled = on != 0;
+        recorded = static_cast<long>(count);
+        buffer.assign(static_cast<size_t>(n), Params());
+        if (capacity > 0) buffer.reserve(capacity);
+        static double Params::* const fields[] = {&Params::floor, &Params::ceiling, &Params::ec50, &Params::slope};
+        for (const auto field : fields) {
+            uint64_t prev = 0;
+            for (Params& p : buffer) {
+                if (encoding == DRAWS_FLOAT32) {
+                    float v = 0.0f;
+                    in.get(v);
+                    p.*field = v;
+                } else if (encoding == DRAWS_DELTA) {
+                    uint64_t d = 0;
+                    in.get_varint(d);
+                    prev ^= d;
+                    std::memcpy(&(p.*field), &prev, sizeof prev);
+                } else {
+                    in.get(p.*field);
+                }
+            }
+        }
+        return in.good();
+    }
+    
+    // Retained draws from `iteration` on, in chronological order
+    std::vector<Params> to_vector(int iteration) const {
+        std::vector<Params> out;
+        size_t first = first_index_from(iteration);
+        out.reserve(size() - first);
+        for (size_t i = first; i < size(); ++i) out.push_back((*this)[i]);
+        return out;
+    }
+};
+
+// Centre of the priors, in the support: the starting point for mode searches
+inline Params prior_centre(const Priors& p) {
+    return Params(p.floor_alpha / (p.floor_alpha + p.floor_beta),
+                  p.ceiling_alpha / (p.ceiling_alpha + p.ceiling_beta),
+                  p.ec50_mean,
+                  p.slope_mean > 0.0 ? p.slope_mean : std::max(0.1, 0.5 * p.slope_sd));
+}
+
+// Control-variate subsampling of the likelihood for very large cohorts
+// (Bardenet et al. 2017; Quiroz et al. 2019). Every term l_i (a subject, or a
+// binomial cell of compressed data) gets a second-order Taylor proxy q_i
+// around an anchor z* near the posterior mode, in unconstrained coordinates.
+// Sum_i q_i(z) is O(1) from three precomputed sums, so a random-walk step
+// only evaluates l_j - q_j on a uniform subsample of m terms:
+//
+//   Delta_hat = [Q(z') - Q(z)] + (n / m) sum_j [d_j(z') - d_j(z)],  d = l - q
+//
+// with variance sigma^2 = n^2 / m * Var_j(d_j(z') - d_j(z)), estimated from
+// the same subsample. The MH ratio uses the penalty correction of Ceperley &
+// Dewing (1999), Delta_hat / T - sigma^2 / (2 T^2), which removes the bias of
+// a noisy Gaussian log ratio. Hotter rungs take m / T terms: their targets are
+// flatter, so the same tempered noise needs fewer. The residuals d are
+// O(|z - z*|^3), so m in the hundreds is typically enough whatever n is.
+template <class Model>
+class LikelihoodSubsampler {
+public:
+    // Largest tempered variance sigma^2 / T^2 a step accepts; noisier
+    // estimates (far from the anchor) fall back to the full likelihood
+    static constexpr double MAX_VARIANCE = 4.0;
+    
+private:
+    static constexpr int D = Model::D;
+    static constexpr int MIN_BATCH = 16;
+    
+    std::shared_ptr<const Data> data;
+    double anchor[D];
+    double sum0;        // sum_i l_i(z*)
+    double sum1[D];     // sum_i grad l_i(z*)
+    double sum2[D][D];  // sum_i Hessian l_i(z*)
+    int n_terms;
+    int batch_size;
+    
+    void term_data(int i, double& t, int& k, int& m) const {
+        if (data->compressed) {
+            t = data->cell_titre[i];
+            k = data->cell_infected[i];
+            m = data->cell_total[i];
+        } else {
+            t = data->titre[i];
+            k = data->infected[i] == 1 ? 1 : 0;
+            m = 1;
+        }
+    }
+    
+    // Value, gradient and Hessian of one term at unconstrained z, by the chain
+    // rule through the 4PL curve prob(z); fixed parameters drop out as rows
+    // and columns. Returns false outside the support.
+    static bool expand_term(double t, int k, int m, const double z[D], double& l, double g[D], double h[D][D]) {
+        const Params theta = Model::from_unconstrained(z);
+        const double f = theta.floor, c = theta.ceiling, b = theta.slope;
+        const double v = -b * (t - theta.ec50);
+        const double s = sigmoid(v);
+        const double prob = c * ((1.0 - f) * s + f);
+        if (!(prob > 0.0 && prob < 1.0)) return false;
+        l = log_binomial_kernel(k, m, prob);
+        
+        const double F = f * (1.0 - f), C = c * (1.0 - c), A = c * (1.0 - f);
+        const double w = s * (1.0 - s), w1 = w * (1.0 - 2.0 * s); // sigma', sigma''
+        const double q = (1.0 - f) * s + f;
+        const double s2 = w * b, s3 = w * v;  // ds/dz2, ds/dz3
+        double dp[4] = {c * F * (1.0 - s), C * q, A * s2, A * s3};
+        double d2p[4][4];
+        d2p[0][0] = c * F * (1.0 - 2.0 * f) * (1.0 - s);
+        d2p[0][1] = C * F * (1.0 - s);
+        d2p[0][2] = -c * F * s2;
+        d2p[0][3] = -c * F * s3;
+        d2p[1][1] = C * (1.0 - 2.0 * c) * q;
+        d2p[1][2] = C * (1.0 - f) * s2;
+        d2p[1][3] = C * (1.0 - f) * s3;
+        d2p[2][2] = A * w1 * b * b;
+        d2p[2][3] = A * (w1 * b * v + w * b);
+        d2p[3][3] = A * (w1 * v * v + w * v);
+        
+        const double dl = k / prob - (m - k) / (1.0 - prob);
+        const double d2l = -k / (prob * prob) - (m - k) / ((1.0 - prob) * (1.0 - prob));
+        for (int a = 0; a < D; ++a) {
+            const int i = Model::field(a);
+            g[a] = dl * dp[i];
+            for (int e = a; e < D; ++e) {
+                const int j = Model::field(e);
+                h[a][e] = h[e][a] = d2l * dp[i] * dp[j] + dl * d2p[i][j];
+            }
+        }
+        return true;
+    }
+    
+    // Full pass: sums of values, gradients and Hessians at z
+    bool expand_all(const double z[D], double& s0, double s1[D], double s2[D][D]) const {
+        s0 = 0.0;
+        std::fill(s1, s1 + D, 0.0);
+        std::fill(&s2[0][0], &s2[0][0] + D * D, 0.0);
+        double l, g[D], h[D][D], t;
+        int k, m;
+        for (int i = 0; i < n_terms; ++i) {
+            term_data(i, t, k, m);
+            if (!expand_term(t, k, m, z, l, g, h)) return false;
+            s0 += l;
+            for (int a = 0; a < D; ++a) {
+                s1[a] += g[a];
+                for (int e = 0; e < D; ++e) s2[a][e] += h[a][e];
+            }
+        }
+        return true;
+    }
+    
+    static double log_prior_z(const double z[D], const Priors& priors) {
+        Params p = Model::from_unconstrained(z);
+        return Model::log_prior(p, priors) + Model::log_jacobian(p);
+    }
+    
+    // Posterior mode in z by Levenberg-Marquardt on the full data: analytic
+    // likelihood derivatives, finite differences for the (cheap) prior
+    void find_anchor(const Priors& priors, const double start[D]) {
+        double z[D];
+        std::copy(start, start + D, z);
+        double s0, s1[D], s2[D][D];
+        double lambda = 1e-3;
+        for (int iter = 0; iter < 50; ++iter) {
+            if (!expand_all(z, s0, s1, s2)) break;
+            const double f0 = s0 + log_prior_z(z, priors);
+            double g[D], h[D][D];
+            const double eps = 1e-4;
+            for (int a = 0; a < D; ++a) {
+                double zp[D], zm[D];
+                std::copy(z, z + D, zp);
+                std::copy(z, z + D, zm);
+                zp[a] += eps;
+                zm[a] -= eps;
+                double fp = log_prior_z(zp, priors), fm = log_prior_z(zm, priors), fc = log_prior_z(z, priors);
+                g[a] = s1[a] + (fp - fm) / (2.0 * eps);
+                h[a][a] = s2[a][a] + (fp - 2.0 * fc + fm) / (eps * eps);
+                for (int e = 0; e < a; ++e) {
+                    double zpp[D], zpm[D], zmp[D], zmm[D];
+                    std::copy(z, z + D, zpp);
+                    std::copy(z, z + D, zpm);
+                    std::copy(z, z + D, zmp);
+                    std::copy(z, z + D, zmm);
+                    zpp[a] += eps; zpp[e] += eps;
+                    zpm[a] += eps; zpm[e] -= eps;
+                    zmp[a] -= eps; zmp[e] += eps;
+                    zmm[a] -= eps; zmm[e] -= eps;
+                    double mixed = (log_prior_z(zpp, priors) - log_prior_z(zpm, priors) -
+                                    log_prior_z(zmp, priors) + log_prior_z(zmm, priors)) / (4.0 * eps * eps);
+                    h[a][e] = h[e][a] = s2[a][e] + mixed;
+                }
+            }
+            
+            bool improved = false;
+            double step_norm = 0.0;
+            while (lambda < 1e12) {
+                double step[D];
+                if (!solve_damped(h, g, lambda, step)) {
+                    lambda *= 10.0;
+                    continue;
+                }
+                double zn[D];
+                for (int a = 0; a < D; ++a) zn[a] = z[a] + step[a];
+                double ll = log_likelihood(Model::from_unconstrained(zn), *data);
+                double fn = std::isfinite(ll) ? ll + log_prior_z(zn, priors) : -INFINITY;
+                if (std::isfinite(fn) && fn >= f0) {
+                    step_norm = 0.0;
+                    for (int a = 0; a < D; ++a) step_norm = std::max(step_norm, std::fabs(step[a]));
+                    std::copy(zn, zn + D, z);
+                    lambda = std::max(1e-9, lambda / 10.0);
+                    improved = true;
+                    break;
+                }
+                lambda *= 10.0;
+            }
+            if (!improved || step_norm < 1e-8) break;
+        }
+        std::copy(z, z + D, anchor);
+    }
+    
+    // Solve (-H + lambda * diag(|H|) + lambda * I) x = g by Cholesky; false
+    // if the damped matrix is not positive definite
+    static bool solve_damped(const double h[D][D], const double g[D], double lambda, double x[D]) {
+        double a[D][D], l[D][D] = {};
+        for (int i = 0; i < D; ++i) {
+            for (int j = 0; j < D; ++j) a[i][j] = -h[i][j];
+            a[i][i] += lambda * (std::fabs(h[i][i]) + 1.0);
+        }
+        for (int j = 0; j < D; ++j) {
+            double d = a[j][j];
+            for (int k = 0; k < j; ++k) d -= l[j][k] * l[j][k];
+            if (!(d > 0.0)) return false;
+            l[j][j] = std::sqrt(d);
+            for (int i = j + 1; i < D; ++i) {
+                double v = a[i][j];
+                for (int k = 0; k < j; ++k) v -= l[i][k] * l[j][k];
+                l[i][j] = v / l[j][j];
+            }
+        }
+        double y[D];
+        for (int i = 0; i < D; ++i) {
+            double v = g[i];
+            for (int k = 0; k < i; ++k) v -= l[i][k] * y[k];
+            y[i] = v / l[i][i];
+        }
+        for (int i = D - 1; i >= 0; --i) {
+            double v = y[i];
+            for (int k = i + 1; k < D; ++k) v -= l[k][i] * x[k];
+            x[i] = v / l[i][i];
+        }
+        return true;
+    }
+    
+    // Proxy sum Q(z) = sum_i q_i(z)
+    double proxy_sum(const double dz[D]) const {
+        double q = sum0;
+        for (int a = 0; a < D; ++a) {
+            q += sum1[a] * dz[a];
+            for (int e = 0; e < D; ++e) q += 0.5 * dz[a] * sum2[a][e] * dz[e];
+        }
+        return q;
+    }
+    
+public:
+    // Anchor at the posterior mode found from `start` (typically the prior
+    // centre); batch_size is the cold rung's subsample size
+    LikelihoodSubsampler(std::shared_ptr<const Data> d, const Priors& priors, const Params& start, int batch)
+        : data(std::move(d)), sum0(0.0), batch_size(std::max(MIN_BATCH, batch)) {
+        n_terms = data->get_num_cells();
+        double z0[D];
+        Model::to_unconstrained(start, z0);
+        find_anchor(priors, z0);
+        if (!expand_all(anchor, sum0, sum1, sum2)) n_terms = 0; // Degenerate: never subsample
+    }
+    
+    int get_num_terms() const { return n_terms; }
+    int get_batch_size() const { return batch_size; }
+    Params get_anchor() const { return Model::from_unconstrained(anchor); }
+    
+    // Subsample size at temperature T; >= the term count means "use full data"
+    int batch_for(double temperature) const {
+        return std::max(MIN_BATCH, static_cast<int>(std::ceil(batch_size / temperature)));
+    }
+    bool subsamples(double temperature) const { return batch_for(temperature) < n_terms; }
+    
+    // Estimate l(to) - l(from) on a fresh subsample of m terms. Writes the
+    // estimator's variance and the estimate of l(to) itself (for swaps).
+    double estimate_difference(const Params& from, const Params& to, int m, RngStream& gen,
+                               double& variance, double& to_estimate) const {
+        double zf[D], zt[D], df[D], dt[D];
+        Model::to_unconstrained(from, zf);
+        Model::to_unconstrained(to, zt);
+        for (int a = 0; a < D; ++a) {
+            df[a] = zf[a] - anchor[a];
+            dt[a] = zt[a] - anchor[a];
+        }
+        const double qf = proxy_sum(df), qt = proxy_sum(dt);
+        
+        Moments diff, resid;
+        double l0 = 0.0, g[D] = {}, h[D][D] = {}, t;
+        int k, total;
+        for (int j = 0; j < m; ++j) {
+            int i = std::min(n_terms - 1, static_cast<int>(gen.uniform() * n_terms));
+            term_data(i, t, k, total);
+            expand_term(t, k, total, anchor, l0, g, h);
+            double qi_f = l0, qi_t = l0;
+            for (int a = 0; a < D; ++a) {
+                qi_f += g[a] * df[a];
+                qi_t += g[a] * dt[a];
+                for (int e = 0; e < D; ++e) {
+                    qi_f += 0.5 * df[a] * h[a][e] * df[e];
+                    qi_t += 0.5 * dt[a] * h[a][e] * dt[e];
+                }
+            }
+            double pt = prob_infection(to, t);
+            double lt = log_binomial_kernel(k, total, pt);
+            if (!std::isfinite(lt)) {
+                variance = 0.0;
+                to_estimate = -INFINITY;
+                return -INFINITY;
+            }
+            double lf = log_binomial_kernel(k, total, prob_infection(from, t));
+            diff.push((lt - qi_t) - (lf - qi_f));
+            resid.push(lt - qi_t);
+        }
+        const double scale = static_cast<double>(n_terms);
+        variance = m > 1 ? scale * scale / m * diff.m2 / (m - 1) : 0.0;
+        to_estimate = qt + scale * resid.mean;
+        return qt - qf + scale * diff.mean;
+    }
+};
+
+// Single MCMC chain at given temperature
+template <class Model>
+class MCMCChain {
+private:
+    Params current;
+    // Prior and untempered likelihood are cached separately, so that moving a
+    // state to another temperature only re-tempers these numbers
+    double current_log_prior;
+    double current_log_lik;
+    double current_log_posterior;
+    double temperature;
+    ProposalDistribution<Model> proposal;
+    int move;               // MoveType
+    NUTSKernel<Model> nuts; // Used when move == MOVE_NUTS
+    RngStream chain_rng; // Per-chain stream: chains can step on different threads
+    int accepted;
+    int total;
+    
+    // The likelihood at p, skipped when the prior already rules p out.
+    // Heated rungs take the engine's reduced-precision path, if it has one.
+    double evaluate_likelihood(const Params& p, double lp, const Data& data) {
+        if (!std::isfinite(lp)) {
+            counters.prior_rejection();
+            return -INFINITY;
+        }
+        counters.likelihood();
+        return temperature > 1.0 ? log_likelihood_heated(p, data) : log_likelihood(p, data);
+    }
+    
+    bool metropolis_step(const Data& data, const Priors& priors, const LikelihoodSubsampler<Model>* sub) {
+        // Propose new state; the likelihood is skipped when the prior rules it out
+        Params proposed = proposal.propose(current, chain_rng);
+        counters.proposal();
+        double proposed_log_prior = Model::log_prior(proposed, priors);
+        double proposed_log_lik, log_alpha;
+        
+        // Metropolis-Hastings acceptance for the symmetric walk in unconstrained
+        // coordinates, so the Jacobian of the transform enters the ratio
+        const double log_jacobian_ratio = Model::log_jacobian(proposed) - Model::log_jacobian(current);
+        if (sub && std::isfinite(proposed_log_prior) && sub->subsamples(temperature)) {
+            // Noisy likelihood ratio from a subsample, penalized by its variance;
+            // the cached likelihood becomes the subsample's estimate
+            // Far from the anchor the proxy is poor: retry on 4x larger
+            // subsamples until the noise is acceptable, or decide exactly
+            const double max_variance = LikelihoodSubsampler<Model>::MAX_VARIANCE * temperature * temperature;
+            double variance, diff;
+            for (int m = sub->batch_for(temperature);; m *= 4) {
+                diff = sub->estimate_difference(current, proposed, m, chain_rng, variance, proposed_log_lik);
+                counters.subsample(m);
+                if (variance <= max_variance) break;
+                if (4 * m >= sub->get_num_terms()) {
+                    current_log_lik = evaluate_likelihood(current, current_log_prior, data);
+                    current_log_posterior = tempered(current_log_prior, current_log_lik);
+                    proposed_log_lik = evaluate_likelihood(proposed, proposed_log_prior, data);
+                    diff = proposed_log_lik - current_log_lik;
+                    variance = 0.0;
+                    break;
+                }
+            }
+            log_alpha = proposed_log_prior - current_log_prior +
+                        (diff - 0.5 * variance / temperature) / temperature + log_jacobian_ratio;
+        } else {
+            proposed_log_lik = evaluate_likelihood(proposed, proposed_log_prior, data);
+            log_alpha = tempered(proposed_log_prior, proposed_log_lik) - current_log_posterior + log_jacobian_ratio;
+        }
+        double proposed_log_posterior = tempered(proposed_log_prior, proposed_log_lik);
+        
+        bool accept = std::log(chain_rng.uniform_pos()) < log_alpha;
+        if (accept) {
+            current = proposed;
+            current_log_prior = proposed_log_prior;
+            current_log_lik = proposed_log_lik;
+            current_log_posterior = proposed_log_posterior;
+        }
+        
+        // Adapt proposal covariance and scale
+        proposal.update(current, accept);
+        return accept;
+    }
+    
+public:
+    DrawStore samples;
+    OnlineTrace traces[4]; // floor, ceiling, ec50, slope; updated every step
+    HotCounters counters;
+    
+    MCMCChain(double temp, const Params& init, const Data& data, const Priors& priors, const RngStream& stream)
+        : current(init), temperature(temp), move(MOVE_METROPOLIS), chain_rng(stream), accepted(0), total(0) {
+        current_log_prior = Model::log_prior(current, priors);
+        current_log_lik = evaluate_likelihood(current, current_log_prior, data);
+        current_log_posterior = tempered(current_log_prior, current_log_lik);
+    }
+    
+    // Placeholder to be filled by load()
+    MCMCChain()
+        : current_log_prior(-INFINITY), current_log_lik(-INFINITY), current_log_posterior(-INFINITY),
+          temperature(1.0), move(MOVE_METROPOLIS), accepted(0), total(0) {}
+    
+    // Complete chain state, cached terms included, so a restored chain
+    // continues exactly where it stopped
+    void save(ByteWriter& out, int encoding) const {
+        out.put(current);
+        out.put(current_log_prior);
+        out.put(current_log_lik);
+        out.put(current_log_posterior);
+        out.put(temperature);
+        proposal.save(out);
+        out.put<int32_t>(move);
+        nuts.save(out);
+        chain_rng.save(out);
+        out.put<int32_t>(accepted);
+        out.put<int32_t>(total);
+        samples.save(out, encoding);
+        for (const auto& trace : traces) trace.save(out);
+        counters.save(out);
+    }
+    
+    bool load(ByteReader& in, int encoding) {
+        in.get(current);
+        in.get(current_log_prior);
+        in.get(current_log_lik);
+        in.get(current_log_posterior);
+        in.get(temperature);
+        proposal.load(in);
+        in.get(move);
+        nuts.load(in);
+        chain_rng.load(in);
+        in.get(accepted);
+        in.get(total);
+        samples.load(in, encoding);
+        for (auto& trace : traces) trace.load(in);
+        counters.load(in);
+        if (!in.good() || !(temperature >= 1.0) || (move != MOVE_METROPOLIS && move != MOVE_NUTS)) return in.fail();
+        return true;
+    }
+    
+    double tempered(double lp, double ll) const {
+        if (!std::isfinite(lp) || !std::isfinite(ll)) return -INFINITY;
+        return lp + ll / temperature;
+    }
+    
+    // With a subsampler, random-walk steps estimate the likelihood ratio from
+    // a subsample (NUTS moves always use the full data)
+    void step(const Data& data, const Priors& priors, const LikelihoodSubsampler<Model>* sub = nullptr) {
+        bool moved;
+        if (move == MOVE_NUTS) {
+            moved = nuts.transition(current, current_log_prior, current_log_lik, temperature, data, priors, chain_rng, counters);
+            current_log_posterior = tempered(current_log_prior, current_log_lik);
+        } else {
+            moved = metropolis_step(data, priors, sub);
+        }
+        total++;
+        if (moved) accepted++;
+        
+        // Store sample as the retention policy allows (by default only the cold chain)
+        samples.record(total - 1, current);
+        traces[0].push(current.floor);
+        traces[1].push(current.ceiling);
+        traces[2].push(current.ec50);
+        traces[3].push(current.slope);
+    }
+    
+    // Switch move type; NUTS adapts its step size and metric over the next
+    // `warmup` transitions
+    void set_move(int move_type, int warmup) {
+        move = move_type;
+        if (move == MOVE_NUTS) nuts.set_adaptation(warmup);
+    }
+    
+    int get_move() const { return move; }
+    const NUTSKernel<Model>& nuts_kernel() const { return nuts; }
+    
+    double get_log_posterior() const { return current_log_posterior; }
+    double get_log_likelihood() const { return current_log_lik; }
+    double get_temperature() const { return temperature; }
+    int get_iterations() const { return total; }
+    const Params& get_current() const { return current; }
+    void set_current(const Params& p, const Data& data, const Priors& priors) {
+        current = p;
+        current_log_prior = Model::log_prior(current, priors);
+        current_log_lik = evaluate_likelihood(current, current_log_prior, data);
+        current_log_posterior = tempered(current_log_prior, current_log_lik);
+    }
+    
+    // Continue from another chain's state, proposal adaptation, move type and
+    // NUTS tuning, re-scored under (possibly changed) data and priors at this
+    // chain's temperature. The random stream, draws and counters stay.
+    void warm_start(const MCMCChain& previous, const Data& data, const Priors& priors) {
+        proposal = previous.proposal;
+        proposal.restart_adaptation();
+        move = previous.move;
+        nuts = previous.nuts;
+        set_current(previous.current, data, priors);
+    }
+    
+    // Move this chain to a new rung; only the cached terms are re-tempered
+    void set_temperature(double temp) {
+        temperature = temp;
+        current_log_posterior = tempered(current_log_prior, current_log_lik);
+    }
+    
+    // Exchange states with a chain at another temperature: O(1), no likelihood evaluations
+    void swap_state(MCMCChain& other) {
+        std::swap(current, other.current);
+        std::swap(current_log_prior, other.current_log_prior);
+        std::swap(current_log_lik, other.current_log_lik);
+        current_log_posterior = tempered(current_log_prior, current_log_lik);
+        other.current_log_posterior = other.tempered(other.current_log_prior, other.current_log_lik);
+    }
+    
+    // The likelihood of another rung's state at this rung's precision
+    double score_likelihood(const Params& p, const Data& data) {
+        counters.likelihood();
+        return temperature > 1.0 ? log_likelihood_heated(p, data) : log_likelihood(p, data);
+    }
+    
+    // swap_state, taking the incoming states' likelihoods as already scored
+    // at each chain's own precision (see score_likelihood)
+    void swap_state(MCMCChain& other, double log_lik, double other_log_lik) {
+        swap_state(other);
+        current_log_lik = log_lik;
+        other.current_log_lik = other_log_lik;
+        current_log_posterior = tempered(current_log_prior, current_log_lik);
+        other.current_log_posterior = other.tempered(other.current_log_prior, other.current_log_lik);
+    }
+    double get_acceptance_rate() const {
+        return total > 0 ? static_cast<double>(accepted) / total : 0.0;
+    }
+};
+
+// Multi-chain convergence diagnostics (Vehtari et al. 2021): rank-normalized
+// split R-hat, bulk ESS and tail ESS. Each inner vector is one chain's draws;
+// all chains must have the same length.
+typedef std::vector<std::vector<double>> ChainDraws;
+
+// Inverse standard normal CDF (Acklam's rational approximation, rel. error < 1.2e-9)
+inline double normal_quantile(double p) {
+    static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                               1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+    static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                               6.680131188771972e+01, -1.328068155288572e+01};
+    static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                               -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+    static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                               3.754408661907416e+00};
+    const double p_low = 0.02425;
+    if (p < p_low) {
+        double q = std::sqrt(-2.0 * std::log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+    if (p > 1.0 - p_low) {
+        double q = std::sqrt(-2.0 * std::log(1.0 - p));
+        return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+                ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+    double q = p - 0.5;
+    double r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+           (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+}
+
+// Split each chain into halves, doubling the number of chains
+inline ChainDraws split_chains(const ChainDraws& chains) {
+    ChainDraws halves;
+    for (const auto& c : chains) {
+        size_t half = c.size() / 2;
+        halves.emplace_back(c.begin(), c.begin() + half);
+        halves.emplace_back(c.end() - half, c.end());
+    }
+    return halves;
+}
+
+// Replace draws by normal scores of their pooled ranks (average rank for ties)
+inline ChainDraws rank_normalize(const ChainDraws& chains) {
+    size_t total = 0;
+    for (const auto& c : chains) total += c.size();
+    std::vector<std::pair<double, size_t>> pooled;
+    pooled.reserve(total);
+    for (size_t m = 0, idx = 0; m < chains.size(); ++m) {
+        for (double x : chains[m]) pooled.emplace_back(x, idx++);
+    }
+    std::sort(pooled.begin(), pooled.end());
+    
+    std::vector<double> z(total);
+    for (size_t i = 0; i < total;) {
+        size_t j = i;
+        while (j + 1 < total && pooled[j + 1].first == pooled[i].first) ++j;
+        double rank = 0.5 * (i + j) + 1.0;
+        double score = normal_quantile((rank - 0.375) / (total + 0.25));
+        for (size_t k = i; k <= j; ++k) z[pooled[k].second] = score;
+        i = j + 1;
+    }
+    
+    ChainDraws out;
+    for (size_t m = 0, idx = 0; m < chains.size(); ++m) {
+        out.emplace_back(z.begin() + idx, z.begin() + idx + chains[m].size());
+        idx += chains[m].size();
+    }
+    return out;
+}
+
+// In-place radix-2 FFT (size must be a power of two)
+inline void fft(std::vector<double>& re, std::vector<double>& im, bool inverse) {
+    const size_t n = re.size();
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        double angle = 2.0 * M_PI / len * (inverse ? 1.0 : -1.0);
+        double w_re = std::cos(angle), w_im = std::sin(angle);
+        for (size_t i = 0; i < n; i += len) {
+            double u_re = 1.0, u_im = 0.0;
+            for (size_t k = 0; k < len / 2; ++k) {
+                size_t a = i + k, b = i + k + len / 2;
+                double t_re = re[b] * u_re - im[b] * u_im;
+                double t_im = re[b] * u_im + im[b] * u_re;
+                re[b] = re[a] - t_re;
+                im[b] = im[a] - t_im;
+                re[a] += t_re;
+                im[a] += t_im;
+                double next_re = u_re * w_re - u_im * w_im;
+                u_im = u_re * w_im + u_im * w_re;
+                u_re = next_re;
+            }
+        }
+    }
+    if (inverse) {
+        for (size_t i = 0; i < n; ++i) {
+            re[i] /= n;
+            im[i] /= n;
+        }
+    }
+}
+
+// Biased autocovariance at every lag, via zero-padded FFT
+inline std::vector<double> autocovariance(const std::vector<double>& x) {
+    const size_t n = x.size();
+    double mean = std::accumulate(x.begin(), x.end(), 0.0) / n;
+    size_t size = 1;
+    while (size < 2 * n) size <<= 1;
+    std::vector<double> re(size, 0.0), im(size, 0.0);
+    for (size_t i = 0; i < n; ++i) re[i] = x[i] - mean;
+    fft(re, im, false);
+    for (size_t i = 0; i < size; ++i) {
+        re[i] = re[i] * re[i] + im[i] * im[i];
+        im[i] = 0.0;
+    }
+    fft(re, im, true);
+    std::vector<double> acov(n);
+    for (size_t t = 0; t < n; ++t) acov[t] = re[t] / n;
+    return acov;
+}
+
+// Potential scale reduction of equal-length chains
+inline double rhat_basic(const ChainDraws& chains) {
+    const size_t m = chains.size();
+    const double n = static_cast<double>(chains[0].size());
+    std::vector<double> means(m), vars(m);
+    for (size_t j = 0; j < m; ++j) {
+        means[j] = std::accumulate(chains[j].begin(), chains[j].end(), 0.0) / n;
+        double ss = 0.0;
+        for (double x : chains[j]) ss += (x - means[j]) * (x - means[j]);
+        vars[j] = ss / (n - 1.0);
+    }
+    double grand = std::accumulate(means.begin(), means.end(), 0.0) / m;
+    double b_over_n = 0.0;
+    for (double mu : means) b_over_n += (mu - grand) * (mu - grand);
+    b_over_n /= (m - 1.0);
+    double w = std::accumulate(vars.begin(), vars.end(), 0.0) / m;
+    if (w <= 0.0) return 1.0;
+    return std::sqrt(((n - 1.0) / n * w + b_over_n) / w);
+}
+
+// Multi-chain ESS with Geyer's initial monotone sequence (as in Stan)
+inline double ess_basic(const ChainDraws& chains) {
+    const size_t m = chains.size();
+    const size_t n = chains[0].size();
+    if (n < 4) return 0.0;
+    
+    std::vector<std::vector<double>> acov(m);
+    std::vector<double> means(m), vars(m);
+    for (size_t j = 0; j < m; ++j) {
+        acov[j] = autocovariance(chains[j]);
+        means[j] = std::accumulate(chains[j].begin(), chains[j].end(), 0.0) / n;
+        vars[j] = acov[j][0] * n / (n - 1.0);
+    }
+    double mean_var = std::accumulate(vars.begin(), vars.end(), 0.0) / m;
+    double var_plus = mean_var * (n - 1.0) / n;
+    if (m > 1) {
+        double grand = std::accumulate(means.begin(), means.end(), 0.0) / m;
+        double b = 0.0;
+        for (double mu : means) b += (mu - grand) * (mu - grand);
+        var_plus += b / (m - 1.0);
+    }
+    if (!(var_plus > 0.0)) return 0.0;
+    
+    auto mean_acov = [&](size_t t) {
+        double sum = 0.0;
+        for (size_t j = 0; j < m; ++j) sum += acov[j][t];
+        return sum / m;
+    };
+    
+    std::vector<double> rho(n, 0.0);
+    rho[0] = 1.0;
+    double rho_even = 1.0;
+    double rho_odd = 1.0 - (mean_var - mean_acov(1)) / var_plus;
+    rho[1] = rho_odd;
+    
+    size_t t = 1;
+    while (t < n - 4 && rho_even + rho_odd > 0.0) {
+        rho_even = 1.0 - (mean_var - mean_acov(t + 1)) / var_plus;
+        rho_odd = 1.0 - (mean_var - mean_acov(t + 2)) / var_plus;
+        if (rho_even + rho_odd >= 0.0) {
+            rho[t + 1] = rho_even;
+            rho[t + 2] = rho_odd;
+        }
+        t += 2;
+    }
+    size_t max_t = t;
+    if (rho_even > 0.0) rho[max_t + 1] = rho_even;
+    
+    // Enforce a monotone sequence of pair sums
+    for (t = 1; t + 2 <= max_t; t += 2) {
+        if (rho[t + 1] + rho[t + 2] > rho[t - 1] + rho[t]) {
+            rho[t + 1] = (rho[t - 1] + rho[t]) / 2.0;
+            rho[t + 2] = rho[t + 1];
+        }
+    }
+    
+    double ess = static_cast<double>(m * n);
+    double tau = -1.0 + 2.0 * std::accumulate(rho.begin(), rho.begin() + max_t + 1, 0.0) + rho[max_t + 1];
+    tau = std::max(tau, 1.0 / std::log10(ess));
+    return ess / tau;
+}
+
+// Rank-normalized split R-hat: max of bulk and folded (tail) R-hat
+inline double rank_normalized_rhat(const ChainDraws& chains) {
+    ChainDraws split = split_chains(chains);
+    double bulk = rhat_basic(rank_normalize(split));
+    
+    std::vector<double> pooled;
+    for (const auto& c : split) pooled.insert(pooled.end(), c.begin(), c.end());
+    std::nth_element(pooled.begin(), pooled.begin() + pooled.size() / 2, pooled.end());
+    double median = pooled[pooled.size() / 2];
+    ChainDraws folded = split;
+    for (auto& c : folded) {
+        for (double& x : c) x = std::fabs(x - median);
+    }
+    double tail = rhat_basic(rank_normalize(folded));
+    return std::max(bulk, tail);
+}
+
+// Bulk ESS: ESS of the rank-normalized split chains
+inline double ess_bulk(const ChainDraws& chains) {
+    return ess_basic(rank_normalize(split_chains(chains)));
+}
+
+// Tail ESS: minimum ESS of the 5% and 95% quantile indicators
+inline double ess_tail(const ChainDraws& chains) {
+    ChainDraws split = split_chains(chains);
+    std::vector<double> pooled;
+    for (const auto& c : split) pooled.insert(pooled.end(), c.begin(), c.end());
+    std::sort(pooled.begin(), pooled.end());
+    double q05 = pooled[static_cast<size_t>(0.05 * (pooled.size() - 1))];
+    double q95 = pooled[static_cast<size_t>(0.95 * (pooled.size() - 1))];
+    
+    auto indicator_ess = [&](double q) {
+        ChainDraws ind = split;
+        for (auto& c : ind) {
+            for (double& x : c) x = x <= q ? 1.0 : 0.0;
+        }
+        return ess_basic(ind);
+    };
+    return std::min(indicator_ess(q05), indicator_ess(q95));
+}
+
+// Extract one parameter's post-warmup draws as a plain vector
+inline std::vector<double> param_draws(const DrawStore& samples, int warmup, double Params::*field) {
+    std::vector<double> out;
+    size_t first = samples.first_index_from(warmup);
+    out.reserve(samples.size() - first);
+    for (size_t i = first; i < samples.size(); ++i) out.push_back(samples[i].*field);
+    return out;
+}
+
+// Post-warmup, thinned draws of one or more chains in a flat structure-of-arrays
+// buffer: [floor | ceiling | ec50 | slope], each column holding every chain's
+// draws back to back. JS reads it through a Float64Array view of the heap.
+struct FlatDraws {
+    std::vector<double> values;
+    int n_draws; // Draws per column
+    
+    FlatDraws() : n_draws(0) {}
+    
+    // warmup is in iterations; thin applies on top of the retention policy's thinning
+    void fill(const std::vector<const DrawStore*>& chains, int warmup, int thin) {
+        thin = std::max(1, thin);
+        n_draws = 0;
+        for (const auto* samples : chains) {
+            size_t n = samples->size() - samples->first_index_from(warmup);
+            n_draws += static_cast<int>((n + thin - 1) / thin);
+        }
+        values.resize(4 * static_cast<size_t>(n_draws));
+        double* floor_col = values.data();
+        double* ceiling_col = floor_col + n_draws;
+        double* ec50_col = ceiling_col + n_draws;
+        double* slope_col = ec50_col + n_draws;
+        size_t k = 0;
+        for (const auto* samples : chains) {
+            for (size_t i = samples->first_index_from(warmup); i < samples->size(); i += thin, ++k) {
+                const Params& p = (*samples)[i];
+                floor_col[k] = p.floor;
+                ceiling_col[k] = p.ceiling;
+                ec50_col[k] = p.ec50;
+                slope_col[k] = p.slope;
+            }
+        }
+    }
+    
+#ifdef __EMSCRIPTEN__
+    // Zero-copy view; invalidated by the next export or by heap growth
+    val view() const {
+        return val(typed_memory_view(values.size(), values.data()));
+    }
+#endif
+};
+
+// Quantiles (R type 7: linear interpolation between order statistics) of
+// x[0..n) for ascending probs, by successive nth_element selections on the
+// shrinking right-hand part; reorders x
+inline void select_quantiles(double* x, size_t n, const std::vector<double>& probs, double* out) {
+    size_t from = 0;
+    for (size_t k = 0; k < probs.size(); ++k) {
+        if (n == 0) {
+            out[k] = NAN;
+            continue;
+        }
+        double h = (n - 1) * std::min(1.0, std::max(0.0, probs[k]));
+        size_t lo = static_cast<size_t>(h);
+        if (lo >= from) {
+            std::nth_element(x + from, x + lo, x + n);
+            from = lo;
+        }
+        double value = x[lo];
+        if (lo + 1 < n && h > lo) {
+            value += (h - lo) * (*std::min_element(x + lo + 1, x + n) - value);
+        }
+        out[k] = value;
+    }
+}
+
+// Posterior-predictive infection probability over a titre grid: for each grid
+// point, the mean over draws followed by one value per requested quantile.
+// Result layout is [mean | q_1 | ... | q_K], each block grid.size() long, with
+// the quantile blocks in ascending order of probability. The
+// 4PL is evaluated one grid point at a time (2 draws per SIMD step) into a
+// single draws-sized buffer, so no draws x grid matrix is ever stored.
+inline std::vector<double> curve_bands(const FlatDraws& draws, const std::vector<double>& grid, std::vector<double> probs) {
+    std::sort(probs.begin(), probs.end());
+    const size_t n = draws.n_draws;
+    const size_t g_count = grid.size();
+    const size_t k_count = probs.size();
+    std::vector<double> out((1 + k_count) * g_count, NAN);
+    if (n == 0) return out;
+    
+    const double* floor_col = draws.values.data();
+    const double* ceiling_col = floor_col + n;
+    const double* ec50_col = ceiling_col + n;
+    const double* slope_col = ec50_col + n;
+    
+    parallel_for(static_cast<int>(g_count), [&](int g) {
+        std::vector<double> prob(n);
+        const double t = grid[g];
+        const f64x2 one = simd_splat(1.0);
+        const f64x2 tv = simd_splat(t);
+        size_t i = 0;
+        for (; i + SIMD_LANES <= n; i += SIMD_LANES) {
+            f64x2 f = {floor_col[i], floor_col[i + 1]};
+            f64x2 c = {ceiling_col[i], ceiling_col[i + 1]};
+            f64x2 e = {ec50_col[i], ec50_col[i + 1]};
+            f64x2 b = {slope_col[i], slope_col[i + 1]};
+            f64x2 sig = one / (one + simd_exp(b * (tv - e)));
+            f64x2 p = c * (sig * (one - f) + f);
+            prob[i] = p[0];
+            prob[i + 1] = p[1];
+        }
+        for (; i < n; ++i) {
+            Params p(floor_col[i], ceiling_col[i], ec50_col[i], slope_col[i]);
+            prob[i] = prob_infection(p, t);
+        }
+        
+        double sum = 0.0;
+        for (double v : prob) sum += v;
+        out[g] = sum / n;
+        
+        std::vector<double> q(k_count);
+        select_quantiles(prob.data(), n, probs, q.data());
+        for (size_t k = 0; k < k_count; ++k) out[(1 + k) * g_count + g] = q[k];
+    });
+    return out;
+}
+
+// Binned calibration of the 4PL against the observed infection rates. Bins
+// are contiguous, roughly equal-count runs of the presorted titre index
+// (ties never straddle a bin), so they are fixed across draws; each draw's
+// predicted risk per bin is the count-weighted mean over the bin's distinct
+// titres. Layout is [titre | observed | count | mean | q_1 | ... | q_K], each
+// block one entry per bin (at most n_bins), with titre the bin's mean titre.
+inline std::vector<double> calibration_bands(const Data& data, const FlatDraws& draws, int n_bins, std::vector<double> probs) {
+    std::sort(probs.begin(), probs.end());
+    std::vector<double> group_titre;
+    std::vector<int> group_count, bin_end; // bin_end: one past each bin's last group
+    std::vector<double> bin_titre, bin_observed, bin_count;
+    const int target = std::max(1, n_bins);
+    double sum_t = 0.0;
+    int sum_k = 0, sum_m = 0, seen = 0;
+    data.for_each_titre_group([&](double t, int k, int m) {
+        group_titre.push_back(t);
+        group_count.push_back(m);
+        sum_t += t * m;
+        sum_k += k;
+        sum_m += m;
+        seen += m;
+        if (static_cast<double>(seen) * target >= static_cast<double>(bin_end.size() + 1) * data.N) {
+            bin_end.push_back(static_cast<int>(group_titre.size()));
+            bin_titre.push_back(sum_t / sum_m);
+            bin_observed.push_back(static_cast<double>(sum_k) / sum_m);
+            bin_count.push_back(sum_m);
+            sum_t = 0.0;
+            sum_k = sum_m = 0;
+        }
+    });
+    
+    const size_t bins = bin_end.size();
+    const size_t n = draws.n_draws;
+    const size_t k_count = probs.size();
+    std::vector<double> out((4 + k_count) * bins, NAN);
+    std::copy(bin_titre.begin(), bin_titre.end(), out.begin());
+    std::copy(bin_observed.begin(), bin_observed.end(), out.begin() + bins);
+    std::copy(bin_count.begin(), bin_count.end(), out.begin() + 2 * bins);
+    if (n == 0) return out;
+    
+    const double* floor_col = draws.values.data();
+    const double* ceiling_col = floor_col + n;
+    const double* ec50_col = ceiling_col + n;
+    const double* slope_col = ec50_col + n;
+    
+    parallel_for(static_cast<int>(bins), [&](int b) {
+        const int first = b > 0 ? bin_end[b - 1] : 0;
+        std::vector<double> pred(n);
+        for (size_t i = 0; i < n; ++i) {
+            Params p(floor_col[i], ceiling_col[i], ec50_col[i], slope_col[i]);
+            double risk = 0.0;
+            for (int g = first; g < bin_end[b]; ++g) risk += group_count[g] * prob_infection(p, group_titre[g]);
+            pred[i] = risk / bin_count[b];
+        }
+        double sum = 0.0;
+        for (double v : pred) sum += v;
+        out[3 * bins + b] = sum / n;
+        
+        std::vector<double> q(k_count);
+        select_quantiles(pred.data(), n, probs, q.data());
+        for (size_t k = 0; k < k_count; ++k) out[(4 + k) * bins + b] = q[k];
+    });
+    return out;
+}
+
+// Posterior summaries of each parameter column: for floor, ceiling, ec50 and
+// slope in turn, [mean, sd, q_1, ..., q_K] with quantiles in ascending order of
+// probability. Two passes for the moments, then selection on the column
+// (reordered in place) rather than a full sort.
+inline std::vector<double> summarize_draws(FlatDraws& draws, std::vector<double> probs) {
+    std::sort(probs.begin(), probs.end());
+    const size_t n = draws.n_draws;
+    const size_t stride = 2 + probs.size();
+    std::vector<double> out(4 * stride, NAN);
+    if (n == 0) return out;
+    for (int param = 0; param < 4; ++param) {
+        double* col = draws.values.data() + param * n;
+        double* row = out.data() + param * stride;
+        double sum = 0.0;
+        for (size_t i = 0; i < n; ++i) sum += col[i];
+        double mean = sum / n;
+        double ss = 0.0;
+        for (size_t i = 0; i < n; ++i) ss += (col[i] - mean) * (col[i] - mean);
+        row[0] = mean;
+        row[1] = n > 1 ? std::sqrt(ss / (n - 1)) : 0.0;
+        select_quantiles(col, n, probs, row + 2);
+    }
+    return out;
+}
+
+// Model-comparison summary from PSIS-LOO and WAIC (Vehtari, Gelman & Gabry 2017)
+struct LooSummary {
+    double elpd_loo;
+    double se_elpd_loo;
+    double p_loo;
+    double looic;
+    double elpd_waic;
+    double se_elpd_waic;
+    double p_waic;
+    double waic;
+    double max_pareto_k;
+    int n_high_k;  // Observations with Pareto k > 0.7 (unreliable LOO terms)
+    int n_draws;
+    
+    LooSummary() : elpd_loo(NAN), se_elpd_loo(NAN), p_loo(NAN), looic(NAN), elpd_waic(NAN),
+                   se_elpd_waic(NAN), p_waic(NAN), waic(NAN), max_pareto_k(NAN), n_high_k(0), n_draws(0) {}
+};
+
+// Generalized Pareto fit to exceedances x (ascending) by the profile
+// posterior of Zhang & Stephens (2009), with the weakly informative shrinkage
+// of k towards 0.5 used by the loo package. Returns false for degenerate tails.
+inline bool fit_generalized_pareto(const std::vector<double>& x, double& k, double& sigma) {
+    const int n = static_cast<int>(x.size());
+    const double prior = 3.0;
+    const int m = 30 + static_cast<int>(std::sqrt(static_cast<double>(n)));
+    const double xstar = x[std::max(0, static_cast<int>(n / 4.0 + 0.5) - 1)];
+    if (!(xstar > 0.0) || !(x[n - 1] > 0.0)) return false;
+    
+    std::vector<double> theta(m), log_lik(m);
+    double max_ll = -INFINITY;
+    for (int j = 0; j < m; ++j) {
+        theta[j] = 1.0 / x[n - 1] + (1.0 - std::sqrt(m / (j + 0.5))) / prior / xstar;
+        double kj = 0.0;
+        for (double xi : x) kj += std::log1p(-theta[j] * xi);
+        kj /= n;
+        log_lik[j] = n * (std::log(-theta[j] / kj) - kj - 1.0);
+        if (!std::isfinite(log_lik[j])) log_lik[j] = -INFINITY;
+        max_ll = std::max(max_ll, log_lik[j]);
+    }
+    if (!std::isfinite(max_ll)) return false;
+    double wsum = 0.0, theta_hat = 0.0;
+    for (int j = 0; j < m; ++j) {
+        double w = std::exp(log_lik[j] - max_ll);
+        wsum += w;
+        theta_hat += theta[j] * w;
+    }
+    theta_hat /= wsum;
+    
+    k = 0.0;
+    for (double xi : x) k += std::log1p(-theta_hat * xi);
+    k /= n;
+    sigma = -k / theta_hat;
+    k = (n * k + 10.0 * 0.5) / (n + 10.0);
+    return std::isfinite(k) && sigma > 0.0;
+}
+
+inline double generalized_pareto_quantile(double p, double k, double sigma) {
+    if (std::fabs(k) < 1e-12) return -sigma * std::log1p(-p);
+    return sigma * std::expm1(-k * std::log1p(-p)) / k;
+}
+
+// Draws in the Pareto-smoothed tail of S importance ratios (Vehtari et al. 2024)
+inline int psis_tail_length(int draws) {
+    return static_cast<int>(std::ceil(std::min(0.2 * draws, 3.0 * std::sqrt(static_cast<double>(draws)))));
+}
+
+// Pareto-smoothed importance sampling: the largest ratios are replaced by
+// quantiles of a generalized Pareto fitted to them, truncated at the largest
+// raw ratio. Turns the log ratios lw into normalized weights in place and
+// returns the fitted shape k; INFINITY when the tail cannot be fitted (the
+// weights are then the raw ratios, normalized).
+inline double psis_normalize(std::vector<double>& lw) {
+    const int S = static_cast<int>(lw.size());
+    if (S == 0) return INFINITY;
+    const double lw_max = *std::max_element(lw.begin(), lw.end());
+    if (!std::isfinite(lw_max)) {
+        std::fill(lw.begin(), lw.end(), lw_max > 0.0 ? NAN : 0.0);
+        return INFINITY;
+    }
+    for (double& v : lw) v = std::exp(v - lw_max);
+    
+    double k = INFINITY;
+    const int M = std::min(psis_tail_length(S), S - 1);
+    if (M >= 5) {
+        // order[0..M] holds the M + 1 largest ratios, descending
+        std::vector<int> order(S);
+        std::iota(order.begin(), order.end(), 0);
+        auto larger = [&lw](int a, int b) { return lw[a] > lw[b]; };
+        std::nth_element(order.begin(), order.begin() + M, order.end(), larger);
+        std::sort(order.begin(), order.begin() + M, larger);
+        const double cutoff = lw[order[M]];
+        std::vector<double> x(M);
+        for (int j = 0; j < M; ++j) x[j] = lw[order[M - 1 - j]] - cutoff;
+        double sigma;
+        if (fit_generalized_pareto(x, k, sigma)) {
+            for (int j = 0; j < M; ++j) {
+                lw[order[M - 1 - j]] = std::min(1.0, generalized_pareto_quantile((j + 0.5) / M, k, sigma) + cutoff);
+            }
+        } else {
+            k = INFINITY;
+        }
+    }
+    double sum = 0.0;
+    for (double v : lw) sum += v;
+    for (double& v : lw) v /= sum;
+    return k;
+}
+
+// Outcome of importance-reweighting retained draws towards a nearby target
+// (see ParallelTemperingMCMC::reweight_priors)
+struct PriorSensitivity {
+    double pareto_k;    // Shape of the smoothed weights' tail
+    double k_threshold; // min(1 - 1 / log10(S), 0.7) for S draws (Vehtari et al. 2024)
+    double ess;         // Effective sample size of the weights, 1 / sum(w^2)
+    int n_draws;
+    bool stable;        // pareto_k < k_threshold: the reweighted draws can stand in for a refit
+    
+    PriorSensitivity() : pareto_k(NAN), k_threshold(NAN), ess(0.0), n_draws(0), stable(false) {}
+};
+
+// Flat draws with one normalized importance weight each
+struct WeightedDraws {
+    FlatDraws draws;
+    std::vector<double> weights;
+};
+
+// Pareto-smoothed weights p_to(theta) / p_from(theta) on draws taken under
+// the priors `from`; the likelihood and the Jacobian cancel in the ratio
+template <class Model>
+inline PriorSensitivity reweight_to_priors(WeightedDraws& wd, const Priors& from, const Priors& to) {
+    const size_t n = wd.draws.n_draws;
+    const double* col = wd.draws.values.data();
+    wd.weights.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        Params p(col[i], col[n + i], col[2 * n + i], col[3 * n + i]);
+        wd.weights[i] = Model::log_prior(p, to) - Model::log_prior(p, from);
+    }
+    PriorSensitivity out;
+    out.n_draws = static_cast<int>(n);
+    if (n == 0) return out;
+    out.pareto_k = psis_normalize(wd.weights);
+    out.k_threshold = std::min(1.0 - 1.0 / std::log10(static_cast<double>(n)), 0.7);
+    double sq = 0.0;
+    for (double w : wd.weights) sq += w * w;
+    out.ess = sq > 0.0 ? 1.0 / sq : 0.0;
+    out.stable = out.pareto_k < out.k_threshold;
+    return out;
+}
+
+// Weighted quantiles of x[0..n) for ascending probs, with weights w summing
+// to 1: each sorted draw sits at the midpoint of its cumulative weight, with
+// linear interpolation between midpoints and the extremes beyond them
+inline void weighted_quantiles(const double* x, const double* w, size_t n, const std::vector<double>& probs, double* out) {
+    if (n == 0) {
+        std::fill(out, out + probs.size(), NAN);
+        return;
+    }
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [x](size_t a, size_t b) { return x[a] < x[b]; });
+    std::vector<double> mid(n);
+    double cum = 0.0;
+    for (size_t j = 0; j < n; ++j) {
+        mid[j] = cum + 0.5 * w[order[j]];
+        cum += w[order[j]];
+    }
+    size_t j = 0;
+    for (size_t k = 0; k < probs.size(); ++k) {
+        const double p = probs[k];
+        while (j + 1 < n && mid[j + 1] < p) ++j;
+        if (p <= mid[0]) {
+            out[k] = x[order[0]];
+        } else if (j + 1 >= n) {
+            out[k] = x[order[n - 1]];
+        } else {
+            double a = x[order[j]], b = x[order[j + 1]];
+            double span = mid[j + 1] - mid[j];
+            out[k] = span > 0.0 ? a + (p - mid[j]) / span * (b - a) : b;
+        }
+    }
+}
+
+// Weighted analogue of summarize_draws: per parameter [mean, sd, q_1..q_K]
+inline std::vector<double> summarize_weighted(const WeightedDraws& wd, std::vector<double> probs) {
+    std::sort(probs.begin(), probs.end());
+    const size_t n = wd.draws.n_draws;
+    const size_t stride = 2 + probs.size();
+    std::vector<double> out(4 * stride, NAN);
+    if (n == 0) return out;
+    const double* w = wd.weights.data();
+    for (int param = 0; param < 4; ++param) {
+        const double* col = wd.draws.values.data() + param * n;
+        double* row = out.data() + param * stride;
+        double mean = 0.0;
+        for (size_t i = 0; i < n; ++i) mean += w[i] * col[i];
+        double var = 0.0;
+        for (size_t i = 0; i < n; ++i) var += w[i] * (col[i] - mean) * (col[i] - mean);
+        row[0] = mean;
+        row[1] = std::sqrt(var);
+        weighted_quantiles(col, w, n, probs, row + 2);
+    }
+    return out;
+}
+
+// Weighted analogue of curve_bands: [mean | q_1 | ... | q_K] over the grid
+inline std::vector<double> curve_bands_weighted(const WeightedDraws& wd, const std::vector<double>& grid, std::vector<double> probs) {
+    std::sort(probs.begin(), probs.end());
+    const size_t n = wd.draws.n_draws;
+    const size_t g_count = grid.size();
+    const size_t k_count = probs.size();
+    std::vector<double> out((1 + k_count) * g_count, NAN);
+    if (n == 0) return out;
+    const double* col = wd.draws.values.data();
+    const double* w = wd.weights.data();
+    
+    parallel_for(static_cast<int>(g_count), [&](int g) {
+        std::vector<double> prob(n);
+        double mean = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            Params p(col[i], col[n + i], col[2 * n + i], col[3 * n + i]);
+            prob[i] = prob_infection(p, grid[g]);
+            mean += w[i] * prob[i];
+        }
+        out[g] = mean;
+        std::vector<double> q(k_count);
+        weighted_quantiles(prob.data(), w, n, probs, q.data());
+        for (size_t k = 0; k < k_count; ++k) out[(1 + k) * g_count + g] = q[k];
+    });
+    return out;
+}
+
+// Streaming pointwise log-likelihood statistics of the cold chain, for
+// PSIS-LOO and WAIC without a draws x observations matrix. Terms are the
+// distinct (titre, outcome) pairs with their counts as weights, since
+// identical observations have identical LOO terms. Per term and per retained
+// draw this keeps log-sum-exps of ll and -ll, Welford moments of ll, and a
+// bounded max-heap of the smallest ll values, i.e. the largest importance
+// ratios 1/p(y_i | theta), which is all the Pareto tail fit needs. Memory is
+// O(terms * sqrt(draws)). A draw costs one pass over the distinct titres,
+// vectorized under the dataset's SIMD engines, and a draw that repeats the
+// previous one (a rejected step) reuses that pass.
+class PointwiseLoo {
+private:
+    std::vector<double> term_titre; // Both outcomes of a titre adjacent
+    std::vector<int> term_y;
+    std::vector<double> term_weight;
+    
+    // Evaluation layout rebuilt from the terms (see build_layout)
+    bool simd;
+    std::vector<int> term_cell;                 // Distinct titre of each term
+    AlignedVector cell_titre, cell_lp, cell_lq; // Padded to the lane count: log p, log(1 - p)
+    std::vector<double> term_ll;                // Last recorded draw's ll per term
+    Params last;
+    bool have_last;
+    int start;          // First iteration accumulated (< 0: disabled)
+    int n_draws;
+    int capacity;       // Heap slots per term: tail length + 1 for the cutoff
+    std::vector<double> max_ll, sum_ll;   // log-sum-exp of ll as (max, sum of exp(ll - max))
+    std::vector<double> max_nll, sum_nll; // ...and of -ll
+    std::vector<double> mean, m2;
+    std::vector<double> heap;             // term-major, `capacity` slots each
+    std::vector<int> heap_size;
+    
+    static void lse_push(double x, double& mx, double& s) {
+        if (x > mx) {
+            s = s * std::exp(mx - x) + 1.0;
+            mx = x;
+        } else {
+            s += std::exp(x - mx);
+        }
+    }
+    
+    static void lse_merge(double mx2, double s2, double& mx, double& s) {
+        if (s2 == 0.0) return;
+        if (mx2 > mx) {
+            s = s * std::exp(mx - mx2) + s2;
+            mx = mx2;
+        } else {
+            s += s2 * std::exp(mx2 - mx);
+        }
+    }
+    
+    // lse_push on two lanes: both branches scale by exp(-|x - mx|)
+    static void lse_push2(f64x2 x, f64x2& mx, f64x2& s) {
+        f64x2 d = x - mx;
+        i64x2 up = x > mx;
+        f64x2 e = simd_exp(simd_select(up, -d, d));
+        s = simd_select(up, s * e + simd_splat(1.0), s + e);
+        mx = simd_select(up, x, mx);
+    }
+    
+    // Tail length of the loo package: min(S / 5, 3 sqrt(S)), rounded up
+    static int tail_length(int draws) {
+        return psis_tail_length(draws);
+    }
+    
+    void build_layout(const Data& data) {
+        simd = data.engine != ENGINE_SCALAR;
+        const size_t n = term_titre.size();
+        term_cell.resize(n);
+        cell_titre.clear();
+        for (size_t i = 0; i < n; ++i) {
+            if (i == 0 || term_titre[i] != term_titre[i - 1]) cell_titre.push_back(term_titre[i]);
+            term_cell[i] = static_cast<int>(cell_titre.size()) - 1;
+        }
+        const size_t cells = cell_titre.size();
+        cell_titre.resize((cells + SIMD_LANES - 1) / SIMD_LANES * SIMD_LANES, cells > 0 ? cell_titre[0] : 0.0);
+        cell_lp.assign(cell_titre.size(), 0.0);
+        cell_lq.assign(cell_titre.size(), 0.0);
+        term_ll.assign(n, 0.0);
+        have_last = false;
+    }
+    
+    // log p and log(1 - p) at every distinct titre, with log_bernoulli_pmf's
+    // -inf outside (0, 1)
+    void eval_cells(const Params& p) {
+        const int n = static_cast<int>(cell_titre.size());
+        if (simd) {
+            const f64x2 slope = simd_splat(p.slope), ec50 = simd_splat(p.ec50), ceiling = simd_splat(p.ceiling);
+            const f64x2 floor_v = simd_splat(p.floor), one_minus_floor = simd_splat(1.0 - p.floor);
+            const f64x2 one = simd_splat(1.0), tiny = simd_splat(DBL_MIN);
+            i64x2 invalid = simd_splat_i64(0);
+            for (int i = 0; i < n; i += SIMD_LANES) {
+                f64x2 t = *reinterpret_cast<const f64x2*>(cell_titre.data() + i);
+                f64x2 sig = one / (one + simd_exp(slope * (t - ec50)));
+                f64x2 prob = ceiling * (sig * one_minus_floor + floor_v);
+                f64x2 q = one - prob;
+                invalid |= (prob < tiny) | (q < tiny);
+                *reinterpret_cast<f64x2*>(cell_lp.data() + i) = simd_log(prob);
+                *reinterpret_cast<f64x2*>(cell_lq.data() + i) = simd_log(q);
+            }
+            if ((invalid[0] | invalid[1]) == 0) return;
+        }
+        for (int i = 0; i < n; ++i) {
+            double prob = prob_infection(p, cell_titre[i]);
+            bool ok = prob > 0.0 && prob < 1.0;
+            cell_lp[i] = ok ? std::log(prob) : -INFINITY;
+            cell_lq[i] = ok ? std::log(1.0 - prob) : -INFINITY;
+        }
+    }
+    
+public:
+    PointwiseLoo() : simd(false), have_last(false), start(-1), n_draws(0), capacity(0) {}
+    
+    bool active() const { return start >= 0; }
+    int get_start() const { return start; }
+    int get_num_draws() const { return n_draws; }
+    int get_num_terms() const { return static_cast<int>(term_titre.size()); }
+    
+    // Accumulate draws from iteration `first` on (< 0 disables and frees the statistics)
+    void configure(const Data& data, int first) {
+        start = first;
+        n_draws = 0;
+        capacity = 0;
+        term_titre.clear();
+        term_y.clear();
+        term_weight.clear();
+        auto add_cell = [this](double t, int k, int m) {
+            if (k > 0) { term_titre.push_back(t); term_y.push_back(1); term_weight.push_back(k); }
+            if (m > k) { term_titre.push_back(t); term_y.push_back(0); term_weight.push_back(m - k); }
+        };
+        if (first >= 0) {
+            if (data.compressed) {
+                for (size_t c = 0; c < data.cell_titre.size(); ++c) add_cell(data.cell_titre[c], data.cell_infected[c], data.cell_total[c]);
+            } else {
+                data.for_each_titre_group(add_cell);
+            }
+        }
+        build_layout(data);
+        const size_t n = term_titre.size();
+        max_ll.assign(n, -INFINITY);
+        sum_ll.assign(n, 0.0);
+        max_nll.assign(n, -INFINITY);
+        sum_nll.assign(n, 0.0);
+        mean.assign(n, 0.0);
+        m2.assign(n, 0.0);
+        heap.clear();
+        heap.shrink_to_fit();
+        heap_size.assign(n, 0);
+    }
+    
+    // Size the tail heaps for a run ending at iteration `end`. Growing them
+    // mid-run keeps every value retained so far; values already evicted by
+    // the smaller heap are not recovered, which only loosens the cutoff.
+    void reserve_until(int end) {
+        if (!active() || end <= start) return;
+        int cap = tail_length(end - start) + 1;
+        if (cap <= capacity) return;
+        const size_t n = term_titre.size();
+        std::vector<double> grown(n * cap);
+        for (size_t i = 0; i < n; ++i) {
+            std::copy(heap.begin() + i * capacity, heap.begin() + i * capacity + heap_size[i], grown.begin() + i * cap);
+        }
+        heap.swap(grown);
+        capacity = cap;
+    }
+    
+    void save(ByteWriter& out) const {
+        out.put<int32_t>(start);
+        out.put<int32_t>(n_draws);
+        out.put<int32_t>(capacity);
+        out.put_vector(term_titre);
+        out.put_vector(term_y);
+        out.put_vector(term_weight);
+        for (const auto* v : {&max_ll, &sum_ll, &max_nll, &sum_nll, &mean, &m2, &heap}) out.put_vector(*v);
+        out.put_vector(heap_size);
+    }
+    
+    bool load(ByteReader& in, const Data& data) {
+        in.get(start);
+        in.get(n_draws);
+        in.get(capacity);
+        in.get_vector(term_titre);
+        in.get_vector(term_y);
+        in.get_vector(term_weight);
+        for (auto* v : {&max_ll, &sum_ll, &max_nll, &sum_nll, &mean, &m2, &heap}) in.get_vector(*v);
+        in.get_vector(heap_size);
+        const size_t n = term_titre.size();
+        if (!in.good() || capacity < 0 || term_y.size() != n || term_weight.size() != n || max_ll.size() != n ||
+            sum_ll.size() != n || max_nll.size() != n || sum_nll.size() != n || mean.size() != n ||
+            m2.size() != n || heap_size.size() != n || heap.size() != n * capacity) {
+            return in.fail();
+        }
+        for (int h : heap_size) {
+            if (h < 0 || h > capacity) return in.fail();
+        }
+        build_layout(data);
+        return true;
+    }
+    
+    void record(int iteration, const Params& p) {
+        if (!active() || iteration < start || capacity == 0) return;
+        n_draws++;
+        const size_t n = term_titre.size();
+        const bool repeat = have_last && p.floor == last.floor && p.ceiling == last.ceiling &&
+                            p.ec50 == last.ec50 && p.slope == last.slope;
+        if (!repeat) {
+            eval_cells(p);
+            for (size_t i = 0; i < n; ++i) {
+                double ll = term_y[i] == 1 ? cell_lp[term_cell[i]] : cell_lq[term_cell[i]];
+                term_ll[i] = std::isfinite(ll) ? ll : -DBL_MAX / 4; // Only reachable at the support boundary
+            }
+            last = p;
+            have_last = true;
+        }
+        
+        // Log-sum-exps and Welford moments two terms at a time; an odd last
+        // term fills both lanes
+        const f64x2 draws = simd_splat(static_cast<double>(n_draws));
+        for (size_t i = 0; i < n; i += 2) {
+            const size_t j = i + 1 < n ? i + 1 : i;
+            f64x2 ll = {term_ll[i], term_ll[j]};
+            f64x2 mx = {max_ll[i], max_ll[j]}, sx = {sum_ll[i], sum_ll[j]};
+            f64x2 nmx = {max_nll[i], max_nll[j]}, nsx = {sum_nll[i], sum_nll[j]};
+            f64x2 mu = {mean[i], mean[j]}, q = {m2[i], m2[j]};
+            lse_push2(ll, mx, sx);
+            lse_push2(-ll, nmx, nsx);
+            f64x2 delta = ll - mu;
+            mu += delta / draws;
+            q += delta * (ll - mu);
+            max_ll[j] = mx[1]; sum_ll[j] = sx[1]; max_nll[j] = nmx[1]; sum_nll[j] = nsx[1]; mean[j] = mu[1]; m2[j] = q[1];
+            max_ll[i] = mx[0]; sum_ll[i] = sx[0]; max_nll[i] = nmx[0]; sum_nll[i] = nsx[0]; mean[i] = mu[0]; m2[i] = q[0];
+        }
+        
+        for (size_t i = 0; i < n; ++i) {
+            const double ll = term_ll[i];
+            double* h = heap.data() + i * capacity;
+            int& size = heap_size[i];
+            if (size < capacity) {
+                h[size++] = ll;
+                std::push_heap(h, h + size);
+            } else if (ll < h[0]) {
+                std::pop_heap(h, h + size);
+                h[size - 1] = ll;
+                std::push_heap(h, h + size);
+            }
+        }
+    }
+    
+    // PSIS-LOO and WAIC from one or more accumulators over the same data
+    // (e.g. the cold chains of an ensemble's replicas)
+    static LooSummary estimate(const std::vector<const PointwiseLoo*>& parts) {
+        LooSummary out;
+        if (parts.empty() || !parts[0]->active()) return out;
+        const PointwiseLoo& ref = *parts[0];
+        int S = 0;
+        for (const auto* part : parts) S += part->n_draws;
+        out.n_draws = S;
+        if (S < 2) return out;
+        
+        const size_t n = ref.term_titre.size();
+        double total_w = 0.0, max_k = -INFINITY;
+        double sum_loo = 0.0, sq_loo = 0.0, sum_waic = 0.0, sq_waic = 0.0, sum_lppd = 0.0, sum_pw = 0.0;
+        int high_k = 0;
+        std::vector<double> tail, x;
+        for (size_t i = 0; i < n; ++i) {
+            // Pool the parts: log-sum-exps, Chan's merge of the moments, and the
+            // smallest ll values of the union
+            double mx = -INFINITY, s = 0.0, nmx = -INFINITY, ns = 0.0, mu = 0.0, q = 0.0;
+            int count = 0;
+            tail.clear();
+            for (const auto* part : parts) {
+                if (part->n_draws == 0) continue;
+                lse_merge(part->max_ll[i], part->sum_ll[i], mx, s);
+                lse_merge(part->max_nll[i], part->sum_nll[i], nmx, ns);
+                int c = count + part->n_draws;
+                double delta = part->mean[i] - mu;
+                mu += delta * part->n_draws / c;
+                q += part->m2[i] + delta * delta * static_cast<double>(count) * part->n_draws / c;
+                count = c;
+                const double* h = part->heap.data() + i * part->capacity;
+                tail.insert(tail.end(), h, h + part->heap_size[i]);
+            }
+            std::sort(tail.begin(), tail.end()); // Ascending ll: descending log ratio
+            
+            double lppd = std::log(s) + mx - std::log(static_cast<double>(S));
+            double p_waic = q / (S - 1);
+            
+            // Log ratios r = -ll shifted by their maximum; the M largest are
+            // replaced by Pareto quantiles, truncated at the largest raw ratio
+            int M = std::min(tail_length(S), static_cast<int>(tail.size()) - 1);
+            double lr_max = -tail[0];
+            double k = INFINITY;
+            double log_num = std::log(static_cast<double>(S)) - lr_max; // Raw weights: each w_s p_s = exp(-lr_max)
+            double den = std::exp(nmx - lr_max) * ns;
+            if (M >= 5) {
+                double cutoff = std::exp(-tail[M] - lr_max);
+                x.resize(M);
+                for (int j = 0; j < M; ++j) x[j] = std::exp(-tail[M - 1 - j] - lr_max) - cutoff;
+                double sigma;
+                if (fit_generalized_pareto(x, k, sigma)) {
+                    double raw_tail = 0.0, smooth_tail = 0.0;
+                    double lnum_max = std::log(static_cast<double>(S - M)) - lr_max;
+                    std::vector<double> terms;
+                    terms.reserve(M + 1);
+                    terms.push_back(lnum_max);
+                    for (int j = 0; j < M; ++j) {
+                        double lr = -tail[M - 1 - j] - lr_max;
+                        double lw = std::min(0.0, std::log(generalized_pareto_quantile((j + 0.5) / M, k, sigma) + cutoff));
+                        raw_tail += std::exp(lr);
+                        smooth_tail += std::exp(lw);
+                        terms.push_back(lw - (lr + lr_max)); // log(w_j p_j) with ll_j = -(lr + lr_max)
+                        lnum_max = std::max(lnum_max, terms.back());
+                    }
+                    double acc = 0.0;
+                    for (double t : terms) acc += std::exp(t - lnum_max);
+                    log_num = lnum_max + std::log(acc);
+                    // Non-tail mass by difference, bounded by (S - M) draws at the cutoff
+                    double body = std::min(std::max(den - raw_tail, 0.0), (S - M) * cutoff);
+                    den = body + smooth_tail;
+                } else {
+                    k = INFINITY;
+                }
+            }
+            double elpd_loo = log_num - std::log(den);
+            
+            double w = ref.term_weight[i];
+            double waic_i = lppd - p_waic;
+            total_w += w;
+            sum_loo += w * elpd_loo;
+            sq_loo += w * elpd_loo * elpd_loo;
+            sum_waic += w * waic_i;
+            sq_waic += w * waic_i * waic_i;
+            sum_lppd += w * lppd;
+            sum_pw += w * p_waic;
+            max_k = std::max(max_k, k);
+            if (!(k <= 0.7)) high_k += static_cast<int>(w);
+        }
+        
+        // Standard errors over observations: sqrt(n * var of the pointwise terms)
+        auto se = [total_w](double sum, double sq) {
+            double var = (sq - sum * sum / total_w) / std::max(1.0, total_w - 1.0);
+            return std::sqrt(std::max(0.0, total_w * var));
+        };
+        out.elpd_loo = sum_loo;
+        out.se_elpd_loo = se(sum_loo, sq_loo);
+        out.p_loo = sum_lppd - sum_loo;
+        out.looic = -2.0 * sum_loo;
+        out.elpd_waic = sum_waic;
+        out.se_elpd_waic = se(sum_waic, sq_waic);
+        out.p_waic = sum_pw;
+        out.waic = -2.0 * sum_waic;
+        out.max_pareto_k = max_k;
+        out.n_high_k = high_k;
+        return out;
+    }
+};
+
+// Swaps are attempted on iterations that are multiples of this interval
+const int SWAP_INTERVAL = 10;
+
+// Last iteration of the stepping block starting at iter: the next swap iteration
+inline int block_end(int iter, int end) {
+    int swap_iter = (iter + SWAP_INTERVAL - 1) / SWAP_INTERVAL * SWAP_INTERVAL;
+    return std::min(swap_iter, end - 1);
+}
+
+// Warmup tuning of the temperature ladder. Adaptation rounds happen after
+// 10, 20, 40, ... swap rounds (doubling windows) until adapt_until; each one
+// re-places the rungs so every adjacent pair sees the same rejection rate.
+struct LadderPolicy {
+    int adapt_until;         // Adapt during iterations before this (<= 0: fixed geometric ladder)
+    double max_temperature;  // Temperature of the hottest rung
+    double target_swap_rate; // Per-pair acceptance used to recommend a rung count
+    int min_rungs;
+    bool trim;               // Drop surplus rungs at the last adaptation round
+    
+    LadderPolicy() : adapt_until(0), max_temperature(10.0), target_swap_rate(0.5), min_rungs(2), trim(false) {}
+};
+
+// Place n inverse temperatures in [beta_min, 1] so that the piecewise-linear
+// cumulative rejection Lambda(beta) through (betas[i], cum[i]) is equally
+// spaced between rungs (Syed et al. 2021). betas descend from 1, cum ascends.
+inline std::vector<double> equalize_ladder(const std::vector<double>& betas, const std::vector<double>& cum, int n) {
+    std::vector<double> out(n, 1.0);
+    const double total = cum.back();
+    size_t seg = 0;
+    for (int k = 1; k < n; ++k) {
+        double target = total * k / (n - 1);
+        while (seg + 2 < cum.size() && cum[seg + 1] < target) ++seg;
+        double rise = cum[seg + 1] - cum[seg];
+        double w = rise > 0.0 ? std::min(1.0, std::max(0.0, (target - cum[seg]) / rise)) : 1.0;
+        out[k] = betas[seg] + w * (betas[seg + 1] - betas[seg]);
+    }
+    out[n - 1] = betas.back();
+    return out;
+}
+
+// Resumable-run state: iteration counter, progress reporting and an optional
+// convergence-based stopping rule evaluated at block boundaries.
+struct RunControl {
+    int iteration;
+    std::function<void(int)> progress;
+    int progress_every;
+    double max_rhat;  // Stop once every R-hat is below this (<= 0: ignore)
+    double min_ess;   // ...and every bulk ESS is above this (<= 0: ignore)
+    int check_every;
+    bool converged;
+    PhaseTimes times;
+    
+    RunControl() : iteration(0), progress_every(100), max_rhat(0.0), min_ess(0.0), check_every(500), converged(false) {}
+    
+    bool stopping_enabled() const { return max_rhat > 0.0 || min_ess > 0.0; }
+    
+    // Everything but the progress callback, which belongs to the caller
+    void save(ByteWriter& out) const {
+        out.put<int32_t>(iteration);
+        out.put<int32_t>(progress_every);
+        out.put(max_rhat);
+        out.put(min_ess);
+        out.put<int32_t>(check_every);
+        out.put<uint8_t>(converged ? 1 : 0);
+        out.put(times);
+    }
+    
+    bool load(ByteReader& in) {
+        uint8_t conv = 0;
+        in.get(iteration);
+        in.get(progress_every);
+        in.get(max_rhat);
+        in.get(min_ess);
+        in.get(check_every);
+        in.get(conv);
+        in.get(times);
+        converged = conv != 0;
+        // The setters clamp these; a crafted checkpoint must not bypass them
+        if (!in.good() || iteration < 0 || progress_every < 1 || check_every < SWAP_INTERVAL) return in.fail();
+        return true;
+    }
+    
+    // Diagnostics are taken over the second half of the run, and never over
+    // iterations before the sampler's adaptation_end() (see run_schedule)
+    bool targets_met(const std::vector<double>& rhat, const std::vector<double>& ess) const {
+        for (double r : rhat) if (max_rhat > 0.0 && !(r < max_rhat)) return false;
+        for (double e : ess) if (min_ess > 0.0 && !(e >= min_ess)) return false;
+        return true;
+    }
+};
+
+// Warmup used by the stopping rule: the first half of the run, or every
+// iteration up to the adaptation boundary if that is later
+inline int diagnostic_warmup(const RunControl& ctl, int boundary) {
+    return std::max(ctl.iteration / 2, boundary);
+}
+
+// Advance a sampler by up to k iterations on the shared block schedule:
+// step_all(n) between swap points, swap_all() on swap iterations. Returns the
+// number of iterations run, which is less than k once the stopping rule fires.
+// The rule is only evaluated after sampler.adaptation_end(), so a run never
+// stops on draws taken while the ladder, NUTS or LOO were still warming up.
+template <typename Sampler>
+int run_schedule(Sampler& sampler, RunControl& ctl, int k) {
+    const int start = ctl.iteration;
+    const int end = start + std::max(0, k);
+    sampler.reserve_until(end);
+    while (ctl.iteration < end && !ctl.converged) {
+        int prev = ctl.iteration;
+        int last = block_end(prev, end);
+        {
+            PhaseTimer timer(ctl.times.step);
+            sampler.step_all(last - prev + 1);
+        }
+        if (last % SWAP_INTERVAL == 0) {
+            PhaseTimer timer(ctl.times.swap);
+            sampler.swap_all();
+        }
+        ctl.iteration = last + 1;
+        
+        if (ctl.progress && ctl.iteration / ctl.progress_every > prev / ctl.progress_every) {
+            PhaseTimer timer(ctl.times.progress);
+            ctl.progress(ctl.iteration);
+        }
+        if (ctl.stopping_enabled() && ctl.iteration / ctl.check_every > prev / ctl.check_every) {
+            const int boundary = sampler.adaptation_end();
+            if (ctl.iteration > boundary) {
+                PhaseTimer timer(ctl.times.check);
+                ctl.converged = sampler.check_convergence(diagnostic_warmup(ctl, boundary));
+            }
+        }
+    }
+    return ctl.iteration - start;
+}
+
+// Checkpoint framing: magic "PTMC", format version, sampler kind, curve
+// model and draw encoding, then the sampler's payload and an FNV-1a hash of
+// everything before it, so truncated or corrupted checkpoints are rejected
+const uint32_t CHECKPOINT_VERSION = 1;
+enum CheckpointKind {
+    CHECKPOINT_LADDER = 1,   // ParallelTemperingMCMC
+    CHECKPOINT_ENSEMBLE = 2, // ParallelTemperingEnsemble
+    CHECKPOINT_PANEL = 3     // BiomarkerPanel
+};
+
+inline uint64_t fnv1a(const uint8_t* p, size_t n) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < n; ++i) h = (h ^ p[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+// Free-parameter bits of the curve model (floor, ceiling)
+template <class Model>
+inline uint8_t checkpoint_model_tag() {
+    return (Model::is_free(0) ? 1 : 0) | (Model::is_free(1) ? 2 : 0);
+}
+
+// Writes the header; returns the draw encoding actually used
+template <class Model>
+inline int begin_checkpoint(ByteWriter& out, int kind, int encoding) {
+    if (encoding != DRAWS_FLOAT32 && encoding != DRAWS_DELTA) encoding = DRAWS_FLOAT64;
+    out.bytes.insert(out.bytes.end(), {'P', 'T', 'M', 'C'});
+    out.put(CHECKPOINT_VERSION);
+    out.put<uint8_t>(kind);
+    out.put<uint8_t>(checkpoint_model_tag<Model>());
+    out.put<uint8_t>(encoding);
+    out.put<uint8_t>(0); // Reserved
+    return encoding;
+}
+
+inline void end_checkpoint(ByteWriter& out) {
+    out.put(fnv1a(out.bytes.data(), out.bytes.size()));
+}
+
+// Checks the framing for the expected sampler kind and model; on success in
+// reads the payload and encoding is the stored draw encoding
+template <class Model>
+inline bool open_checkpoint(const uint8_t* bytes, size_t n, int kind, ByteReader& in, int& encoding) {
+    const size_t header = 12, trailer = sizeof(uint64_t);
+    if (!bytes || n < header + trailer || std::memcmp(bytes, "PTMC", 4) != 0) return false;
+    uint64_t hash;
+    std::memcpy(&hash, bytes + n - trailer, trailer);
+    if (hash != fnv1a(bytes, n - trailer)) return false;
+    uint32_t version;
+    std::memcpy(&version, bytes + 4, sizeof version);
+    if (version != CHECKPOINT_VERSION || bytes[8] != kind || bytes[9] != checkpoint_model_tag<Model>() || bytes[10] > DRAWS_DELTA) {
+        return false;
+    }
+    encoding = bytes[10];
+    in = ByteReader(bytes + header, n - header - trailer);
+    return true;
+}
+
+// Parallel Tempering MCMC Engine for one curve model (see CurveModel)
+template <class Model>
+class ParallelTemperingMCMCT {
+private:
+    std::vector<MCMCChain<Model>> chains;
+    std::vector<double> temperatures;
+    std::shared_ptr<const Data> data; // Shared read-only with other ladders in an ensemble
+    Priors priors;
+    int num_chains;
+    int swap_accepted;
+    int swap_total;
+    int swap_round;
+    std::vector<int> pair_attempts; // Per adjacent pair (i, i+1), since the last ladder adaptation
+    std::vector<int> pair_accepts;
+    std::vector<int> pair_attempts_run; // The same over the whole run, for get_stats()
+    std::vector<int> pair_accepts_run;
+    RngStream stream; // Swap decisions and starting points
+    FlatDraws exported;
+    WeightedDraws reweighted; // Cold-chain draws weighted by reweight_priors
+    std::vector<uint8_t> checkpoint; // Last serialize() output, or bytes to deserialize()
+    RetentionPolicy retention;
+    LadderPolicy ladder;
+    int next_adapt_round;
+    double barrier; // Estimated global communication barrier Lambda
+    PointwiseLoo pointwise; // Cold-chain pointwise log-likelihood statistics
+    std::shared_ptr<const LikelihoodSubsampler<Model>> subsampler; // Null: full likelihood
+    
+    void reset_pair_stats() {
+        pair_attempts.assign(std::max(0, num_chains - 1), 0);
+        pair_accepts.assign(std::max(0, num_chains - 1), 0);
+    }
+    
+    // Geometric spacing from T = 1 to the policy's hottest temperature
+    void set_geometric_ladder() {
+        temperatures.resize(num_chains);
+        for (int i = 0; i < num_chains; ++i) {
+            temperatures[i] = num_chains > 1 ? std::pow(ladder.max_temperature, static_cast<double>(i) / (num_chains - 1)) : 1.0;
+        }
+        for (size_t i = 0; i < chains.size(); ++i) chains[i].set_temperature(temperatures[i]);
+    }
+    
+    // Re-place the rungs from the rejection rates seen since the last round,
+    // optionally dropping the hottest surplus chains first
+    void adapt_ladder(bool last_round) {
+        std::vector<double> betas(num_chains), cum(num_chains, 0.0);
+        for (int i = 0; i < num_chains; ++i) betas[i] = 1.0 / temperatures[i];
+        for (int i = 0; i + 1 < num_chains; ++i) {
+            double reject = pair_attempts[i] > 0 ? 1.0 - static_cast<double>(pair_accepts[i]) / pair_attempts[i] : 0.5;
+            cum[i + 1] = cum[i] + std::max(reject, 1e-3); // Keep the map strictly increasing
+        }
+        barrier = cum.back();
+        
+        int n = num_chains;
+        if (last_round && ladder.trim) {
+            n = std::min(num_chains, recommend_num_chains());
+        }
+        std::vector<double> new_betas = equalize_ladder(betas, cum, n);
+        if (n < num_chains) {
+            chains.erase(chains.begin() + n, chains.end());
+            num_chains = n;
+            pair_attempts_run.resize(num_chains - 1);
+            pair_accepts_run.resize(num_chains - 1);
+        }
+        temperatures.resize(num_chains);
+        for (int i = 0; i < num_chains; ++i) {
+            temperatures[i] = 1.0 / new_betas[i];
+            chains[i].set_temperature(temperatures[i]);
+        }
+        reset_pair_stats();
+    }
+    
+    void init_chains() {
+        reset_pair_stats();
+        pair_attempts_run = pair_attempts;
+        pair_accepts_run = pair_accepts;
+        next_adapt_round = 10;
+        barrier = 0.0;
+        
+        // Set up temperature ladder: geometric spacing
+        set_geometric_ladder();
+        
+        // Initialize chains with random starting points
+        stream = root_split();
+        for (int i = 0; i < num_chains; ++i) {
+            double u[4];
+            for (double& v : u) v = stream.uniform();
+            Params init(0.01 + 0.49 * u[0], 0.1 + 0.8 * u[1], -2.0 + 4.0 * u[2], 0.1 + 2.9 * u[3]);
+            Model::fix(init);
+            chains.emplace_back(temperatures[i], init, *data, priors, root_split());
+        }
+        set_retention(retention);
+    }
+    
+public:
+    RunControl control;
+    
+    ParallelTemperingMCMCT(int n_chains, const Data& d, const Priors& p)
+        : data(std::make_shared<const Data>(d)), priors(p), num_chains(n_chains),
+          swap_accepted(0), swap_total(0), swap_round(0) {
+        init_chains();
+    }
+    
+    ParallelTemperingMCMCT(int n_chains, std::shared_ptr<const Data> d, const Priors& p)
+        : data(std::move(d)), priors(p), num_chains(n_chains),
+          swap_accepted(0), swap_total(0), swap_round(0) {
+        init_chains();
+    }
+    
+    // Empty sampler, only to be filled by deserialize()
+    ParallelTemperingMCMCT()
+        : data(std::make_shared<const Data>()), num_chains(0), swap_accepted(0), swap_total(0), swap_round(0),
+          next_adapt_round(10), barrier(0.0) {}
+    
+    // Ladder state without the data, priors and subsampler, which an
+    // ensemble shares between its ladders
+    void save_state(ByteWriter& out, int encoding) const {
+        out.put<int32_t>(num_chains);
+        out.put_vector(temperatures);
+        out.put<int32_t>(swap_accepted);
+        out.put<int32_t>(swap_total);
+        out.put<int32_t>(swap_round);
+        for (const auto* v : {&pair_attempts, &pair_accepts, &pair_attempts_run, &pair_accepts_run}) out.put_vector(*v);
+        stream.save(out);
+        out.put<int32_t>(retention.store_rungs);
+        out.put<int32_t>(retention.thin);
+        out.put<int32_t>(retention.discard_warmup);
+        out.put<int32_t>(retention.capacity);
+        out.put<int32_t>(ladder.adapt_until);
+        out.put(ladder.max_temperature);
+        out.put(ladder.target_swap_rate);
+        out.put<int32_t>(ladder.min_rungs);
+        out.put<uint8_t>(ladder.trim ? 1 : 0);
+        out.put<int32_t>(next_adapt_round);
+        out.put(barrier);
+        pointwise.save(out);
+        control.save(out);
+        for (const auto& chain : chains) chain.save(out, encoding);
+    }
+    
+    bool load_state(ByteReader& in, int encoding, std::shared_ptr<const Data> d, const Priors& p,
+                    std::shared_ptr<const LikelihoodSubsampler<Model>> sub) {
+        data = std::move(d);
+        priors = p;
+        subsampler = std::move(sub);
+        uint8_t trim = 0;
+        in.get(num_chains);
+        in.get_vector(temperatures);
+        in.get(swap_accepted);
+        in.get(swap_total);
+        in.get(swap_round);
+        for (auto* v : {&pair_attempts, &pair_accepts, &pair_attempts_run, &pair_accepts_run}) in.get_vector(*v);
+        stream.load(in);
+        in.get(retention.store_rungs);
+        in.get(retention.thin);
+        in.get(retention.discard_warmup);
+        in.get(retention.capacity);
+        in.get(ladder.adapt_until);
+        in.get(ladder.max_temperature);
+        in.get(ladder.target_swap_rate);
+        in.get(ladder.min_rungs);
+        in.get(trim);
+        in.get(next_adapt_round);
+        in.get(barrier);
+        pointwise.load(in, *data);
+        control.load(in);
+        ladder.trim = trim != 0;
+        const size_t pairs = static_cast<size_t>(std::max(0, num_chains - 1));
+        if (!in.good() || num_chains < 1 || temperatures.size() != static_cast<size_t>(num_chains) ||
+            pair_attempts.size() != pairs || pair_accepts.size() != pairs ||
+            pair_attempts_run.size() != pairs || pair_accepts_run.size() != pairs) {
+            return in.fail();
+        }
+        chains.assign(num_chains, MCMCChain<Model>());
+        for (auto& chain : chains) {
+            if (!chain.load(in, encoding)) return false;
+        }
+        return true;
+    }
+    
+    // Self-contained form: data, priors and subsampling settings first. The
+    // subsampling proxy is rebuilt, which reproduces it exactly.
+    void save(ByteWriter& out, int encoding) const {
+        data->save(out);
+        out.put(priors);
+        out.put<int32_t>(subsampler ? subsampler->get_batch_size() : 0);
+        save_state(out, encoding);
+    }
+    
+    bool load(ByteReader& in, int encoding) {
+        auto d = std::make_shared<Data>();
+        Priors p;
+        int32_t batch = 0;
+        d->load(in);
+        in.get(p);
+        in.get(batch);
+        if (!in.good()) return false;
+        std::shared_ptr<const Data> shared(std::move(d));
+        auto sub = batch > 0 ? std::make_shared<const LikelihoodSubsampler<Model>>(shared, p, prior_centre(p), batch) : nullptr;
+        return load_state(in, encoding, shared, p, sub);
+    }
+    
+    // Checkpoint of the complete sampler state (chains, proposals, NUTS
+    // tuning, random streams, swap and ladder statistics, diagnostics and
+    // retained draws) together with its data and priors. Writes the buffer
+    // read by get_checkpoint_view() / get_checkpoint() and returns its size
+    // in bytes; draw_encoding (DrawEncoding) only affects the retained draws.
+    int serialize(int draw_encoding) {
+        ByteWriter out;
+        int encoding = begin_checkpoint<Model>(out, CHECKPOINT_LADDER, draw_encoding);
+        save(out, encoding);
+        end_checkpoint(out);
+        checkpoint.swap(out.bytes);
+        return static_cast<int>(checkpoint.size());
+    }
+    
+    // Replace this sampler by a checkpoint's; on failure (wrong kind or
+    // model, version mismatch, corruption) nothing changes. A restored run
+    // continues exactly as the original would have. The progress callback
+    // is kept.
+    bool deserialize(const uint8_t* bytes, size_t n) {
+        ByteReader in(nullptr, 0);
+        int encoding;
+        if (!open_checkpoint<Model>(bytes, n, CHECKPOINT_LADDER, in, encoding)) return false;
+        ParallelTemperingMCMCT restored;
+        if (!restored.load(in, encoding) || in.remaining() != 0) return false;
+        restored.control.progress = std::move(control.progress);
+        restored.checkpoint.swap(checkpoint);
+        *this = std::move(restored);
+        return true;
+    }
+    
+    // From the checkpoint buffer, filled through resize_checkpoint() and
+    // get_checkpoint_view()
+    bool deserialize() {
+        return deserialize(checkpoint.data(), checkpoint.size());
+    }
+    
+    void resize_checkpoint(int n) {
+        checkpoint.resize(std::max(0, n));
+    }
+    
+#ifdef __EMSCRIPTEN__
+    // Zero-copy Uint8Array over the checkpoint buffer; invalidated by heap growth
+    val get_checkpoint_view() const {
+        return val(typed_memory_view(checkpoint.size(), checkpoint.data()));
+    }
+#endif
+    
+    const std::vector<uint8_t>& get_checkpoint() const {
+        return checkpoint;
+    }
+    
+    int get_num_chains() const { return num_chains; }
+    
+    // Warm start from an earlier fit of the same model, e.g. to refit after
+    // the priors or data changed slightly: adopts its ladder (rung count,
+    // temperatures and barrier estimate), and each rung continues from the
+    // earlier rung's state, proposal adaptation and NUTS tuning, re-scored
+    // under this sampler's data and priors. Call before running; the random
+    // streams stay this sampler's own.
+    void warm_start(const ParallelTemperingMCMCT& previous) {
+        const int n = previous.num_chains;
+        if (n < num_chains) chains.erase(chains.begin() + n, chains.end());
+        for (int i = num_chains; i < n; ++i) {
+            chains.emplace_back(previous.temperatures[i], previous.chains[i].get_current(), *data, priors, stream.split());
+        }
+        num_chains = n;
+        temperatures = previous.temperatures;
+        barrier = previous.barrier;
+        for (int i = 0; i < num_chains; ++i) {
+            chains[i].set_temperature(temperatures[i]);
+            chains[i].warm_start(previous.chains[i], *data, priors);
+        }
+        reset_pair_stats();
+        pair_attempts_run.resize(std::max(0, num_chains - 1));
+        pair_accepts_run.resize(std::max(0, num_chains - 1));
+        set_retention(retention);
+    }
+    
+    // Advance one chain by n_steps; chains are independent between swaps
+    void step_chain(int c, int n_steps) {
+        for (int k = 0; k < n_steps; ++k) {
+            chains[c].step(*data, priors, subsampler.get());
+            if (c == 0) pointwise.record(chains[0].get_iterations() - 1, chains[0].get_current());
+        }
+    }
+    
+    void step_all(int n_steps) {
+        parallel_for(num_chains, [&](int c) { step_chain(c, n_steps); });
+    }
+    
+    // Swap round of the deterministic even/odd (non-reversible) schedule:
+    // even rounds propose every pair (i, i+1) with even i, odd rounds odd i.
+    // Swap moves only exchange cached states, so a round costs O(num_chains).
+    void attempt_swap() {
+        if (num_chains < 2) return;
+        for (int i = swap_round % 2; i + 1 < num_chains; i += 2) {
+            int j = i + 1;
+            
+            // Only the untempered likelihood differs between the two targets
+            double log_alpha;
+            // ENGINE_MIXED scores the cold rung in double and rung 1 in float,
+            // and a subsampler leaves noisy estimates cached, so each state of
+            // the cold pair is scored on the full data at the other rung's
+            // precision and the test compares the two targets exactly. Heated
+            // pairs trade their cached estimates: approximate, but they only
+            // feed the cold chain through this pair.
+            const bool rescore = i == 0 && (data->engine == ENGINE_MIXED || subsampler);
+            double ll_cold = 0.0, ll_heated = 0.0;
+            if (rescore) {
+                ll_cold = chains[0].score_likelihood(chains[j].get_current(), *data);
+                ll_heated = chains[j].score_likelihood(chains[0].get_current(), *data);
+                log_alpha = (ll_cold - chains[0].get_log_likelihood()) / temperatures[0] +
+                            (ll_heated - chains[j].get_log_likelihood()) / temperatures[j];
+            } else {
+                log_alpha = (chains[i].get_log_likelihood() - chains[j].get_log_likelihood()) *
+                            (1.0 / temperatures[j] - 1.0 / temperatures[i]);
+            }
+            
+            swap_total++;
+            pair_attempts[i]++;
+            pair_attempts_run[i]++;
+            if (std::log(stream.uniform_pos()) < log_alpha) {
+                if (rescore) {
+                    chains[0].swap_state(chains[j], ll_cold, ll_heated);
+                } else {
+                    chains[i].swap_state(chains[j]);
+                }
+                swap_accepted++;
+                pair_accepts[i]++;
+                pair_accepts_run[i]++;
+            }
+        }
+        swap_round++;
+        
+        if (num_chains > 2 && swap_round == next_adapt_round && swap_round * SWAP_INTERVAL < ladder.adapt_until) {
+            next_adapt_round *= 2;
+            adapt_ladder(next_adapt_round * SWAP_INTERVAL >= ladder.adapt_until);
+        }
+    }
+    
+    // Configure ladder adaptation. Before any iterations have run this also
+    // rebuilds the geometric starting ladder for the new max_temperature.
+    void set_ladder_policy(const LadderPolicy& policy) {
+        ladder = policy;
+        ladder.max_temperature = std::max(1.0, policy.max_temperature);
+        ladder.min_rungs = std::max(2, policy.min_rungs);
+        if (swap_round == 0) set_geometric_ladder();
+    }
+    
+    LadderPolicy get_ladder_policy() const { return ladder; }
+    
+    // Move type of the cold chain (MOVE_METROPOLIS or MOVE_NUTS); heated rungs
+    // keep the random walk. NUTS adapts over the next `warmup` iterations.
+    void set_cold_move(int move, int warmup) {
+        chains[0].set_move(move, warmup);
+    }
+    
+    // NUTS diagnostics of the cold chain: {step size, mean acceptance
+    // statistic, post-warmup divergences}
+    std::vector<double> get_cold_move_stats() const {
+        const NUTSKernel<Model>& k = chains[0].nuts_kernel();
+        return {k.get_step_size(), k.mean_accept, static_cast<double>(k.divergences)};
+    }
+    
+    std::vector<double> get_temperatures() const { return temperatures; }
+    
+    // Global communication barrier: the sum of adjacent rejection rates over the
+    // last adaptation window. Independent of the rung count for a fine ladder.
+    double get_barrier() const { return barrier; }
+    
+    // Rungs needed so that an equalized ladder reaches the target per-pair
+    // swap rate: each of the n - 1 pairs then rejects barrier / (n - 1)
+    int recommend_num_chains() const {
+        double reject = std::max(0.05, 1.0 - ladder.target_swap_rate);
+        int n = 1 + static_cast<int>(std::ceil(barrier / reject));
+        return std::max(ladder.min_rungs, n);
+    }
+    
+    // Acceptance rate of swaps between rungs i and i+1
+    std::vector<double> get_pair_swap_rates() const {
+        std::vector<double> rates;
+        for (int i = 0; i + 1 < num_chains; ++i) {
+            rates.push_back(pair_attempts[i] > 0 ? static_cast<double>(pair_accepts[i]) / pair_attempts[i] : 0.0);
+        }
+        return rates;
+    }
+    
+    void swap_all() { attempt_swap(); }
+    
+    // First iteration after ladder tuning and the cold chain's NUTS warmup
+    // have finished and pointwise LOO has started
+    int adaptation_end() const {
+        int end = num_chains > 2 ? ladder.adapt_until : 0;
+        if (chains[0].get_move() == MOVE_NUTS) {
+            end = std::max(end, control.iteration + chains[0].nuts_kernel().adaptation_remaining());
+        }
+        if (pointwise.active()) end = std::max(end, pointwise.get_start());
+        return end;
+    }
+    
+    // Warmup to read results with: the stopping rule's (see run_schedule)
+    int get_warmup() const { return diagnostic_warmup(control, adaptation_end()); }
+    
+    // Stopping rule on the cold chain's streaming split R-hat and ESS
+    bool check_convergence(int warmup) const {
+        if (chains[0].traces[0].num_batches(warmup) < 4) return false;
+        return control.targets_met(Model::free_values(compute_rhat(warmup)), Model::free_values(compute_ess(warmup)));
+    }
+    
+    // Run n more iterations (resumes where the previous call stopped)
+    void run(int n_iterations) {
+        run_schedule(*this, control, n_iterations);
+    }
+    
+    // Run up to k more iterations; returns how many ran before any early stop
+    int run_chunk(int k) {
+        return run_schedule(*this, control, k);
+    }
+    
+    int get_iteration() const { return control.iteration; }
+    bool is_converged() const { return control.converged; }
+    
+    // Stop once every parameter has R-hat < max_rhat and bulk ESS >= min_ess,
+    // checked every check_every iterations (targets <= 0 are ignored)
+    void set_stopping_rule(double max_rhat, double min_ess, int check_every) {
+        control.max_rhat = max_rhat;
+        control.min_ess = min_ess;
+        control.check_every = std::max(SWAP_INTERVAL, check_every);
+        control.converged = false;
+    }
+    
+    const DrawStore& cold_samples() const {
+        return chains[0].samples;
+    }
+    
+    // Choose which rungs store draws, thinning, warmup discard and ring
+    // capacity. Clears any draws stored so far.
+    void set_retention(const RetentionPolicy& policy) {
+        retention = policy;
+        for (int c = 0; c < num_chains; ++c) {
+            bool store = policy.store_rungs <= 0 || c < policy.store_rungs;
+            chains[c].samples.configure(store, policy);
+        }
+    }
+    
+    RetentionPolicy get_retention() const { return retention; }
+    
+    // Preallocate draw storage for a run ending at iteration `end`
+    void reserve_until(int end) {
+        for (auto& chain : chains) chain.samples.reserve_until(end);
+        pointwise.reserve_until(end);
+    }
+    
+    // Opt-in subsampled likelihood for large cohorts (see LikelihoodSubsampler):
+    // random-walk steps on a rung at temperature T touch about batch_size / T
+    // likelihood terms. Building the proxy takes a few full passes to find the
+    // posterior mode. batch_size <= 0 returns to the full likelihood.
+    void set_subsampling(int batch_size) {
+        set_subsampler(batch_size > 0
+            ? std::make_shared<const LikelihoodSubsampler<Model>>(data, priors, prior_centre(priors), batch_size)
+            : nullptr);
+    }
+    
+    // Share one subsampler between ladders over the same data and priors.
+    // Every chain restarts at the proxy's anchor, where the proxy is accurate;
+    // switching back off re-evaluates the chains' cached likelihoods exactly.
+    void set_subsampler(std::shared_ptr<const LikelihoodSubsampler<Model>> sub) {
+        subsampler = std::move(sub);
+        for (auto& chain : chains) {
+            chain.set_current(subsampler ? subsampler->get_anchor() : chain.get_current(), *data, priors);
+        }
+    }
+    
+    // Anchor of the subsampling proxy (the posterior mode estimate), or the
+    // default Params when subsampling is off
+    Params get_subsample_anchor() const {
+        return subsampler ? subsampler->get_anchor() : Params();
+    }
+    
+    // Accumulate pointwise log-likelihood statistics of the cold chain from
+    // iteration `start` on, for get_loo(); start < 0 turns this off. Costs
+    // one pass over the likelihood terms per cold-chain iteration.
+    void set_pointwise_loo(int start) {
+        pointwise.configure(*data, start < 0 ? -1 : std::max(start, control.iteration));
+    }
+    
+    const PointwiseLoo& cold_pointwise() const { return pointwise; }
+    
+    // PSIS-LOO and WAIC over the accumulated cold-chain draws
+    LooSummary get_loo() const {
+        return PointwiseLoo::estimate({&pointwise});
+    }
+    
+    // Write post-warmup, thinned cold-chain draws to the export buffer; returns draws per column
+    int export_draws(int warmup, int thin) {
+        PhaseTimer timer(control.times.output);
+        exported.fill({&chains[0].samples}, warmup, thin);
+        return exported.n_draws;
+    }
+    
+#ifdef __EMSCRIPTEN__
+    val get_draws_view() const {
+        return exported.view();
+    }
+#endif
+    
+    // The export buffer for native callers (layout as in FlatDraws)
+    const FlatDraws& get_exported() const {
+        return exported;
+    }
+    
+    // Mean and quantile bands of the infection probability over a titre grid
+    // from the cold chain's draws after warmup (layout as in curve_bands)
+    std::vector<double> curve_bands(const std::vector<double>& grid, int warmup, const std::vector<double>& probs) const {
+        FlatDraws draws;
+        draws.fill({&chains[0].samples}, warmup, 1);
+        return ::curve_bands(draws, grid, probs);
+    }
+    
+    // Mean, sd and quantiles of each parameter over the cold chain's draws
+    // after warmup (layout as in summarize_draws)
+    std::vector<double> summarize(int warmup, const std::vector<double>& probs) const {
+        FlatDraws draws;
+        draws.fill({&chains[0].samples}, warmup, 1);
+        return summarize_draws(draws, probs);
+    }
+    
+    // Prior sensitivity without a refit: Pareto-smoothed importance weights
+    // towards new_priors on the cold chain's draws after warmup. When the
+    // result is stable, summarize_reweighted and curve_bands_reweighted stand
+    // in for a run under new_priors; otherwise refit, warm-started from here.
+    PriorSensitivity reweight_priors(const Priors& new_priors, int warmup) {
+        reweighted.draws.fill({&chains[0].samples}, warmup, 1);
+        return reweight_to_priors<Model>(reweighted, priors, new_priors);
+    }
+    
+    // Summaries and curve bands of the draws weighted by the last reweight_priors
+    std::vector<double> summarize_reweighted(const std::vector<double>& probs) const {
+        return summarize_weighted(reweighted, probs);
+    }
+    
+    std::vector<double> curve_bands_reweighted(const std::vector<double>& grid, const std::vector<double>& probs) const {
+        return curve_bands_weighted(reweighted, grid, probs);
+    }
+    
+    // Observed vs posterior-predicted risk over titre bins (layout as in calibration_bands)
+    std::vector<double> calibration_bands(int n_bins, int warmup, const std::vector<double>& probs) const {
+        FlatDraws draws;
+        draws.fill({&chains[0].samples}, warmup, 1);
+        return ::calibration_bands(*data, draws, n_bins, probs);
+    }
+    
+    // ROC curve and AUC of the fitted risk score (see Data::roc_curve)
+    std::vector<double> roc_curve() const { return data->roc_curve(); }
+    double get_auc() const { return data->auc(); }
+    
+    // Get samples from cold chain (temperature = 1)
+    std::vector<Params> get_samples() const {
+        return chains[0].samples.to_vector(0);
+    }
+    
+    // Convergence diagnostics: split R-hat (Gelman-Rubin statistic) of the cold
+    // chain from its streaming batch statistics, over draws after warmup.
+    // Fixed parameters report NaN here and in every diagnostic below.
+    std::vector<double> compute_rhat(int warmup) const {
+        std::vector<double> rhat;
+        for (const auto& trace : chains[0].traces) {
+            if (trace.num_batches(warmup) < 4) return Model::mask_fixed({1.0, 1.0, 1.0, 1.0}); // Not enough samples
+            std::vector<Moments> halves(2);
+            trace.split_halves(warmup, halves[0], halves[1]);
+            rhat.push_back(rhat_from_moments(halves));
+        }
+        return Model::mask_fixed(rhat);
+    }
+    
+    // Effective sample size (ESS) from streaming batch means
+    std::vector<double> compute_ess(int warmup) const {
+        std::vector<double> ess;
+        for (const auto& trace : chains[0].traces) {
+            ess.push_back(trace.ess(warmup));
+        }
+        return Model::mask_fixed(ess);
+    }
+    
+    const OnlineTrace& cold_trace(int param) const {
+        return chains[0].traces[param];
+    }
+    
+    double get_swap_rate() const {
+        return swap_total > 0 ? static_cast<double>(swap_accepted) / swap_total : 0.0;
+    }
+    
+    std::vector<double> get_acceptance_rates() const {
+        std::vector<double> rates;
+        for (const auto& chain : chains) {
+            rates.push_back(chain.get_acceptance_rate());
+        }
+        return rates;
+    }
+    
+    // Work counters over every rung, swap counts per adjacent pair and phase
+    // times since construction (see SamplerStats)
+    SamplerStats get_stats() const {
+        SamplerStats stats;
+        stats.iterations = control.iteration;
+        for (const auto& chain : chains) stats.add_counters(chain.counters);
+        stats.swap_attempts = swap_total;
+        stats.swap_accepts = swap_accepted;
+        stats.pair_attempts.assign(pair_attempts_run.begin(), pair_attempts_run.end());
+        stats.pair_accepts.assign(pair_accepts_run.begin(), pair_accepts_run.end());
+        stats.add_times(control.times);
+        return stats;
+    }
+};
+
+typedef ParallelTemperingMCMCT<Model4PL> ParallelTemperingMCMC;
+
+// Ensemble of independent tempering ladders over one shared dataset.
+// All (replica, rung) chains are stepped together on the worker pool, and
+// convergence is assessed across replicas' cold chains.
+template <class Model>
+class ParallelTemperingEnsembleT {
+private:
+    std::shared_ptr<const Data> data;
+    std::vector<ParallelTemperingMCMCT<Model>> replicas;
+    int num_replicas;
+    int chains_per_replica;
+    std::vector<std::pair<int, int>> jobs; // (replica, rung) per pool job; ladders may be trimmed
+    FlatDraws exported;
+    WeightedDraws reweighted;
+    Priors priors;
+    std::shared_ptr<const LikelihoodSubsampler<Model>> subsampler;
+    std::vector<uint8_t> checkpoint;
+    
+    typedef double (*ChainDiagnostic)(const ChainDraws&);
+    
+    std::vector<double> per_param(int warmup, ChainDiagnostic diag, double fallback) const {
+        static double Params::* const fields[] = {&Params::floor, &Params::ceiling, &Params::ec50, &Params::slope};
+        std::vector<double> out;
+        for (int i = 0; i < 4; ++i) {
+            const auto field = fields[i];
+            if (!Model::is_free(i)) {
+                out.push_back(NAN);
+                continue;
+            }
+            ChainDraws draws;
+            for (const auto& r : replicas) draws.push_back(param_draws(r.cold_samples(), warmup, field));
+            out.push_back(draws[0].size() < 8 ? fallback : diag(draws));
+        }
+        return out;
+    }
+    
+public:
+    RunControl control;
+    
+    ParallelTemperingEnsembleT(int n_replicas, int n_chains, const Data& d, const Priors& p)
+        : ParallelTemperingEnsembleT(n_replicas, n_chains, std::make_shared<const Data>(d), p) {}
+    
+    ParallelTemperingEnsembleT(int n_replicas, int n_chains, std::shared_ptr<const Data> d, const Priors& p)
+        : data(std::move(d)), num_replicas(std::max(1, n_replicas)), chains_per_replica(n_chains), priors(p) {
+        replicas.reserve(num_replicas);
+        for (int r = 0; r < num_replicas; ++r) {
+            replicas.emplace_back(chains_per_replica, data, p);
+        }
+    }
+    
+    // Empty ensemble, only to be filled by deserialize()
+    ParallelTemperingEnsembleT() : data(std::make_shared<const Data>()), num_replicas(0), chains_per_replica(0) {}
+    
+    // Data, priors and subsampling settings once, then every replica's ladder state
+    void save(ByteWriter& out, int encoding) const {
+        data->save(out);
+        out.put(priors);
+        out.put<int32_t>(subsampler ? subsampler->get_batch_size() : 0);
+        out.put<int32_t>(num_replicas);
+        out.put<int32_t>(chains_per_replica);
+        control.save(out);
+        for (const auto& r : replicas) r.save_state(out, encoding);
+    }
+    
+    bool load(ByteReader& in, int encoding) {
+        auto d = std::make_shared<Data>();
+        int32_t batch = 0;
+        d->load(in);
+        in.get(priors);
+        in.get(batch);
+        in.get(num_replicas);
+        in.get(chains_per_replica);
+        control.load(in);
+        if (!in.good() || num_replicas < 1) return in.fail();
+        data = std::move(d);
+        subsampler = batch > 0
+            ? std::make_shared<const LikelihoodSubsampler<Model>>(data, priors, prior_centre(priors), batch)
+            : nullptr;
+        replicas.assign(num_replicas, ParallelTemperingMCMCT<Model>());
+        for (auto& r : replicas) {
+            if (!r.load_state(in, encoding, data, priors, subsampler)) return false;
+        }
+        return true;
+    }
+    
+    // Checkpoints of the whole ensemble (see ParallelTemperingMCMC::serialize)
+    int serialize(int draw_encoding) {
+        ByteWriter out;
+        int encoding = begin_checkpoint<Model>(out, CHECKPOINT_ENSEMBLE, draw_encoding);
+        save(out, encoding);
+        end_checkpoint(out);
+        checkpoint.swap(out.bytes);
+        return static_cast<int>(checkpoint.size());
+    }
+    
+    bool deserialize(const uint8_t* bytes, size_t n) {
+        ByteReader in(nullptr, 0);
+        int encoding;
+        if (!open_checkpoint<Model>(bytes, n, CHECKPOINT_ENSEMBLE, in, encoding)) return false;
+        ParallelTemperingEnsembleT restored;
+        if (!restored.load(in, encoding) || in.remaining() != 0) return false;
+        restored.control.progress = std::move(control.progress);
+        restored.checkpoint.swap(checkpoint);
+        *this = std::move(restored);
+        return true;
+    }
+    
+    bool deserialize() {
+        return deserialize(checkpoint.data(), checkpoint.size());
+    }
+    
+    void resize_checkpoint(int n) {
+        checkpoint.resize(std::max(0, n));
+    }
+    
+#ifdef __EMSCRIPTEN__
+    val get_checkpoint_view() const {
+        return val(typed_memory_view(checkpoint.size(), checkpoint.data()));
+    }
+#endif
+    
+    const std::vector<uint8_t>& get_checkpoint() const {
+        return checkpoint;
+    }
+    
+    // Warm start each replica from an earlier ensemble's replica (cycled when
+    // that ensemble had fewer); see ParallelTemperingMCMC::warm_start
+    void warm_start(const ParallelTemperingEnsembleT& previous) {
+        for (int r = 0; r < num_replicas; ++r) replicas[r].warm_start(previous.replicas[r % previous.num_replicas]);
+    }
+    
+    // Rebuild the (replica, rung) job table and return its size
+    int collect_jobs() {
+        jobs.clear();
+        for (int r = 0; r < num_replicas; ++r) {
+            for (int c = 0; c < replicas[r].get_num_chains(); ++c) jobs.emplace_back(r, c);
+        }
+        return static_cast<int>(jobs.size());
+    }
+    
+    void step_job(int job, int n_steps) {
+        replicas[jobs[job].first].step_chain(jobs[job].second, n_steps);
+    }
+    
+    void step_all(int n_steps) {
+        parallel_for(collect_jobs(), [&](int job) { step_job(job, n_steps); });
+    }
+    
+    void swap_all() {
+        for (auto& r : replicas) r.attempt_swap();
+    }
+    
+    // Whether the streaming diagnostics meet ctl's targets
+    bool targets_met(const RunControl& ctl, int warmup) const {
+        if (replicas[0].cold_trace(0).num_batches(warmup) < 4) return false;
+        return ctl.targets_met(Model::free_values(compute_rhat_online(warmup)),
+                               Model::free_values(compute_ess_online(warmup)));
+    }
+    
+    // Stopping rule on streaming statistics, so frequent checks stay cheap
+    bool check_convergence(int warmup) const {
+        return targets_met(control, warmup);
+    }
+    
+    int adaptation_end() const {
+        int end = 0;
+        for (const auto& r : replicas) end = std::max(end, r.adaptation_end());
+        return end;
+    }
+    
+    int get_warmup() const { return diagnostic_warmup(control, adaptation_end()); }
+    
+    void run(int n_iterations) {
+        run_schedule(*this, control, n_iterations);
+    }
+    
+    int run_chunk(int k) {
+        return run_schedule(*this, control, k);
+    }
+    
+    int get_iteration() const { return control.iteration; }
+    bool is_converged() const { return control.converged; }
+    
+    void set_stopping_rule(double max_rhat, double min_ess, int check_every) {
+        control.max_rhat = max_rhat;
+        control.min_ess = min_ess;
+        control.check_every = std::max(SWAP_INTERVAL, check_every);
+        control.converged = false;
+    }
+    
+    int get_num_replicas() const { return num_replicas; }
+    
+    void set_retention(const RetentionPolicy& policy) {
+        for (auto& r : replicas) r.set_retention(policy);
+    }
+    
+    RetentionPolicy get_retention() const { return replicas[0].get_retention(); }
+    
+    void reserve_until(int end) {
+        for (auto& r : replicas) r.reserve_until(end);
+    }
+    
+    void set_pointwise_loo(int start) {
+        for (auto& r : replicas) r.set_pointwise_loo(start);
+    }
+    
+    // PSIS-LOO and WAIC pooled over every replica's cold chain
+    LooSummary get_loo() const {
+        std::vector<const PointwiseLoo*> parts;
+        for (const auto& r : replicas) parts.push_back(&r.cold_pointwise());
+        return PointwiseLoo::estimate(parts);
+    }
+    
+    // Cold-chain samples of one replica
+    std::vector<Params> get_samples(int replica) const {
+        return replicas[replica].get_samples();
+    }
+    
+    // Export every replica's cold-chain draws, replica after replica within each
+    // column; returns draws per column (n_replicas * draws per replica)
+    int export_draws(int warmup, int thin) {
+        PhaseTimer timer(control.times.output);
+        std::vector<const DrawStore*> chains;
+        for (const auto& r : replicas) chains.push_back(&r.cold_samples());
+        exported.fill(chains, warmup, thin);
+        return exported.n_draws;
+    }
+    
+#ifdef __EMSCRIPTEN__
+    val get_draws_view() const {
+        return exported.view();
+    }
+#endif
+    
+    // The export buffer for native callers (layout as in FlatDraws)
+    const FlatDraws& get_exported() const {
+        return exported;
+    }
+    
+    // Every replica's cold-chain draws, back to back (layout as in FlatDraws)
+    FlatDraws pooled_draws(int warmup, int thin) const {
+        std::vector<const DrawStore*> chains;
+        for (const auto& r : replicas) chains.push_back(&r.cold_samples());
+        FlatDraws draws;
+        draws.fill(chains, warmup, thin);
+        return draws;
+    }
+    
+    // Curve bands pooled over every replica's cold chain
+    std::vector<double> curve_bands(const std::vector<double>& grid, int warmup, const std::vector<double>& probs) const {
+        std::vector<const DrawStore*> chains;
+        for (const auto& r : replicas) chains.push_back(&r.cold_samples());
+        FlatDraws draws;
+        draws.fill(chains, warmup, 1);
+        return ::curve_bands(draws, grid, probs);
+    }
+    
+    // Summaries pooled over every replica's cold chain
+    std::vector<double> summarize(int warmup, const std::vector<double>& probs) const {
+        std::vector<const DrawStore*> chains;
+        for (const auto& r : replicas) chains.push_back(&r.cold_samples());
+        FlatDraws draws;
+        draws.fill(chains, warmup, 1);
+        return summarize_draws(draws, probs);
+    }
+    
+    // Prior sensitivity over the pooled cold-chain draws (see
+    // ParallelTemperingMCMC::reweight_priors)
+    PriorSensitivity reweight_priors(const Priors& new_priors, int warmup) {
+        std::vector<const DrawStore*> chains;
+        for (const auto& r : replicas) chains.push_back(&r.cold_samples());
+        reweighted.draws.fill(chains, warmup, 1);
+        return reweight_to_priors<Model>(reweighted, priors, new_priors);
+    }
+    
+    std::vector<double> summarize_reweighted(const std::vector<double>& probs) const {
+        return summarize_weighted(reweighted, probs);
+    }
+    
+    std::vector<double> curve_bands_reweighted(const std::vector<double>& grid, const std::vector<double>& probs) const {
+        return curve_bands_weighted(reweighted, grid, probs);
+    }
+    
+    // Calibration bands pooled over every replica's cold chain
+    std::vector<double> calibration_bands(int n_bins, int warmup, const std::vector<double>& probs) const {
+        std::vector<const DrawStore*> chains;
+        for (const auto& r : replicas) chains.push_back(&r.cold_samples());
+        FlatDraws draws;
+        draws.fill(chains, warmup, 1);
+        return ::calibration_bands(*data, draws, n_bins, probs);
+    }
+    
+    std::vector<double> roc_curve() const { return data->roc_curve(); }
+    double get_auc() const { return data->auc(); }
+    
+    // Rank-normalized split R-hat across replicas (floor, ceiling, ec50, slope)
+    std::vector<double> compute_rhat(int warmup) const {
+        return per_param(warmup, &rank_normalized_rhat, 1.0);
+    }
+    
+    // Bulk effective sample size across replicas
+    std::vector<double> compute_ess_bulk(int warmup) const {
+        return per_param(warmup, &ess_bulk, 0.0);
+    }
+    
+    // Tail effective sample size across replicas
+    std::vector<double> compute_ess_tail(int warmup) const {
+        return per_param(warmup, &ess_tail, 0.0);
+    }
+    
+    // Split R-hat across replicas from streaming batch statistics: O(1) in the
+    // number of draws, unlike the rank-normalized compute_rhat
+    std::vector<double> compute_rhat_online(int warmup) const {
+        std::vector<double> rhat;
+        for (int param = 0; param < 4; ++param) {
+            std::vector<Moments> halves;
+            for (const auto& r : replicas) {
+                Moments a, b;
+                r.cold_trace(param).split_halves(warmup, a, b);
+                halves.push_back(a);
+                halves.push_back(b);
+            }
+            rhat.push_back(rhat_from_moments(halves));
+        }
+        return Model::mask_fixed(rhat);
+    }
+    
+    // Total batch-means ESS across replicas
+    std::vector<double> compute_ess_online(int warmup) const {
+        std::vector<double> ess;
+        for (int param = 0; param < 4; ++param) {
+            double total = 0.0;
+            for (const auto& r : replicas) total += r.cold_trace(param).ess(warmup);
+            ess.push_back(total);
+        }
+        return Model::mask_fixed(ess);
+    }
+    
+    std::vector<double> get_swap_rates() const {
+        std::vector<double> rates;
+        for (const auto& r : replicas) rates.push_back(r.get_swap_rate());
+        return rates;
+    }
+    
+    // Each replica tunes (and trims) its own ladder
+    void set_ladder_policy(const LadderPolicy& policy) {
+        for (auto& r : replicas) r.set_ladder_policy(policy);
+    }
+    
+    LadderPolicy get_ladder_policy() const { return replicas[0].get_ladder_policy(); }
+    
+    void set_cold_move(int move, int warmup) {
+        for (auto& r : replicas) r.set_cold_move(move, warmup);
+    }
+    
+    // Subsampled likelihood for every ladder (see ParallelTemperingMCMC),
+    // with the proxy built once and shared
+    void set_subsampling(int batch_size) {
+        subsampler = batch_size > 0
+            ? std::make_shared<const LikelihoodSubsampler<Model>>(data, priors, prior_centre(priors), batch_size)
+            : nullptr;
+        for (auto& r : replicas) r.set_subsampler(subsampler);
+    }
+    
+    Params get_subsample_anchor() const {
+        return subsampler ? subsampler->get_anchor() : Params();
+    }
+    
+    // Post-warmup NUTS divergences of each replica's cold chain
+    std::vector<int> get_divergences() const {
+        std::vector<int> out;
+        for (const auto& r : replicas) out.push_back(static_cast<int>(r.get_cold_move_stats()[2]));
+        return out;
+    }
+    
+    // Current rung count of each replica
+    std::vector<int> get_num_chains() const {
+        std::vector<int> counts;
+        for (const auto& r : replicas) counts.push_back(r.get_num_chains());
+        return counts;
+    }
+    
+    std::vector<double> get_temperatures(int replica) const {
+        return replicas[replica].get_temperatures();
+    }
+    
+    // Largest per-replica recommendation, so no ladder ends up under-provisioned
+    int recommend_num_chains() const {
+        int n = 0;
+        for (const auto& r : replicas) n = std::max(n, r.recommend_num_chains());
+        return n;
+    }
+    
+    // Counters and swaps summed over replicas (pairs by rung index); phase
+    // times of the ensemble's own schedule
+    SamplerStats get_stats() const {
+        SamplerStats stats;
+        stats.iterations = control.iteration;
+        for (const auto& r : replicas) stats.merge_work(r.get_stats());
+        stats.add_times(control.times);
+        return stats;
+    }
+};
+
+typedef ParallelTemperingEnsembleT<Model4PL> ParallelTemperingEnsemble;
+
+// Batched fit of a biomarker panel against one outcome vector. The titre
+// matrix is ingested once (biomarker-major), each biomarker gets its own
+// compressed Data and ensemble, and every biomarker x replica x rung chain is
+// stepped in a single pool dispatch per block.
+template <class Model>
+class BiomarkerPanelT {
+private:
+    int num_biomarkers;
+    int num_subjects;
+    std::vector<double> titres; // Row b holds biomarker b's titres for all subjects
+    std::vector<int> infected;  // Shared by every biomarker
+    std::vector<Priors> priors;
+    std::vector<ParallelTemperingEnsembleT<Model>> fits;
+    std::vector<std::pair<int, int>> jobs; // (biomarker, ensemble job)
+    std::vector<uint8_t> checkpoint;
+    
+public:
+    RunControl control;
+    
+    BiomarkerPanelT(int n_biomarkers, int n_subjects)
+        : num_biomarkers(std::max(0, n_biomarkers)), num_subjects(std::max(0, n_subjects)),
+          titres(static_cast<size_t>(num_biomarkers) * num_subjects), infected(num_subjects) {}
+    
+#ifdef __EMSCRIPTEN__
+    // Zero-copy views for bulk ingest; invalidated by heap growth
+    val titre_view() {
+        return val(typed_memory_view(titres.size(), titres.data()));
+    }
+    val infected_view() {
+        return val(typed_memory_view(infected.size(), infected.data()));
+    }
+#endif
+    
+    // Bulk ingest from native callers: biomarker-major titre matrix
+    // (n_biomarkers * n_subjects) and one outcome per subject
+    void assign(const double* t, const int* inf) {
+        std::copy(t, t + titres.size(), titres.begin());
+        std::copy(inf, inf + infected.size(), infected.begin());
+    }
+    
+    // Bulk ingest from a finished CsvParser with one column per biomarker and
+    // one row per subject; false if its shape does not match the panel
+    bool assign_csv(const CsvParser& csv) {
+        if (csv.get_error() != CSV_OK || csv.get_num_biomarkers() != num_biomarkers ||
+            csv.get_num_rows() != num_subjects) return false;
+        for (int b = 0; b < num_biomarkers; ++b) {
+            if (static_cast<int>(csv.get_column(b).size()) != num_subjects) return false;
+            std::copy(csv.get_column(b).begin(), csv.get_column(b).end(), titres.begin() + static_cast<size_t>(b) * num_subjects);
+        }
+        infected = csv.get_infected();
+        return true;
+    }
+    
+    // Build every biomarker's data and ensemble from the filled buffers. With
+    // data_driven_ec50 the ec50 prior is centred on the midpoint of that
+    // biomarker's titre range with sd = range / 4. Returns the number of
+    // outcomes that are not 0/1.
+    int prepare(int n_replicas, int n_chains, const Priors& base, bool data_driven_ec50, int engine) {
+        int invalid = 0;
+        for (int y : infected) invalid += (y != 0 && y != 1) ? 1 : 0;
+        
+        fits.clear();
+        priors.clear();
+        fits.reserve(num_biomarkers);
+        for (int b = 0; b < num_biomarkers; ++b) {
+            const double* row = titres.data() + static_cast<size_t>(b) * num_subjects;
+            auto d = std::make_shared<Data>();
+            d->assign(row, infected.data(), num_subjects);
+            d->compress();
+            d->set_engine(engine);
+            
+            Priors p = base;
+            if (data_driven_ec50 && num_subjects > 0) {
+                auto range = std::minmax_element(row, row + num_subjects);
+                double width = *range.second - *range.first;
+                p.ec50_mean = 0.5 * (*range.first + *range.second);
+                p.ec50_sd = width > 0.0 ? width / 4.0 : 1.0;
+            }
+            priors.push_back(p);
+            fits.emplace_back(n_replicas, n_chains, std::shared_ptr<const Data>(std::move(d)), p);
+        }
+        control = RunControl();
+        return invalid;
+    }
+    
+    int get_num_biomarkers() const { return num_biomarkers; }
+    Priors get_priors(int b) const { return priors[b]; }
+    
+    // Checkpoints of the raw panel and every prepared fit (see
+    // ParallelTemperingMCMC::serialize)
+    int serialize(int draw_encoding) {
+        ByteWriter out;
+        int encoding = begin_checkpoint<Model>(out, CHECKPOINT_PANEL, draw_encoding);
+        out.put<int32_t>(num_biomarkers);
+        out.put<int32_t>(num_subjects);
+        out.put_vector(titres);
+        out.put_vector(infected);
+        out.put_vector(priors);
+        out.put<int32_t>(static_cast<int32_t>(fits.size()));
+        for (const auto& f : fits) f.save(out, encoding);
+        control.save(out);
+        end_checkpoint(out);
+        checkpoint.swap(out.bytes);
+        return static_cast<int>(checkpoint.size());
+    }
+    
+    bool deserialize(const uint8_t* bytes, size_t n) {
+        ByteReader in(nullptr, 0);
+        int encoding;
+        if (!open_checkpoint<Model>(bytes, n, CHECKPOINT_PANEL, in, encoding)) return false;
+        BiomarkerPanelT restored(0, 0);
+        int32_t n_fits = 0;
+        in.get(restored.num_biomarkers);
+        in.get(restored.num_subjects);
+        in.get_vector(restored.titres);
+        in.get_vector(restored.infected);
+        in.get_vector(restored.priors);
+        in.get(n_fits);
+        if (!in.good() || restored.num_biomarkers < 0 || restored.num_subjects < 0 ||
+            restored.titres.size() != static_cast<size_t>(restored.num_biomarkers) * restored.num_subjects ||
+            restored.infected.size() != static_cast<size_t>(restored.num_subjects) ||
+            (n_fits != 0 && n_fits != restored.num_biomarkers) ||
+            restored.priors.size() != static_cast<size_t>(n_fits)) {
+            return false;
+        }
+        restored.fits.resize(n_fits);
+        for (auto& f : restored.fits) {
+            if (!f.load(in, encoding)) return false;
+        }
+        restored.control.load(in);
+        if (!in.good() || in.remaining() != 0) return false;
+        restored.control.progress = std::move(control.progress);
+        restored.checkpoint.swap(checkpoint);
+        *this = std::move(restored);
+        return true;
+    }
+    
+    bool deserialize() {
+        return deserialize(checkpoint.data(), checkpoint.size());
+    }
+    
+    void resize_checkpoint(int n) {
+        checkpoint.resize(std::max(0, n));
+    }
+    
+#ifdef __EMSCRIPTEN__
+    val get_checkpoint_view() const {
+        return val(typed_memory_view(checkpoint.size(), checkpoint.data()));
+    }
+#endif
+    
+    const std::vector<uint8_t>& get_checkpoint() const {
+        return checkpoint;
+    }
+    
+    // Warm start each prepared biomarker from the same biomarker of an
+    // earlier panel (see ParallelTemperingEnsemble::warm_start)
+    void warm_start(const BiomarkerPanelT& previous) {
+        const size_t n = std::min(fits.size(), previous.fits.size());
+        for (size_t b = 0; b < n; ++b) fits[b].warm_start(previous.fits[b]);
+    }
+    
+    void step_all(int n_steps) {
+        jobs.clear();
+        for (int b = 0; b < static_cast<int>(fits.size()); ++b) {
+            int n = fits[b].collect_jobs();
+            for (int j = 0; j < n; ++j) jobs.emplace_back(b, j);
+        }
+        parallel_for(static_cast<int>(jobs.size()), [&](int job) {
+            fits[jobs[job].first].step_job(jobs[job].second, n_steps);
+        });
+    }
+    
+    void swap_all() {
+        for (auto& f : fits) f.swap_all();
+    }
+    
+    // Converged once every biomarker meets the targets
+    bool check_convergence(int warmup) const {
+        for (const auto& f : fits) {
+            if (!f.targets_met(control, warmup)) return false;
+        }
+        return !fits.empty();
+    }
+    
+    int adaptation_end() const {
+        int end = 0;
+        for (const auto& f : fits) end = std::max(end, f.adaptation_end());
+        return end;
+    }
+    
+    int get_warmup() const { return diagnostic_warmup(control, adaptation_end()); }
+    
+    void reserve_until(int end) {
+        for (auto& f : fits) f.reserve_until(end);
+    }
+    
+    void run(int n_iterations) {
+        run_schedule(*this, control, n_iterations);
+    }
+    
+    int run_chunk(int k) {
+        return run_schedule(*this, control, k);
+    }
+    
+    int get_iteration() const { return control.iteration; }
+    bool is_converged() const { return control.converged; }
+    
+    void set_stopping_rule(double max_rhat, double min_ess, int check_every) {
+        control.max_rhat = max_rhat;
+        control.min_ess = min_ess;
+        control.check_every = std::max(SWAP_INTERVAL, check_every);
+        control.converged = false;
+    }
+    
+    void set_retention(const RetentionPolicy& policy) {
+        for (auto& f : fits) f.set_retention(policy);
+    }
+    
+    void set_ladder_policy(const LadderPolicy& policy) {
+        for (auto& f : fits) f.set_ladder_policy(policy);
+    }
+    
+    void set_cold_move(int move, int warmup) {
+        for (auto& f : fits) f.set_cold_move(move, warmup);
+    }
+    
+    void set_subsampling(int batch_size) {
+        for (auto& f : fits) f.set_subsampling(batch_size);
+    }
+    
+    // Per-biomarker results, as on ParallelTemperingEnsemble
+    int export_draws(int b, int warmup, int thin) {
+        PhaseTimer timer(control.times.output);
+        return fits[b].export_draws(warmup, thin);
+    }
+#ifdef __EMSCRIPTEN__
+    val get_draws_view(int b) const { return fits[b].get_draws_view(); }
+#endif
+    const FlatDraws& get_exported(int b) const { return fits[b].get_exported(); }
+    std::vector<double> compute_rhat(int b, int warmup) const { return fits[b].compute_rhat(warmup); }
+    std::vector<double> compute_ess_bulk(int b, int warmup) const { return fits[b].compute_ess_bulk(warmup); }
+    std::vector<double> compute_ess_tail(int b, int warmup) const { return fits[b].compute_ess_tail(warmup); }
+    std::vector<double> get_swap_rates(int b) const { return fits[b].get_swap_rates(); }
+    std::vector<int> get_num_chains(int b) const { return fits[b].get_num_chains(); }
+    std::vector<double> curve_bands(int b, const std::vector<double>& grid, int warmup, const std::vector<double>& probs) const {
+        return fits[b].curve_bands(grid, warmup, probs);
+    }
+    std::vector<double> summarize(int b, int warmup, const std::vector<double>& probs) const {
+        return fits[b].summarize(warmup, probs);
+    }
+    
+    void set_pointwise_loo(int start) {
+        for (auto& f : fits) f.set_pointwise_loo(start);
+    }
+    
+    LooSummary get_loo(int b) const {
+        return fits[b].get_loo();
+    }
+    
+    std::vector<double> calibration_bands(int b, int n_bins, int warmup, const std::vector<double>& probs) const {
+        return fits[b].calibration_bands(n_bins, warmup, probs);
+    }
+    
+    std::vector<double> roc_curve(int b) const { return fits[b].roc_curve(); }
+    double get_auc(int b) const { return fits[b].get_auc(); }
+    
+    // Totals over every biomarker; phase times of the shared schedule
+    SamplerStats get_stats() const {
+        SamplerStats stats;
+        stats.iterations = control.iteration;
+        for (const auto& f : fits) stats.merge_work(f.get_stats());
+        stats.add_times(control.times);
+        return stats;
+    }
+};
+
+typedef BiomarkerPanelT<Model4PL> BiomarkerPanel;
+
+// Reduced-model samplers
+typedef ParallelTemperingMCMCT<Model3PLZeroFloor> ParallelTemperingMCMC3PLZeroFloor;
+typedef ParallelTemperingMCMCT<Model3PLUnitCeiling> ParallelTemperingMCMC3PLUnitCeiling;
+typedef ParallelTemperingMCMCT<Model2PL> ParallelTemperingMCMC2PL;
+typedef ParallelTemperingEnsembleT<Model3PLZeroFloor> ParallelTemperingEnsemble3PLZeroFloor;
+typedef ParallelTemperingEnsembleT<Model3PLUnitCeiling> ParallelTemperingEnsemble3PLUnitCeiling;
+typedef ParallelTemperingEnsembleT<Model2PL> ParallelTemperingEnsemble2PL;
+typedef BiomarkerPanelT<Model3PLZeroFloor> BiomarkerPanel3PLZeroFloor;
+typedef BiomarkerPanelT<Model3PLUnitCeiling> BiomarkerPanel3PLUnitCeiling;
+typedef BiomarkerPanelT<Model2PL> BiomarkerPanel2PL;
+
+// Gamma(shape, 1) by Marsaglia & Tsang (2000); shapes below 1 use the
+// boost Gamma(shape + 1) * U^(1 / shape)
+inline double draw_gamma(RngStream& s, double shape) {
+    if (shape < 1.0) return draw_gamma(s, shape + 1.0) * std::pow(s.uniform_pos(), 1.0 / shape);
+    const double d = shape - 1.0 / 3.0;
+    const double c = 1.0 / std::sqrt(9.0 * d);
+    for (;;) {
+        double x = s.normal();
+        double v = 1.0 + c * x;
+        if (v <= 0.0) continue;
+        v = v * v * v;
+        if (std::log(s.uniform_pos()) < 0.5 * x * x + d - d * v + d * std::log(v)) return d * v;
+    }
+}
+
+inline double draw_beta(RngStream& s, double alpha, double beta) {
+    double x = draw_gamma(s, alpha);
+    return x / (x + draw_gamma(s, beta));
+}
+
+// One draw from the priors, with the model's fixed fields set. The slope's
+// truncated normal is sampled by rejection; a prior with almost no mass
+// above zero falls back to |draw| after 1000 tries.
+template <class Model>
+Params draw_from_prior(RngStream& s, const Priors& p) {
+    Params out;
+    out.floor = draw_beta(s, p.floor_alpha, p.floor_beta);
+    out.ceiling = draw_beta(s, p.ceiling_alpha, p.ceiling_beta);
+    out.ec50 = p.ec50_mean + p.ec50_sd * s.normal();
+    out.slope = -1.0;
+    for (int k = 0; k < 1000 && out.slope <= 0.0; ++k) out.slope = p.slope_mean + p.slope_sd * s.normal();
+    if (out.slope <= 0.0) out.slope = std::abs(out.slope) + DBL_MIN;
+    Model::fix(out);
+    return out;
+}
+
+// Design-level summary of one parameter across a simulation study's datasets
+struct StudyPower {
+    double precision;       // Fraction whose central interval has half-width <= the target
+    double coverage;        // Fraction whose central interval contains the true value
+    double mean_half_width;
+    double rmse;            // Posterior mean against the true value
+    int n_datasets;         // Datasets with retained draws
+    
+    StudyPower() : precision(NAN), coverage(NAN), mean_half_width(NAN), rmse(NAN), n_datasets(0) {}
+};
+
+// Simulation studies for power analysis and simulation-based calibration
+// (Talts et al. 2018). Each of n_datasets synthetic cohorts of n_subjects has
+// titres ~ Normal(titre_mean, titre_sd) and outcomes drawn from the curve
+// model at a true Params: one fixed truth for power analysis (simulate), or
+// a fresh prior draw per dataset for SBC (simulate_from_prior). Every
+// dataset gets its own ensemble, and all dataset x replica x rung chains
+// step together on the worker pool, as in BiomarkerPanel. Fits keep only a
+// ring buffer of recent cold-chain draws (see set_retention), and results
+// come back as per-dataset summaries, interval power and SBC ranks.
+template <class Model>
+class SimulationStudyT {
+private:
+    int num_datasets;
+    int num_subjects;
+    double titre_mean, titre_sd;
+    std::vector<Params> truths;
+    std::vector<ParallelTemperingEnsembleT<Model>> fits;
+    std::vector<std::pair<int, int>> jobs; // (dataset, ensemble job)
+    RetentionPolicy retention;
+    
+    // Synthetic data from truths, all drawn from one stream in dataset order
+    // so a study is a function of the seed only
+    void build(RngStream& stream, const Priors& priors, int n_replicas, int n_chains, int engine) {
+        std::vector<std::shared_ptr<const Data>> data;
+        data.reserve(num_datasets);
+        for (int d = 0; d < num_datasets; ++d) {
+            auto cohort = std::make_shared<Data>();
+            cohort->resize(num_subjects);
+            for (int i = 0; i < num_subjects; ++i) {
+                const double t = titre_mean + titre_sd * stream.normal();
+                cohort->titre[i] = t;
+                cohort->infected[i] = stream.uniform() < prob_infection(truths[d], t) ? 1 : 0;
+            }
+            cohort->finalize();
+            cohort->set_engine(engine);
+            data.push_back(std::move(cohort));
+        }
+        fits.clear();
+        fits.reserve(num_datasets);
+        for (int d = 0; d < num_datasets; ++d) {
+            fits.emplace_back(n_replicas, n_chains, data[d], priors);
+            fits.back().set_retention(retention);
+        }
+        control = RunControl();
+    }
+    
+public:
+    RunControl control;
+    
+    SimulationStudyT(int n_datasets, int n_subjects)
+        : num_datasets(std::max(0, n_datasets)), num_subjects(std::max(0, n_subjects)), titre_mean(0.0), titre_sd(1.0) {
+        retention.capacity = 1000;
+    }
+    
+    // Titre distribution of the synthetic cohorts; call before simulating
+    void set_titre_distribution(double mean, double sd) {
+        titre_mean = mean;
+        titre_sd = std::max(0.0, sd);
+    }
+    
+    // Every dataset from the same truth (power analysis). Returns the number of datasets.
+    int simulate(const Params& truth, const Priors& priors, int n_replicas, int n_chains, int engine) {
+        RngStream stream = root_split();
+        Params fixed = truth;
+        Model::fix(fixed);
+        truths.assign(num_datasets, fixed);
+        build(stream, priors, n_replicas, n_chains, engine);
+        return num_datasets;
+    }
+    
+    // Each dataset from its own prior draw (SBC)
+    int simulate_from_prior(const Priors& priors, int n_replicas, int n_chains, int engine) {
+        RngStream stream = root_split();
+        truths.clear();
+        for (int d = 0; d < num_datasets; ++d) truths.push_back(draw_from_prior<Model>(stream, priors));
+        build(stream, priors, n_replicas, n_chains, engine);
+        return num_datasets;
+    }
+    
+    int get_num_datasets() const { return num_datasets; }
+    int get_num_subjects() const { return num_subjects; }
+    std::vector<Params> get_truths() const { return truths; }
+    
+    void step_all(int n_steps) {
+        jobs.clear();
+        for (int d = 0; d < static_cast<int>(fits.size()); ++d) {
+            int n = fits[d].collect_jobs();
+            for (int j = 0; j < n; ++j) jobs.emplace_back(d, j);
+        }
+        parallel_for(static_cast<int>(jobs.size()), [&](int job) {
+            fits[jobs[job].first].step_job(jobs[job].second, n_steps);
+        });
+    }
+    
+    void swap_all() {
+        for (auto& f : fits) f.swap_all();
+    }
+    
+    // Converged once every dataset meets the targets
+    bool check_convergence(int warmup) const {
+        for (const auto& f : fits) {
+            if (!f.targets_met(control, warmup)) return false;
+        }
+        return !fits.empty();
+    }
+    
+    int adaptation_end() const {
+        int end = 0;
+        for (const auto& f : fits) end = std::max(end, f.adaptation_end());
+        return end;
+    }
+    
+    int get_warmup() const { return diagnostic_warmup(control, adaptation_end()); }
+    
+    void reserve_until(int end) {
+        for (auto& f : fits) f.reserve_until(end);
+    }
+    
+    void run(int n_iterations) {
+        run_schedule(*this, control, n_iterations);
+    }
+    
+    int run_chunk(int k) {
+        return run_schedule(*this, control, k);
+    }
+    
+    int get_iteration() const { return control.iteration; }
+    bool is_converged() const { return control.converged; }
+    
+    void set_stopping_rule(double max_rhat, double min_ess, int check_every) {
+        control.max_rhat = max_rhat;
+        control.min_ess = min_ess;
+        control.check_every = std::max(SWAP_INTERVAL, check_every);
+        control.converged = false;
+    }
+    
+    // Applies to the current fits and to later simulate() calls. The default
+    // keeps the latest 1000 cold-chain draws of each replica.
+    void set_retention(const RetentionPolicy& policy) {
+        retention = policy;
+        for (auto& f : fits) f.set_retention(policy);
+    }
+    
+    void set_ladder_policy(const LadderPolicy& policy) {
+        for (auto& f : fits) f.set_ladder_policy(policy);
+    }
+    
+    void set_cold_move(int move, int warmup) {
+        for (auto& f : fits) f.set_cold_move(move, warmup);
+    }
+    
+    // Per dataset, the ensemble's summary: [mean, sd, q_1..q_K] for each of
+    // floor, ceiling, ec50, slope, i.e. 4 * (2 + K) values per dataset
+    std::vector<double> summarize(int warmup, const std::vector<double>& probs) const {
+        const size_t stride = 4 * (2 + probs.size());
+        std::vector<double> out(fits.size() * stride, NAN);
+        parallel_for(static_cast<int>(fits.size()), [&](int d) {
+            std::vector<double> s = fits[d].summarize(warmup, probs);
+            std::copy(s.begin(), s.end(), out.begin() + d * stride);
+        });
+        return out;
+    }
+    
+    // Largest split R-hat over the free parameters of each dataset, to flag
+    // fits that the run length did not settle
+    std::vector<double> get_max_rhat(int warmup) const {
+        std::vector<double> out(fits.size(), NAN);
+        parallel_for(static_cast<int>(fits.size()), [&](int d) {
+            std::vector<double> rhat = Model::free_values(fits[d].compute_rhat(warmup));
+            if (!rhat.empty()) out[d] = *std::max_element(rhat.begin(), rhat.end());
+        });
+        return out;
+    }
+    
+    // Central `level` intervals of one parameter (0 floor .. 3 slope) against
+    // the truths: how often they are narrower than +-half_width and how often
+    // they cover. Run at several cohort sizes to find the one that is needed.
+    StudyPower power(int param, int warmup, double level, double half_width) const {
+        StudyPower out;
+        if (param < 0 || param > 3 || !Model::is_free(param) || fits.empty()) return out;
+        static double Params::* const fields[] = {&Params::floor, &Params::ceiling, &Params::ec50, &Params::slope};
+        const double lo_p = 0.5 * (1.0 - level), hi_p = 0.5 * (1.0 + level);
+        std::vector<double> row(4 * fits.size(), NAN); // mean, lo, hi, truth
+        parallel_for(static_cast<int>(fits.size()), [&](int d) {
+            std::vector<double> s = fits[d].summarize(warmup, {lo_p, hi_p});
+            row[4 * d] = s[4 * param];
+            row[4 * d + 1] = s[4 * param + 2];
+            row[4 * d + 2] = s[4 * param + 3];
+            row[4 * d + 3] = truths[d].*fields[param];
+        });
+        
+        int n = 0, precise = 0, covered = 0;
+        double width = 0.0, sq_error = 0.0;
+        for (size_t d = 0; d < fits.size(); ++d) {
+            const double* r = row.data() + 4 * d;
+            if (std::isnan(r[0])) continue;
+            const double hw = 0.5 * (r[2] - r[1]);
+            n++;
+            precise += hw <= half_width ? 1 : 0;
+            covered += (r[1] <= r[3] && r[3] <= r[2]) ? 1 : 0;
+            width += hw;
+            sq_error += (r[0] - r[3]) * (r[0] - r[3]);
+        }
+        if (n == 0) return out;
+        out.precision = static_cast<double>(precise) / n;
+        out.coverage = static_cast<double>(covered) / n;
+        out.mean_half_width = width / n;
+        out.rmse = std::sqrt(sq_error / n);
+        out.n_datasets = n;
+        return out;
+    }
+    
+    // SBC rank of each truth among n_draws post-warmup draws spaced evenly
+    // through the pooled cold chains: the number below the true value, in
+    // [0, n_draws]. A calibrated sampler gives uniform ranks. Four per
+    // dataset; -1 for fixed fields and for fits with fewer than n_draws draws.
+    // Keep n_draws below the fits' ESS so the draws are nearly independent.
+    std::vector<int> sbc_ranks(int warmup, int n_draws) const {
+        static double Params::* const fields[] = {&Params::floor, &Params::ceiling, &Params::ec50, &Params::slope};
+        const int l = std::max(1, n_draws);
+        std::vector<int> ranks(4 * fits.size(), -1);
+        parallel_for(static_cast<int>(fits.size()), [&](int d) {
+            FlatDraws draws = fits[d].pooled_draws(warmup, 1);
+            const size_t n = draws.n_draws;
+            if (n < static_cast<size_t>(l)) return;
+            for (int k = 0; k < 4; ++k) {
+                if (!Model::is_free(k)) continue;
+                const double* col = draws.values.data() + k * n;
+                const double truth = truths[d].*fields[k];
+                int rank = 0;
+                for (int i = 0; i < l; ++i) rank += col[static_cast<size_t>(i) * n / l] < truth ? 1 : 0;
+                ranks[4 * d + k] = rank;
+            }
+        });
+        return ranks;
+    }
+    
+    // Rank histograms, [floor | ceiling | ec50 | slope] with n_bins counts each
+    std::vector<int> sbc_histogram(int warmup, int n_draws, int n_bins) const {
+        const int l = std::max(1, n_draws);
+        n_bins = std::max(1, std::min(n_bins, l + 1));
+        std::vector<int> counts(4 * n_bins, 0);
+        std::vector<int> ranks = sbc_ranks(warmup, l);
+        for (size_t i = 0; i < ranks.size(); ++i) {
+            if (ranks[i] < 0) continue;
+            counts[(i % 4) * n_bins + static_cast<int>(static_cast<long long>(ranks[i]) * n_bins / (l + 1))]++;
+        }
+        return counts;
+    }
+    
+    // Totals over every dataset; phase times of the shared schedule
+    SamplerStats get_stats() const {
+        SamplerStats stats;
+        stats.iterations = control.iteration;
+        for (const auto& f : fits) stats.merge_work(f.get_stats());
+        stats.add_times(control.times);
+        return stats;
+    }
+};
+
+typedef SimulationStudyT<Model4PL> SimulationStudy;
+typedef SimulationStudyT<Model3PLZeroFloor> SimulationStudy3PLZeroFloor;
+typedef SimulationStudyT<Model3PLUnitCeiling> SimulationStudy3PLUnitCeiling;
+typedef SimulationStudyT<Model2PL> SimulationStudy2PL;
+
+// Outcomes stratified by group. Rows are sorted by group (stably, so input
+// order is kept within a group) and group g owns the contiguous block
+// [offsets[g], offsets[g + 1]). Each block is also its own Data, compressed
+// and laid out for the chosen engine, so a group's likelihood only touches
+// its own slice.
+struct GroupedData {
+    std::vector<double> titre;  // Sorted by group
+    std::vector<int> infected;
+    std::vector<int> labels;    // Input group id of block g, ascending
+    std::vector<int> offsets;   // num_groups + 1 row offsets
+    std::vector<Data> blocks;
+    int N;
+    
+    GroupedData() : N(0) {}
+    GroupedData(const std::vector<double>& t, const std::vector<int>& i, const std::vector<int>& g) : N(0) {
+        assign(t.data(), i.data(), g.data(), static_cast<int>(std::min({t.size(), i.size(), g.size()})));
+    }
+    
+    // Bulk ingest; group ids are arbitrary integers (one block per distinct
+    // id). Returns the number of outcomes that are not 0/1.
+    int assign(const double* t, const int* inf, const int* group, int n) {
+        N = std::max(0, n);
+        std::vector<int> order(N);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [group](int a, int b) { return group[a] < group[b]; });
+        
+        titre.resize(N);
+        infected.resize(N);
+        labels.clear();
+        offsets.clear();
+        for (int r = 0; r < N; ++r) {
+            const int i = order[r];
+            titre[r] = t[i];
+            infected[r] = inf[i];
+            if (labels.empty() || group[i] != labels.back()) {
+                labels.push_back(group[i]);
+                offsets.push_back(r);
+            }
+        }
+        offsets.push_back(N);
+        
+        int invalid = 0;
+        blocks.assign(labels.size(), Data());
+        for (size_t g = 0; g < blocks.size(); ++g) {
+            const int begin = offsets[g];
+            blocks[g].assign(titre.data() + begin, infected.data() + begin, offsets[g + 1] - begin);
+        }
+        for (int y : infected) invalid += (y != 0 && y != 1) ? 1 : 0;
+        return invalid;
+    }
+    
+    // Bulk ingest of biomarker b from a finished CsvParser with a group column;
+    // the parser's group ids number its labels in order of first appearance
+    bool assign_csv(const CsvParser& csv, int b) {
+        if (csv.get_error() != CSV_OK || !csv.has_groups() || b < 0 || b >= csv.get_num_biomarkers() ||
+            static_cast<int>(csv.get_column(b).size()) != csv.get_num_rows()) return false;
+        assign(csv.get_column(b).data(), csv.get_infected().data(), csv.get_groups().data(), csv.get_num_rows());
+        return true;
+    }
+    
+    int get_num_groups() const { return static_cast<int>(blocks.size()); }
+    std::vector<int> get_labels() const { return labels; }
+    std::vector<int> get_offsets() const { return offsets; }
+    
+    void compress() {
+        for (auto& b : blocks) b.compress();
+    }
+    
+    void set_engine(int e) {
+        for (auto& b : blocks) b.set_engine(e);
+    }
+};
+
+// Priors of the hierarchical group model. Group curves scatter around a
+// population curve in unconstrained coordinates,
+//   z_g ~ Normal(z(population), diag(tau^2)),  z = (logit floor, logit ceiling, ec50, log slope),
+// the population curve has the single-fit priors, and each between-group
+// sd tau_k has a half-normal(0, scale) prior.
+struct GroupPriors {
+    Priors population;
+    double tau_floor, tau_ceiling, tau_ec50, tau_slope; // Half-normal scales
+    
+    GroupPriors() : tau_floor(1.0), tau_ceiling(1.0), tau_ec50(1.0), tau_slope(0.5) {}
+};
+
+// One rung of the hierarchical model: Metropolis-within-Gibbs over each
+// group's curve (adaptive random walk; only that group's block is
+// re-evaluated), then the population curve and the log tau_k, whose
+// conditionals cost O(groups) and no likelihood. Only the likelihood is
+// tempered. Draws are stored per block: groups 0..G-1, the population curve
+// (G) and tau (G + 1, as Params fields in z order).
+class HierarchicalChain {
+private:
+    static constexpr int TAU_ADAPT_EVERY = 50;
+    
+    std::vector<Params> groups;
+    std::vector<std::array<double, 4>> group_z; // Unconstrained group curves
+    std::vector<double> group_ll;               // Untempered, per block
+    std::vector<ProposalDistribution<Model4PL>> group_proposals;
+    Params population;
+    double population_lp; // Prior plus log-Jacobian of the population curve in z
+    ProposalDistribution<Model4PL> population_proposal;
+    double tau[4];
+    double tau_log_step[4];
+    int tau_accepted[4];
+    int tau_total;
+    int tau_rounds;
+    double temperature;
+    RngStream chain_rng;
+    int accepted;
+    int total;
+    
+    double evaluate_likelihood(const Params& p, const Data& block) {
+        counters.likelihood();
+        return temperature > 1.0 ? log_likelihood_heated(p, block) : log_likelihood(p, block);
+    }
+    
+    // log Normal(z | mu, tau) up to a constant, with mu = z(population)
+    double group_density(const double z[4], const double mu[4]) const {
+        double lp = 0.0;
+        for (int k = 0; k < 4; ++k) {
+            double u = (z[k] - mu[k]) / tau[k];
+            lp -= 0.5 * u * u;
+        }
+        return lp;
+    }
+    
+    double pooled_density(const double mu[4]) const {
+        double lp = 0.0;
+        for (const auto& z : group_z) lp += group_density(z.data(), mu);
+        return lp;
+    }
+    
+    bool update_group(int g, const GroupedData& data) {
+        Params proposed = group_proposals[g].propose(groups[g], chain_rng);
+        counters.proposal();
+        double mu[4], zp[4];
+        Model4PL::to_unconstrained(population, mu);
+        Model4PL::to_unconstrained(proposed, zp);
+        double ll = evaluate_likelihood(proposed, data.blocks[g]);
+        double log_alpha = std::isfinite(ll)
+            ? (ll - group_ll[g]) / temperature + group_density(zp, mu) - group_density(group_z[g].data(), mu)
+            : -INFINITY;
+        bool accept = std::log(chain_rng.uniform_pos()) < log_alpha;
+        if (accept) {
+            groups[g] = proposed;
+            std::copy(zp, zp + 4, group_z[g].begin());
+            group_ll[g] = ll;
+        }
+        group_proposals[g].update(groups[g], accept);
+        return accept;
+    }
+    
+    void update_population(const Priors& priors) {
+        Params proposed = population_proposal.propose(population, chain_rng);
+        counters.proposal();
+        double lp = log_prior(proposed, priors);
+        bool accept = false;
+        if (std::isfinite(lp)) {
+            lp += Model4PL::log_jacobian(proposed);
+            double mu[4], mu_p[4];
+            Model4PL::to_unconstrained(population, mu);
+            Model4PL::to_unconstrained(proposed, mu_p);
+            double log_alpha = lp + pooled_density(mu_p) - population_lp - pooled_density(mu);
+            accept = std::log(chain_rng.uniform_pos()) < log_alpha;
+        } else {
+            counters.prior_rejection();
+        }
+        if (accept) {
+            population = proposed;
+            population_lp = lp;
+        }
+        population_proposal.update(population, accept);
+    }
+    
+    // Random walk on log tau_k; the step adapts towards 44% acceptance
+    void update_tau(const GroupPriors& priors) {
+        const double scale[4] = {priors.tau_floor, priors.tau_ceiling, priors.tau_ec50, priors.tau_slope};
+        const double n = static_cast<double>(group_z.size());
+        double mu[4];
+        Model4PL::to_unconstrained(population, mu);
+        for (int k = 0; k < 4; ++k) {
+            double ss = 0.0;
+            for (const auto& z : group_z) ss += (z[k] - mu[k]) * (z[k] - mu[k]);
+            // Density of log tau: half-normal prior, Jacobian tau, and the groups
+            auto log_target = [&](double t) {
+                return -0.5 * (t / scale[k]) * (t / scale[k]) + (1.0 - n) * std::log(t) - 0.5 * ss / (t * t);
+            };
+            double proposed = tau[k] * std::exp(std::exp(tau_log_step[k]) * chain_rng.normal());
+            if (std::log(chain_rng.uniform_pos()) < log_target(proposed) - log_target(tau[k])) {
+                tau[k] = proposed;
+                tau_accepted[k]++;
+            }
+        }
+        if (++tau_total == TAU_ADAPT_EVERY) {
+            tau_rounds++;
+            for (int k = 0; k < 4; ++k) {
+                double rate = static_cast<double>(tau_accepted[k]) / tau_total;
+                tau_log_step[k] += (rate - 0.44) / std::sqrt(static_cast<double>(tau_rounds));
+                tau_log_step[k] = std::max(-10.0, std::min(tau_log_step[k], 3.0));
+                tau_accepted[k] = 0;
+            }
+            tau_total = 0;
+        }
+    }
+    
+    void record() {
+        const int n_groups = static_cast<int>(groups.size());
+        const Params tau_params(tau[0], tau[1], tau[2], tau[3]);
+        for (int b = 0; b <= n_groups + 1; ++b) {
+            const Params& p = b < n_groups ? groups[b] : b == n_groups ? population : tau_params;
+            samples[b].record(total - 1, p);
+            traces[b][0].push(p.floor);
+            traces[b][1].push(p.ceiling);
+            traces[b][2].push(p.ec50);
+            traces[b][3].push(p.slope);
+        }
+    }
+    
+public:
+    std::vector<DrawStore> samples;               // Per block (see above)
+    std::vector<std::array<OnlineTrace, 4>> traces;
+    HotCounters counters;
+    
+    HierarchicalChain(double temp, const Params& init, const GroupedData& data, const GroupPriors& priors,
+                      const RngStream& stream)
+        : groups(data.get_num_groups(), init), group_z(data.get_num_groups()), group_ll(data.get_num_groups()),
+          group_proposals(data.get_num_groups()), population(init), tau_total(0), tau_rounds(0),
+          temperature(temp), chain_rng(stream), accepted(0), total(0),
+          samples(data.get_num_groups() + 2), traces(data.get_num_groups() + 2) {
+        const double scale[4] = {priors.tau_floor, priors.tau_ceiling, priors.tau_ec50, priors.tau_slope};
+        for (int k = 0; k < 4; ++k) {
+            tau[k] = scale[k];
+            tau_log_step[k] = std::log(0.5);
+            tau_accepted[k] = 0;
+        }
+        population_lp = log_prior(population, priors.population) + Model4PL::log_jacobian(population);
+        for (int g = 0; g < data.get_num_groups(); ++g) {
+            Model4PL::to_unconstrained(init, group_z[g].data());
+            group_ll[g] = evaluate_likelihood(init, data.blocks[g]);
+        }
+    }
+    
+    // One sweep: every group, then the population curve, then tau
+    void step(const GroupedData& data, const GroupPriors& priors) {
+        const int n_groups = static_cast<int>(groups.size());
+        for (int g = 0; g < n_groups; ++g) {
+            if (update_group(g, data)) accepted++;
+        }
+        update_population(priors.population);
+        update_tau(priors);
+        total++;
+        record();
+    }
+    
+    double get_log_likelihood() const {
+        double ll = 0.0;
+        for (double v : group_ll) ll += v;
+        return ll;
+    }
+    
+    double get_temperature() const { return temperature; }
+    int get_iterations() const { return total; }
+    
+    void set_temperature(double temp) { temperature = temp; }
+    
+    // Exchange states with another rung; proposals stay with their rung
+    void swap_state(HierarchicalChain& other) {
+        std::swap(groups, other.groups);
+        std::swap(group_z, other.group_z);
+        std::swap(group_ll, other.group_ll);
+        std::swap(population, other.population);
+        std::swap(population_lp, other.population_lp);
+        std::swap(tau, other.tau);
+    }
+    
+    // Every block's likelihood under another rung's group curves, at this
+    // rung's precision
+    std::vector<double> score_likelihood(const HierarchicalChain& other, const GroupedData& data) {
+        std::vector<double> ll(groups.size());
+        for (size_t g = 0; g < groups.size(); ++g) ll[g] = evaluate_likelihood(other.groups[g], data.blocks[g]);
+        return ll;
+    }
+    
+    // swap_state, taking the incoming states' block likelihoods as already
+    // scored at each chain's own precision (see score_likelihood)
+    void swap_state(HierarchicalChain& other, std::vector<double> ll, std::vector<double> other_ll) {
+        swap_state(other);
+        group_ll = std::move(ll);
+        other.group_ll = std::move(other_ll);
+    }
+    
+    // Acceptance rate of the group updates
+    double get_acceptance_rate() const {
+        return total > 0 ? static_cast<double>(accepted) / (static_cast<double>(total) * groups.size()) : 0.0;
+    }
+};
+
+// Hierarchical 4PL over all groups in one tempered run: partial pooling
+// towards the population curve, at roughly the cost of a single fit (one
+// pass over the rows per sweep). Results are read per block: group
+// 0..G-1 in label order, G the population curve, G + 1 the between-group
+// sds tau (floor, ceiling, ec50, slope columns on the z scale).
+class ParallelTemperingHierarchical {
+private:
+    std::vector<HierarchicalChain> chains;
+    std::vector<double> temperatures;
+    std::shared_ptr<const GroupedData> data;
+    GroupPriors priors;
+    int num_chains;
+    double max_temperature;
+    int swap_accepted;
+    int swap_total;
+    int swap_round;
+    RngStream stream;
+    FlatDraws exported;
+    
+    void set_geometric_ladder() {
+        temperatures.resize(num_chains);
+        for (int i = 0; i < num_chains; ++i) {
+            temperatures[i] = num_chains > 1 ? std::pow(max_temperature, static_cast<double>(i) / (num_chains - 1)) : 1.0;
+        }
+        for (size_t i = 0; i < chains.size(); ++i) chains[i].set_temperature(temperatures[i]);
+    }
+    
+    bool valid_block(int block) const {
+        return !chains.empty() && block >= 0 && static_cast<size_t>(block) < chains[0].samples.size();
+    }
+    
+    // Empty for an out-of-range block, so the summaries come back NaN
+    FlatDraws cold_draws(int block, int warmup, int thin) const {
+        FlatDraws draws;
+        if (valid_block(block)) draws.fill({&chains[0].samples[block]}, warmup, thin);
+        return draws;
+    }
+    
+public:
+    RunControl control;
+    
+    ParallelTemperingHierarchical(int n_chains, const GroupedData& d, const GroupPriors& p)
+        : data(std::make_shared<const GroupedData>(d)), priors(p), num_chains(std::max(1, n_chains)),
+          max_temperature(10.0), swap_accepted(0), swap_total(0), swap_round(0) {
+        set_geometric_ladder();
+        stream = root_split();
+        for (int i = 0; i < num_chains; ++i) {
+            double u[4];
+            for (double& v : u) v = stream.uniform();
+            Params init(0.01 + 0.49 * u[0], 0.1 + 0.8 * u[1], -2.0 + 4.0 * u[2], 0.1 + 2.9 * u[3]);
+            chains.emplace_back(temperatures[i], init, *data, priors, root_split());
+        }
+        set_retention(RetentionPolicy());
+    }
+    
+    int get_num_chains() const { return num_chains; }
+    int get_num_groups() const { return data->get_num_groups(); }
+    std::vector<int> get_group_labels() const { return data->get_labels(); }
+    
+    // Hottest rung of the geometric ladder; call before running
+    void set_max_temperature(double t) {
+        max_temperature = std::max(1.0, t);
+        if (swap_round == 0) set_geometric_ladder();
+    }
+    
+    std::vector<double> get_temperatures() const { return temperatures; }
+    
+    void step_all(int n_steps) {
+        parallel_for(num_chains, [&](int c) {
+            for (int k = 0; k < n_steps; ++k) chains[c].step(*data, priors);
+        });
+    }
+    
+    // Even/odd swap round over adjacent rungs, as in ParallelTemperingMCMC
+    void swap_all() {
+        for (int i = swap_round % 2; i + 1 < num_chains; i += 2) {
+            int j = i + 1;
+            // ENGINE_MIXED: score both states at both precisions for an exact test
+            const bool rescore = i == 0 && !data->blocks.empty() && data->blocks[0].engine == ENGINE_MIXED;
+            std::vector<double> ll_cold, ll_heated;
+            double log_alpha;
+            if (rescore) {
+                ll_cold = chains[0].score_likelihood(chains[j], *data);
+                ll_heated = chains[j].score_likelihood(chains[0], *data);
+                double sum_cold = 0.0, sum_heated = 0.0;
+                for (double v : ll_cold) sum_cold += v;
+                for (double v : ll_heated) sum_heated += v;
+                log_alpha = (sum_cold - chains[0].get_log_likelihood()) / temperatures[0] +
+                            (sum_heated - chains[j].get_log_likelihood()) / temperatures[j];
+            } else {
+                log_alpha = (chains[i].get_log_likelihood() - chains[j].get_log_likelihood()) *
+                            (1.0 / temperatures[j] - 1.0 / temperatures[i]);
+            }
+            swap_total++;
+            if (std::log(stream.uniform_pos()) < log_alpha) {
+                if (rescore) {
+                    chains[0].swap_state(chains[j], std::move(ll_cold), std::move(ll_heated));
+                } else {
+                    chains[i].swap_state(chains[j]);
+                }
+                swap_accepted++;
+            }
+        }
+        swap_round++;
+    }
+    
+    // The geometric ladder is fixed and the random walks adapt throughout
+    int adaptation_end() const { return 0; }
+    
+    // Stopping rule over every block's streaming R-hat and ESS
+    bool check_convergence(int warmup) const {
+        if (chains[0].traces[0][0].num_batches(warmup) < 4) return false;
+        for (int b = 0; b < get_num_groups() + 2; ++b) {
+            if (!control.targets_met(compute_rhat(b, warmup), compute_ess(b, warmup))) return false;
+        }
+        return true;
+    }
+    
+    void reserve_until(int end) {
+        for (auto& chain : chains) {
+            for (auto& s : chain.samples) s.reserve_until(end);
+        }
+    }
+    
+    void run(int n_iterations) {
+        run_schedule(*this, control, n_iterations);
+    }
+    
+    int run_chunk(int k) {
+        return run_schedule(*this, control, k);
+    }
+    
+    int get_iteration() const { return control.iteration; }
+    bool is_converged() const { return control.converged; }
+    
+    void set_stopping_rule(double max_rhat, double min_ess, int check_every) {
+        control.max_rhat = max_rhat;
+        control.min_ess = min_ess;
+        control.check_every = std::max(SWAP_INTERVAL, check_every);
+        control.converged = false;
+    }
+    
+    // As ParallelTemperingMCMC::set_retention, applied to every block
+    void set_retention(const RetentionPolicy& policy) {
+        for (int c = 0; c < num_chains; ++c) {
+            bool store = policy.store_rungs <= 0 || c < policy.store_rungs;
+            for (auto& s : chains[c].samples) s.configure(store, policy);
+        }
+    }
+    
+    // Post-warmup, thinned cold-chain draws of one block (layout as in
+    // FlatDraws); none for an out-of-range block
+    int export_draws(int block, int warmup, int thin) {
+        PhaseTimer timer(control.times.output);
+        if (valid_block(block)) {
+            exported.fill({&chains[0].samples[block]}, warmup, thin);
+        } else {
+            exported = FlatDraws();
+        }
+        return exported.n_draws;
+    }
+    
+#ifdef __EMSCRIPTEN__
+    val get_draws_view() const {
+        return exported.view();
+    }
+#endif
+    
+    const FlatDraws& get_exported() const {
+        return exported;
+    }
+    
+    // Curve bands of a group (or of the population curve, block G)
+    std::vector<double> curve_bands(int block, const std::vector<double>& grid, int warmup, const std::vector<double>& probs) const {
+        return ::curve_bands(cold_draws(block, warmup, 1), grid, probs);
+    }
+    
+    std::vector<double> summarize(int block, int warmup, const std::vector<double>& probs) const {
+        FlatDraws draws = cold_draws(block, warmup, 1);
+        return summarize_draws(draws, probs);
+    }
+    
+    // Split R-hat and batch-means ESS of one block's cold-chain trace; NaN
+    // for an out-of-range block
+    std::vector<double> compute_rhat(int block, int warmup) const {
+        if (!valid_block(block)) return std::vector<double>(4, NAN);
+        std::vector<double> rhat;
+        for (const auto& trace : chains[0].traces[block]) {
+            if (trace.num_batches(warmup) < 4) return {1.0, 1.0, 1.0, 1.0};
+            std::vector<Moments> halves(2);
+            trace.split_halves(warmup, halves[0], halves[1]);
+            rhat.push_back(rhat_from_moments(halves));
+        }
+        return rhat;
+    }
+    
+    std::vector<double> compute_ess(int block, int warmup) const {
+        if (!valid_block(block)) return std::vector<double>(4, NAN);
+        std::vector<double> ess;
+        for (const auto& trace : chains[0].traces[block]) ess.push_back(trace.ess(warmup));
+        return ess;
+    }
+    
+    double get_swap_rate() const {
+        return swap_total > 0 ? static_cast<double>(swap_accepted) / swap_total : 0.0;
+    }
+    
+    std::vector<double> get_acceptance_rates() const {
+        std::vector<double> rates;
+        for (const auto& chain : chains) rates.push_back(chain.get_acceptance_rate());
+        return rates;
+    }
+    
+    SamplerStats get_stats() const {
+        SamplerStats stats;
+        stats.iterations = control.iteration;
+        for (const auto& chain : chains) stats.add_counters(chain.counters);
+        stats.swap_attempts = swap_total;
+        stats.swap_accepts = swap_accepted;
+        stats.add_times(control.times);
+        return stats;
+    }
+};
+
+#endif // PARALLEL_TEMPERING_MCMC_H
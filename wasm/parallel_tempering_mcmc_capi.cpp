@@ -0,0 +1,538 @@
+/*
+ * C ABI over the parallel tempering sampler (parallel_tempering_mcmc.h).
+ * Built as a native shared library by `make capi`; see
+ * parallel_tempering_mcmc_capi.h for the interface contract.
+ */
+
+#include "parallel_tempering_mcmc_capi.h"
+#include "parallel_tempering_mcmc.h"
+
+#include <new>
+
+struct ptm_ensemble {
+    ParallelTemperingEnsemble sampler;
+
+    ptm_ensemble(int n_replicas, int n_rungs, const Data& d, const Priors& p)
+        : sampler(n_replicas, n_rungs, d, p) {}
+    ptm_ensemble() {}
+};
+
+struct ptm_panel {
+    BiomarkerPanel sampler;
+
+    ptm_panel(int n_biomarkers, int n_subjects) : sampler(n_biomarkers, n_subjects) {}
+};
+
+struct ptm_study {
+    SimulationStudy sampler;
+
+    ptm_study(int n_datasets, int n_subjects) : sampler(n_datasets, n_subjects) {}
+};
+
+namespace {
+
+Priors to_priors(const ptm_priors& in) {
+    Priors p;
+    p.floor_alpha = in.floor_alpha;
+    p.floor_beta = in.floor_beta;
+    p.ceiling_alpha = in.ceiling_alpha;
+    p.ceiling_beta = in.ceiling_beta;
+    p.ec50_mean = in.ec50_mean;
+    p.ec50_sd = in.ec50_sd;
+    p.slope_mean = in.slope_mean;
+    p.slope_sd = in.slope_sd;
+    return p;
+}
+
+void from_priors(const Priors& p, ptm_priors* out) {
+    out->floor_alpha = p.floor_alpha;
+    out->floor_beta = p.floor_beta;
+    out->ceiling_alpha = p.ceiling_alpha;
+    out->ceiling_beta = p.ceiling_beta;
+    out->ec50_mean = p.ec50_mean;
+    out->ec50_sd = p.ec50_sd;
+    out->slope_mean = p.slope_mean;
+    out->slope_sd = p.slope_sd;
+}
+
+LadderPolicy to_ladder(const ptm_ladder& in) {
+    LadderPolicy policy;
+    policy.adapt_until = in.adapt_until;
+    policy.max_temperature = in.max_temperature;
+    policy.target_swap_rate = in.target_swap_rate;
+    policy.min_rungs = in.min_rungs;
+    policy.trim = in.trim != 0;
+    return policy;
+}
+
+void from_loo(const LooSummary& s, ptm_loo* out) {
+    out->elpd_loo = s.elpd_loo;
+    out->se_elpd_loo = s.se_elpd_loo;
+    out->p_loo = s.p_loo;
+    out->looic = s.looic;
+    out->elpd_waic = s.elpd_waic;
+    out->se_elpd_waic = s.se_elpd_waic;
+    out->p_waic = s.p_waic;
+    out->waic = s.waic;
+    out->max_pareto_k = s.max_pareto_k;
+    out->n_high_k = s.n_high_k;
+    out->n_draws = s.n_draws;
+}
+
+struct Diagnosed {
+    std::vector<double> rhat, ess_bulk, ess_tail;
+};
+
+void fill_diagnostics(const Diagnosed& d, const std::vector<double>& rates, ptm_diagnostics* out) {
+    for (int k = 0; k < 4; ++k) {
+        out->rhat[k] = d.rhat[k];
+        out->ess_bulk[k] = d.ess_bulk[k];
+        out->ess_tail[k] = d.ess_tail[k];
+    }
+    double sum = 0.0;
+    for (double r : rates) sum += r;
+    out->swap_rate = rates.empty() ? 0.0 : sum / rates.size();
+}
+
+int copy_draws(const FlatDraws& draws, double* out, int capacity) {
+    const int n = draws.n_draws;
+    if (!out) return n;
+    if (static_cast<size_t>(capacity) < draws.values.size()) return PTM_ERR_CAPACITY;
+    std::copy(draws.values.begin(), draws.values.end(), out);
+    return n;
+}
+
+int copy_checkpoint(const std::vector<uint8_t>& bytes, uint8_t* out, int capacity) {
+    if (bytes.size() > static_cast<size_t>(INT32_MAX)) return PTM_ERR_CAPACITY;
+    const int n = static_cast<int>(bytes.size());
+    if (!out) return n;
+    if (capacity < n) return PTM_ERR_CAPACITY;
+    std::copy(bytes.begin(), bytes.end(), out);
+    return n;
+}
+
+int copy_out(const std::vector<double>& values, double* out) {
+    std::copy(values.begin(), values.end(), out);
+    return PTM_OK;
+}
+
+// Every entry point funnels through here so no C++ exception (in practice
+// std::bad_alloc from a large run) crosses the C boundary
+template <typename Fn>
+int guarded(Fn fn) {
+    try {
+        return fn();
+    } catch (const std::bad_alloc&) {
+        return PTM_ERR_ALLOC;
+    } catch (...) {
+        return PTM_ERR_ARGUMENT;
+    }
+}
+
+bool valid_biomarker(const ptm_panel* p, int b) {
+    return p && b >= 0 && b < p->sampler.get_num_biomarkers();
+}
+
+} // namespace
+
+extern "C" {
+
+int ptm_abi_version(void) { return PTM_ABI_VERSION; }
+void ptm_set_num_threads(int n) { set_num_threads(n); }
+int ptm_get_num_threads(void) { return get_num_threads(); }
+int ptm_simd_enabled(void) { return simd_enabled() ? 1 : 0; }
+
+// The app's defaults; ec50 is left for the caller to centre on its data
+void ptm_default_priors(ptm_priors* out) {
+    if (!out) return;
+    out->floor_alpha = 1.0;
+    out->floor_beta = 9.0;
+    out->ceiling_alpha = 9.0;
+    out->ceiling_beta = 1.0;
+    out->ec50_mean = 0.0;
+    out->ec50_sd = 2.0;
+    out->slope_mean = 0.0;
+    out->slope_sd = 2.0;
+}
+
+// --- Single biomarker ---
+
+ptm_ensemble* ptm_ensemble_create(const double* titre, const int* infected, int n,
+                                  int n_replicas, int n_rungs, const ptm_priors* priors,
+                                  int engine, int compress, uint32_t seed) {
+    if (!titre || !infected || !priors || n <= 0 || n_replicas < 1 || n_rungs < 1) return nullptr;
+    try {
+        SeedScope scope(seed);
+        Data data;
+        data.assign(titre, infected, n);
+        if (compress) data.compress();
+        data.set_engine(engine);
+        return new ptm_ensemble(n_replicas, n_rungs, data, to_priors(*priors));
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void ptm_ensemble_free(ptm_ensemble* e) { delete e; }
+
+int ptm_ensemble_set_ladder(ptm_ensemble* e, const ptm_ladder* ladder) {
+    if (!e || !ladder) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        e->sampler.set_ladder_policy(to_ladder(*ladder));
+        return PTM_OK;
+    });
+}
+
+int ptm_ensemble_set_cold_move(ptm_ensemble* e, int move, int warmup) {
+    if (!e) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        e->sampler.set_cold_move(move, warmup);
+        return PTM_OK;
+    });
+}
+
+int ptm_ensemble_set_stopping_rule(ptm_ensemble* e, double max_rhat, double min_ess, int check_every) {
+    if (!e) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        e->sampler.set_stopping_rule(max_rhat, min_ess, check_every);
+        return PTM_OK;
+    });
+}
+
+int ptm_ensemble_set_pointwise_loo(ptm_ensemble* e, int start) {
+    if (!e) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        e->sampler.set_pointwise_loo(start);
+        return PTM_OK;
+    });
+}
+
+int ptm_ensemble_set_subsampling(ptm_ensemble* e, int batch_size) {
+    if (!e) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        e->sampler.set_subsampling(batch_size);
+        return PTM_OK;
+    });
+}
+
+int ptm_ensemble_run(ptm_ensemble* e, int n_iterations) {
+    if (!e || n_iterations < 0) return PTM_ERR_ARGUMENT;
+    return guarded([&] { return e->sampler.run_chunk(n_iterations); });
+}
+
+int ptm_ensemble_iteration(const ptm_ensemble* e) {
+    return e ? e->sampler.get_iteration() : PTM_ERR_ARGUMENT;
+}
+
+int ptm_ensemble_converged(const ptm_ensemble* e) {
+    return e ? (e->sampler.is_converged() ? 1 : 0) : PTM_ERR_ARGUMENT;
+}
+
+int ptm_ensemble_export_draws(ptm_ensemble* e, int warmup, int thin, double* out, int capacity) {
+    if (!e) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        e->sampler.export_draws(warmup, thin);
+        return copy_draws(e->sampler.get_exported(), out, capacity);
+    });
+}
+
+int ptm_ensemble_diagnostics(const ptm_ensemble* e, int warmup, ptm_diagnostics* out) {
+    if (!e || !out) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        Diagnosed d{e->sampler.compute_rhat(warmup), e->sampler.compute_ess_bulk(warmup),
+                    e->sampler.compute_ess_tail(warmup)};
+        fill_diagnostics(d, e->sampler.get_swap_rates(), out);
+        return PTM_OK;
+    });
+}
+
+int ptm_ensemble_loo(const ptm_ensemble* e, ptm_loo* out) {
+    if (!e || !out) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        from_loo(e->sampler.get_loo(), out);
+        return PTM_OK;
+    });
+}
+
+int ptm_ensemble_summarize(const ptm_ensemble* e, int warmup, const double* probs, int n_probs, double* out) {
+    if (!e || !out || n_probs < 0 || (n_probs > 0 && !probs)) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        return copy_out(e->sampler.summarize(warmup, std::vector<double>(probs, probs + n_probs)), out);
+    });
+}
+
+int ptm_ensemble_curve_bands(const ptm_ensemble* e, const double* grid, int n_grid, int warmup,
+                             const double* probs, int n_probs, double* out) {
+    if (!e || !grid || !out || n_grid <= 0 || n_probs < 0 || (n_probs > 0 && !probs)) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        return copy_out(e->sampler.curve_bands(std::vector<double>(grid, grid + n_grid), warmup,
+                                               std::vector<double>(probs, probs + n_probs)), out);
+    });
+}
+
+int ptm_ensemble_warm_start(ptm_ensemble* e, const ptm_ensemble* previous) {
+    if (!e || !previous || e == previous) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        e->sampler.warm_start(previous->sampler);
+        return PTM_OK;
+    });
+}
+
+int ptm_ensemble_reweight_priors(ptm_ensemble* e, const ptm_priors* priors, int warmup,
+                                 ptm_prior_sensitivity* out) {
+    if (!e || !priors || !out) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        PriorSensitivity r = e->sampler.reweight_priors(to_priors(*priors), warmup);
+        out->pareto_k = r.pareto_k;
+        out->k_threshold = r.k_threshold;
+        out->ess = r.ess;
+        out->n_draws = r.n_draws;
+        out->stable = r.stable ? 1 : 0;
+        return PTM_OK;
+    });
+}
+
+int ptm_ensemble_summarize_reweighted(const ptm_ensemble* e, const double* probs, int n_probs, double* out) {
+    if (!e || !out || n_probs < 0 || (n_probs > 0 && !probs)) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        return copy_out(e->sampler.summarize_reweighted(std::vector<double>(probs, probs + n_probs)), out);
+    });
+}
+
+int ptm_ensemble_serialize(ptm_ensemble* e, int draw_encoding, uint8_t* out, int capacity) {
+    if (!e) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        e->sampler.serialize(draw_encoding);
+        return copy_checkpoint(e->sampler.get_checkpoint(), out, capacity);
+    });
+}
+
+ptm_ensemble* ptm_ensemble_deserialize(const uint8_t* bytes, int n) {
+    if (!bytes || n <= 0) return nullptr;
+    try {
+        ptm_ensemble* e = new ptm_ensemble();
+        if (e->sampler.deserialize(bytes, static_cast<size_t>(n))) return e;
+        delete e;
+    } catch (...) {
+    }
+    return nullptr;
+}
+
+// --- Biomarker panel ---
+
+ptm_panel* ptm_panel_create(const double* titres, const int* infected, int n_biomarkers, int n_subjects,
+                            int n_replicas, int n_rungs, const ptm_priors* base,
+                            int data_driven_ec50, int engine, uint32_t seed) {
+    if (!titres || !infected || !base || n_biomarkers <= 0 || n_subjects <= 0 ||
+        n_replicas < 1 || n_rungs < 1) return nullptr;
+    try {
+        SeedScope scope(seed);
+        ptm_panel* p = new ptm_panel(n_biomarkers, n_subjects);
+        p->sampler.assign(titres, infected);
+        p->sampler.prepare(n_replicas, n_rungs, to_priors(*base), data_driven_ec50 != 0, engine);
+        return p;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void ptm_panel_free(ptm_panel* p) { delete p; }
+
+int ptm_panel_set_ladder(ptm_panel* p, const ptm_ladder* ladder) {
+    if (!p || !ladder) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        p->sampler.set_ladder_policy(to_ladder(*ladder));
+        return PTM_OK;
+    });
+}
+
+int ptm_panel_set_cold_move(ptm_panel* p, int move, int warmup) {
+    if (!p) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        p->sampler.set_cold_move(move, warmup);
+        return PTM_OK;
+    });
+}
+
+int ptm_panel_set_stopping_rule(ptm_panel* p, double max_rhat, double min_ess, int check_every) {
+    if (!p) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        p->sampler.set_stopping_rule(max_rhat, min_ess, check_every);
+        return PTM_OK;
+    });
+}
+
+int ptm_panel_set_pointwise_loo(ptm_panel* p, int start) {
+    if (!p) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        p->sampler.set_pointwise_loo(start);
+        return PTM_OK;
+    });
+}
+
+int ptm_panel_set_subsampling(ptm_panel* p, int batch_size) {
+    if (!p) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        p->sampler.set_subsampling(batch_size);
+        return PTM_OK;
+    });
+}
+
+int ptm_panel_run(ptm_panel* p, int n_iterations) {
+    if (!p || n_iterations < 0) return PTM_ERR_ARGUMENT;
+    return guarded([&] { return p->sampler.run_chunk(n_iterations); });
+}
+
+int ptm_panel_iteration(const ptm_panel* p) {
+    return p ? p->sampler.get_iteration() : PTM_ERR_ARGUMENT;
+}
+
+int ptm_panel_converged(const ptm_panel* p) {
+    return p ? (p->sampler.is_converged() ? 1 : 0) : PTM_ERR_ARGUMENT;
+}
+
+int ptm_panel_get_priors(const ptm_panel* p, int biomarker, ptm_priors* out) {
+    if (!valid_biomarker(p, biomarker) || !out) return PTM_ERR_ARGUMENT;
+    from_priors(p->sampler.get_priors(biomarker), out);
+    return PTM_OK;
+}
+
+int ptm_panel_export_draws(ptm_panel* p, int biomarker, int warmup, int thin, double* out, int capacity) {
+    if (!valid_biomarker(p, biomarker)) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        p->sampler.export_draws(biomarker, warmup, thin);
+        return copy_draws(p->sampler.get_exported(biomarker), out, capacity);
+    });
+}
+
+int ptm_panel_diagnostics(const ptm_panel* p, int biomarker, int warmup, ptm_diagnostics* out) {
+    if (!valid_biomarker(p, biomarker) || !out) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        Diagnosed d{p->sampler.compute_rhat(biomarker, warmup), p->sampler.compute_ess_bulk(biomarker, warmup),
+                    p->sampler.compute_ess_tail(biomarker, warmup)};
+        fill_diagnostics(d, p->sampler.get_swap_rates(biomarker), out);
+        return PTM_OK;
+    });
+}
+
+int ptm_panel_loo(const ptm_panel* p, int biomarker, ptm_loo* out) {
+    if (!valid_biomarker(p, biomarker) || !out) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        from_loo(p->sampler.get_loo(biomarker), out);
+        return PTM_OK;
+    });
+}
+
+int ptm_panel_summarize(const ptm_panel* p, int biomarker, int warmup, const double* probs, int n_probs, double* out) {
+    if (!valid_biomarker(p, biomarker) || !out || n_probs < 0 || (n_probs > 0 && !probs)) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        return copy_out(p->sampler.summarize(biomarker, warmup, std::vector<double>(probs, probs + n_probs)), out);
+    });
+}
+
+int ptm_panel_serialize(ptm_panel* p, int draw_encoding, uint8_t* out, int capacity) {
+    if (!p) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        p->sampler.serialize(draw_encoding);
+        return copy_checkpoint(p->sampler.get_checkpoint(), out, capacity);
+    });
+}
+
+ptm_panel* ptm_panel_deserialize(const uint8_t* bytes, int n) {
+    if (!bytes || n <= 0) return nullptr;
+    try {
+        ptm_panel* p = new ptm_panel(0, 0);
+        if (p->sampler.deserialize(bytes, static_cast<size_t>(n))) return p;
+        delete p;
+    } catch (...) {
+    }
+    return nullptr;
+}
+
+// --- Simulation study ---
+
+ptm_study* ptm_study_create(int n_datasets, int n_subjects, double titre_mean, double titre_sd,
+                            const double* truth, const ptm_priors* priors,
+                            int n_replicas, int n_rungs, int engine, uint32_t seed) {
+    if (!priors || n_datasets <= 0 || n_subjects <= 0 || !(titre_sd >= 0.0) || n_replicas < 1 || n_rungs < 1) {
+        return nullptr;
+    }
+    try {
+        SeedScope scope(seed);
+        ptm_study* s = new ptm_study(n_datasets, n_subjects);
+        s->sampler.set_titre_distribution(titre_mean, titre_sd);
+        if (truth) {
+            s->sampler.simulate(Params(truth[0], truth[1], truth[2], truth[3]), to_priors(*priors), n_replicas, n_rungs, engine);
+        } else {
+            s->sampler.simulate_from_prior(to_priors(*priors), n_replicas, n_rungs, engine);
+        }
+        return s;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void ptm_study_free(ptm_study* s) { delete s; }
+
+int ptm_study_set_ladder(ptm_study* s, const ptm_ladder* ladder) {
+    if (!s || !ladder) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        s->sampler.set_ladder_policy(to_ladder(*ladder));
+        return PTM_OK;
+    });
+}
+
+int ptm_study_set_stopping_rule(ptm_study* s, double max_rhat, double min_ess, int check_every) {
+    if (!s) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        s->sampler.set_stopping_rule(max_rhat, min_ess, check_every);
+        return PTM_OK;
+    });
+}
+
+int ptm_study_run(ptm_study* s, int n_iterations) {
+    if (!s || n_iterations < 0) return PTM_ERR_ARGUMENT;
+    return guarded([&] { return s->sampler.run_chunk(n_iterations); });
+}
+
+int ptm_study_truths(const ptm_study* s, double* out) {
+    if (!s || !out) return PTM_ERR_ARGUMENT;
+    for (const Params& p : s->sampler.get_truths()) {
+        *out++ = p.floor;
+        *out++ = p.ceiling;
+        *out++ = p.ec50;
+        *out++ = p.slope;
+    }
+    return PTM_OK;
+}
+
+int ptm_study_summarize(const ptm_study* s, int warmup, const double* probs, int n_probs, double* out) {
+    if (!s || !out || n_probs < 0 || (n_probs > 0 && !probs)) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        return copy_out(s->sampler.summarize(warmup, std::vector<double>(probs, probs + n_probs)), out);
+    });
+}
+
+int ptm_study_power(const ptm_study* s, int param, int warmup, double level, double half_width, ptm_power* out) {
+    if (!s || !out || param < 0 || param > 3 || !(level > 0.0 && level < 1.0)) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        StudyPower p = s->sampler.power(param, warmup, level, half_width);
+        out->precision = p.precision;
+        out->coverage = p.coverage;
+        out->mean_half_width = p.mean_half_width;
+        out->rmse = p.rmse;
+        out->n_datasets = p.n_datasets;
+        return PTM_OK;
+    });
+}
+
+int ptm_study_sbc_ranks(const ptm_study* s, int warmup, int n_draws, int* out) {
+    if (!s || !out || n_draws < 1) return PTM_ERR_ARGUMENT;
+    return guarded([&] {
+        std::vector<int> ranks = s->sampler.sbc_ranks(warmup, n_draws);
+        std::copy(ranks.begin(), ranks.end(), out);
+        return PTM_OK;
+    });
+}
+
+} // extern "C"
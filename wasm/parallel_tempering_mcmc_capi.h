@@ -0,0 +1,240 @@
+/*
+ * C ABI for the parallel tempering sampler (parallel_tempering_mcmc.h), for
+ * native callers such as the server-side fitting service. The library runs
+ * the same algorithm as the WebAssembly module and reads and writes the same
+ * checkpoint format. A given seed reproduces its draws only within one build:
+ * compilers and math libraries differ in the last bits of exp/log, so native
+ * and browser runs agree in distribution, not draw for draw. Chains, replicas
+ * and biomarkers step concurrently on the library's worker pool.
+ *
+ * Threads: handles are independent, so different threads may create, run and
+ * free different handles at once; each handle's random streams come from the
+ * seed passed to its *_create and depend on nothing else. One handle must be
+ * used by one thread at a time. ptm_set_num_threads may be called at any
+ * time; runs already in progress finish on the previous pool.
+ *
+ * Build: `make capi` -> libptmcmc.so
+ *
+ * Conventions:
+ *   - Samplers are opaque handles created by *_create and released by *_free.
+ *   - Functions returning int report PTM_OK (0) or a negative PTM_ERR_* code,
+ *     unless documented as returning a count.
+ *   - Input buffers are copied; output buffers are caller-allocated.
+ *   - Draw buffers are column-major over [floor | ceiling | ec50 | slope],
+ *     each column holding every replica's draws back to back.
+ *   - Per-parameter arrays are ordered floor, ceiling, ec50, slope.
+ */
+
+#ifndef PARALLEL_TEMPERING_MCMC_CAPI_H
+#define PARALLEL_TEMPERING_MCMC_CAPI_H
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define PTM_API __declspec(dllexport)
+#else
+#define PTM_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever a signature or struct layout below changes */
+#define PTM_ABI_VERSION 2
+
+#define PTM_OK 0
+#define PTM_ERR_ARGUMENT -1  /* Null handle, bad index or size */
+#define PTM_ERR_CAPACITY -2  /* Output buffer too small */
+#define PTM_ERR_ALLOC -3     /* Out of memory inside the library */
+
+#define PTM_ENGINE_SCALAR 0
+#define PTM_ENGINE_SIMD 1
+#define PTM_ENGINE_MIXED 2 /* SIMD, single precision on heated rungs */
+#define PTM_MOVE_METROPOLIS 0
+#define PTM_MOVE_NUTS 1
+#define PTM_DRAWS_FLOAT64 0 /* Checkpointed draws: exact */
+#define PTM_DRAWS_FLOAT32 1 /* Rounded to single precision */
+#define PTM_DRAWS_DELTA 2   /* Exact, XOR-delta varint packed */
+
+typedef struct ptm_priors {
+    double floor_alpha, floor_beta;     /* Beta prior on floor */
+    double ceiling_alpha, ceiling_beta; /* Beta prior on ceiling */
+    double ec50_mean, ec50_sd;          /* Normal prior on ec50 */
+    double slope_mean, slope_sd;        /* Normal prior on slope, truncated at 0 */
+} ptm_priors;
+
+typedef struct ptm_ladder {
+    int adapt_until;         /* Tune the ladder over iterations [0, adapt_until) */
+    double max_temperature;  /* Hottest rung of the starting ladder */
+    double target_swap_rate; /* Per-pair rate used to size a trimmed ladder */
+    int min_rungs;
+    int trim;                /* Nonzero: drop surplus rungs at the end of tuning */
+} ptm_ladder;
+
+typedef struct ptm_diagnostics {
+    double rhat[4];     /* Rank-normalized split R-hat across replicas */
+    double ess_bulk[4];
+    double ess_tail[4];
+    double swap_rate;   /* Mean swap acceptance over replicas */
+} ptm_diagnostics;
+
+typedef struct ptm_loo {
+    double elpd_loo, se_elpd_loo, p_loo, looic;
+    double elpd_waic, se_elpd_waic, p_waic, waic;
+    double max_pareto_k;
+    int n_high_k; /* Observations with Pareto k > 0.7 */
+    int n_draws;
+} ptm_loo;
+
+typedef struct ptm_prior_sensitivity {
+    double pareto_k;    /* Shape of the smoothed importance weights' tail */
+    double k_threshold; /* Reweighting is reliable below this */
+    double ess;         /* Effective sample size of the weights */
+    int n_draws;
+    int stable;         /* Nonzero: pareto_k < k_threshold */
+} ptm_prior_sensitivity;
+
+typedef struct ptm_power {
+    double precision;       /* Fraction of datasets with interval half-width <= target */
+    double coverage;        /* Fraction whose interval contains the true value */
+    double mean_half_width;
+    double rmse;            /* Posterior mean against the true value */
+    int n_datasets;         /* Datasets with retained draws */
+} ptm_power;
+
+typedef struct ptm_ensemble ptm_ensemble;
+typedef struct ptm_panel ptm_panel;
+typedef struct ptm_study ptm_study;
+
+/* Library-wide settings */
+PTM_API int ptm_abi_version(void);
+PTM_API void ptm_set_num_threads(int n);
+PTM_API int ptm_get_num_threads(void);
+PTM_API int ptm_simd_enabled(void);
+PTM_API void ptm_default_priors(ptm_priors* out);
+
+/*
+ * Single biomarker: n_replicas independent ladders of n_rungs chains over one
+ * dataset. compress != 0 collapses repeated titres into binomial cells.
+ * The same seed and arguments reproduce the same draws. Returns NULL on
+ * invalid arguments or allocation failure.
+ */
+PTM_API ptm_ensemble* ptm_ensemble_create(const double* titre, const int* infected, int n,
+                                          int n_replicas, int n_rungs, const ptm_priors* priors,
+                                          int engine, int compress, uint32_t seed);
+PTM_API void ptm_ensemble_free(ptm_ensemble* e);
+
+PTM_API int ptm_ensemble_set_ladder(ptm_ensemble* e, const ptm_ladder* ladder);
+PTM_API int ptm_ensemble_set_cold_move(ptm_ensemble* e, int move, int warmup);
+PTM_API int ptm_ensemble_set_stopping_rule(ptm_ensemble* e, double max_rhat, double min_ess, int check_every);
+PTM_API int ptm_ensemble_set_pointwise_loo(ptm_ensemble* e, int start);
+/* Subsampled likelihood with ~batch_size / T terms per step on rung T; <= 0 turns it off */
+PTM_API int ptm_ensemble_set_subsampling(ptm_ensemble* e, int batch_size);
+
+/* Run up to n more iterations; returns the number run (fewer once converged) */
+PTM_API int ptm_ensemble_run(ptm_ensemble* e, int n_iterations);
+PTM_API int ptm_ensemble_iteration(const ptm_ensemble* e);
+PTM_API int ptm_ensemble_converged(const ptm_ensemble* e);
+
+/*
+ * Post-warmup draws, thinned: writes 4 * n values to out and returns n, the
+ * draws per column. With out == NULL returns n without writing; returns
+ * PTM_ERR_CAPACITY if capacity < 4 * n.
+ */
+PTM_API int ptm_ensemble_export_draws(ptm_ensemble* e, int warmup, int thin, double* out, int capacity);
+PTM_API int ptm_ensemble_diagnostics(const ptm_ensemble* e, int warmup, ptm_diagnostics* out);
+PTM_API int ptm_ensemble_loo(const ptm_ensemble* e, ptm_loo* out);
+
+/* Per parameter [mean, sd, q_1..q_K] for ascending probs: 4 * (2 + K) values */
+PTM_API int ptm_ensemble_summarize(const ptm_ensemble* e, int warmup, const double* probs, int n_probs, double* out);
+
+/* [mean | q_1 | ... | q_K] of P(infection), each block n_grid long: (1 + K) * n_grid values */
+PTM_API int ptm_ensemble_curve_bands(const ptm_ensemble* e, const double* grid, int n_grid, int warmup,
+                                     const double* probs, int n_probs, double* out);
+
+/*
+ * Refits after small changes to the priors or data. warm_start seeds every
+ * rung of e from the matching rung of an earlier fit (state, ladder and
+ * proposal tuning); call it before ptm_ensemble_run. reweight_priors instead
+ * importance-weights e's post-warmup draws towards new priors; when the
+ * result is stable, summarize_reweighted (layout as in summarize) can stand
+ * in for a refit.
+ */
+PTM_API int ptm_ensemble_warm_start(ptm_ensemble* e, const ptm_ensemble* previous);
+PTM_API int ptm_ensemble_reweight_priors(ptm_ensemble* e, const ptm_priors* priors, int warmup,
+                                         ptm_prior_sensitivity* out);
+PTM_API int ptm_ensemble_summarize_reweighted(const ptm_ensemble* e, const double* probs, int n_probs, double* out);
+
+/*
+ * Checkpoints: the complete sampler state with its data and priors, in the
+ * same byte format as the WebAssembly module's serialize(), so a browser run
+ * can continue here. serialize writes the checkpoint to out and returns its
+ * size in bytes; with out == NULL it only returns the size, and it returns
+ * PTM_ERR_CAPACITY if capacity is too small. deserialize returns NULL for
+ * other sampler kinds, format versions or corrupted bytes.
+ */
+PTM_API int ptm_ensemble_serialize(ptm_ensemble* e, int draw_encoding, uint8_t* out, int capacity);
+PTM_API ptm_ensemble* ptm_ensemble_deserialize(const uint8_t* bytes, int n);
+
+/*
+ * Biomarker panel: every biomarker fitted against the same outcomes, all
+ * biomarker x replica x rung chains stepped together. titres is the
+ * biomarker-major matrix (n_biomarkers * n_subjects). With data_driven_ec50
+ * each biomarker's ec50 prior is centred on its titre range (sd = range / 4).
+ */
+PTM_API ptm_panel* ptm_panel_create(const double* titres, const int* infected, int n_biomarkers, int n_subjects,
+                                    int n_replicas, int n_rungs, const ptm_priors* base,
+                                    int data_driven_ec50, int engine, uint32_t seed);
+PTM_API void ptm_panel_free(ptm_panel* p);
+
+PTM_API int ptm_panel_set_ladder(ptm_panel* p, const ptm_ladder* ladder);
+PTM_API int ptm_panel_set_cold_move(ptm_panel* p, int move, int warmup);
+PTM_API int ptm_panel_set_stopping_rule(ptm_panel* p, double max_rhat, double min_ess, int check_every);
+PTM_API int ptm_panel_set_pointwise_loo(ptm_panel* p, int start);
+PTM_API int ptm_panel_set_subsampling(ptm_panel* p, int batch_size);
+
+PTM_API int ptm_panel_run(ptm_panel* p, int n_iterations);
+PTM_API int ptm_panel_iteration(const ptm_panel* p);
+PTM_API int ptm_panel_converged(const ptm_panel* p);
+
+PTM_API int ptm_panel_get_priors(const ptm_panel* p, int biomarker, ptm_priors* out);
+PTM_API int ptm_panel_export_draws(ptm_panel* p, int biomarker, int warmup, int thin, double* out, int capacity);
+PTM_API int ptm_panel_diagnostics(const ptm_panel* p, int biomarker, int warmup, ptm_diagnostics* out);
+PTM_API int ptm_panel_loo(const ptm_panel* p, int biomarker, ptm_loo* out);
+PTM_API int ptm_panel_summarize(const ptm_panel* p, int biomarker, int warmup, const double* probs, int n_probs, double* out);
+
+PTM_API int ptm_panel_serialize(ptm_panel* p, int draw_encoding, uint8_t* out, int capacity);
+PTM_API ptm_panel* ptm_panel_deserialize(const uint8_t* bytes, int n);
+
+/*
+ * Simulation study: n_datasets synthetic cohorts of n_subjects with titres
+ * ~ Normal(titre_mean, titre_sd) and outcomes from the 4PL at truth
+ * (floor, ceiling, ec50, slope) or, with truth == NULL, at a fresh prior
+ * draw per dataset (for simulation-based calibration). Each dataset is
+ * fitted by n_replicas ladders of n_rungs chains, all stepped together;
+ * each replica keeps its latest 1000 cold-chain draws.
+ */
+PTM_API ptm_study* ptm_study_create(int n_datasets, int n_subjects, double titre_mean, double titre_sd,
+                                    const double* truth, const ptm_priors* priors,
+                                    int n_replicas, int n_rungs, int engine, uint32_t seed);
+PTM_API void ptm_study_free(ptm_study* s);
+
+PTM_API int ptm_study_set_ladder(ptm_study* s, const ptm_ladder* ladder);
+PTM_API int ptm_study_set_stopping_rule(ptm_study* s, double max_rhat, double min_ess, int check_every);
+PTM_API int ptm_study_run(ptm_study* s, int n_iterations);
+
+/* True parameters, 4 per dataset */
+PTM_API int ptm_study_truths(const ptm_study* s, double* out);
+/* ptm_ensemble_summarize's layout for every dataset: n_datasets * 4 * (2 + K) values */
+PTM_API int ptm_study_summarize(const ptm_study* s, int warmup, const double* probs, int n_probs, double* out);
+/* Central `level` intervals of param (0 floor .. 3 slope) against the truths */
+PTM_API int ptm_study_power(const ptm_study* s, int param, int warmup, double level, double half_width, ptm_power* out);
+/* Rank of each truth among n_draws evenly spaced draws, 4 per dataset; -1 where undefined */
+PTM_API int ptm_study_sbc_ranks(const ptm_study* s, int warmup, int n_draws, int* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PARALLEL_TEMPERING_MCMC_CAPI_H */
@@ -0,0 +1,400 @@
+/*
+ * Host regression tests for the parallel tempering sampler.
+ *
+ *   - checkpoints: a run serialized mid-way, restored and continued gives
+ *     bit-for-bit the draws and LOO of the uninterrupted run, for every draw
+ *     encoding that is exact; corrupted, truncated and mismatched checkpoints,
+ *     and re-checksummed ones with invalid contents, are rejected and leave
+ *     the sampler unchanged
+ *   - CSV: one upload pushed in chunks of every size from 1 byte to the
+ *     whole file parses to the same columns, counts and errors
+ *   - hierarchical results: a block outside [0, G + 1] gives no draws and
+ *     NaN summaries instead of reading past the per-block stores
+ *
+ * Each check prints a line on failure; the exit status is the number of
+ * failures. Build and run with `make test`.
+ */
+
+#include "parallel_tempering_mcmc.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+// Synthetic cohort from a known 4PL at assay resolution 0.1, so the data
+// compress to a few dozen cells (as in bench.cpp)
+Data make_cohort(int n, uint64_t seed) {
+    RngStream stream(seed);
+    const Params truth(0.05, 0.7, 2.0, 1.5);
+    std::vector<double> titre(n);
+    std::vector<int> infected(n);
+    for (int i = 0; i < n; ++i) {
+        titre[i] = std::round((2.0 + 1.5 * stream.normal()) * 10.0) / 10.0;
+        infected[i] = stream.uniform() < prob_infection(truth, titre[i]) ? 1 : 0;
+    }
+    Data data;
+    data.assign(titre.data(), infected.data(), n);
+    data.compress();
+    return data;
+}
+
+Priors default_priors() {
+    Priors priors;
+    priors.floor_alpha = 1.0;
+    priors.floor_beta = 9.0;
+    priors.ceiling_alpha = 9.0;
+    priors.ceiling_beta = 1.0;
+    priors.ec50_mean = 2.0;
+    priors.ec50_sd = 2.0;
+    priors.slope_mean = 1.0;
+    priors.slope_sd = 2.0;
+    return priors;
+}
+
+// An ensemble whose checkpoint falls inside ladder adaptation, NUTS warmup
+// and LOO accumulation, so all of that state has to survive the round trip
+ParallelTemperingEnsemble make_ensemble(const Data& data) {
+    set_random_seed(2024);
+    ParallelTemperingEnsemble ensemble(3, 6, data, default_priors());
+    LadderPolicy ladder;
+    ladder.adapt_until = 1500;
+    ensemble.set_ladder_policy(ladder);
+    ensemble.set_cold_move(MOVE_NUTS, 800);
+    ensemble.set_pointwise_loo(500);
+    return ensemble;
+}
+
+bool same_bits(const std::vector<double>& a, const std::vector<double>& b) {
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(double)) == 0);
+}
+
+bool same_loo(const LooSummary& a, const LooSummary& b) {
+    return std::memcmp(&a.elpd_loo, &b.elpd_loo, sizeof(double)) == 0 &&
+           std::memcmp(&a.p_loo, &b.p_loo, sizeof(double)) == 0 &&
+           std::memcmp(&a.max_pareto_k, &b.max_pareto_k, sizeof(double)) == 0 &&
+           a.n_high_k == b.n_high_k;
+}
+
+void test_checkpoint_round_trip() {
+    const Data data = make_cohort(400, 11);
+    for (int encoding : {DRAWS_FLOAT64, DRAWS_DELTA}) {
+        ParallelTemperingEnsemble original = make_ensemble(data);
+        original.run(1000);
+        const int size = original.serialize(encoding);
+        check(size > 0 && static_cast<size_t>(size) == original.get_checkpoint().size(), "checkpoint size");
+
+        ParallelTemperingEnsemble restored;
+        check(restored.deserialize(original.get_checkpoint().data(), original.get_checkpoint().size()),
+              "deserialize a valid checkpoint");
+        check(restored.get_iteration() == 1000, "restored iteration");
+
+        original.run(1000);
+        restored.run(1000);
+        original.export_draws(0, 1);
+        restored.export_draws(0, 1);
+        check(!original.get_exported().values.empty() &&
+              same_bits(original.get_exported().values, restored.get_exported().values),
+              "continued draws are bit-identical");
+        check(same_bits(original.get_temperatures(0), restored.get_temperatures(0)), "continued ladder");
+        check(same_loo(original.get_loo(), restored.get_loo()), "continued LOO");
+    }
+
+    // FLOAT32 rounds the retained draws but nothing else
+    ParallelTemperingEnsemble original = make_ensemble(data);
+    original.run(500);
+    original.serialize(DRAWS_FLOAT32);
+    ParallelTemperingEnsemble restored;
+    check(restored.deserialize(original.get_checkpoint().data(), original.get_checkpoint().size()),
+          "deserialize a float32 checkpoint");
+    original.export_draws(0, 1);
+    restored.export_draws(0, 1);
+    const auto& a = original.get_exported().values;
+    const auto& b = restored.get_exported().values;
+    bool rounded = a.size() == b.size();
+    for (size_t i = 0; rounded && i < a.size(); ++i) rounded = b[i] == static_cast<double>(static_cast<float>(a[i]));
+    check(rounded, "float32 draws are the rounded originals");
+}
+
+void test_checkpoint_rejection() {
+    const Data data = make_cohort(200, 12);
+    ParallelTemperingEnsemble source = make_ensemble(data);
+    source.run(300);
+    source.serialize(DRAWS_DELTA);
+    const std::vector<uint8_t> good = source.get_checkpoint();
+
+    // A reference sampler to restore over; failures must leave it as it was
+    ParallelTemperingEnsemble target = make_ensemble(data);
+    target.run(100);
+    target.export_draws(0, 1);
+    const std::vector<double> before = target.get_exported().values;
+    auto unchanged = [&] {
+        target.export_draws(0, 1);
+        return target.get_iteration() == 100 && same_bits(before, target.get_exported().values);
+    };
+
+    check(!target.deserialize(nullptr, 0), "reject an empty checkpoint");
+    check(unchanged(), "empty checkpoint leaves the sampler unchanged");
+
+    // Every truncation, of the framing and of the payload
+    bool all_rejected = true;
+    for (size_t n = 0; n < good.size(); n += 1 + n / 16) {
+        all_rejected = all_rejected && !target.deserialize(good.data(), n);
+    }
+    check(all_rejected && !target.deserialize(good.data(), good.size() - 1), "reject truncated checkpoints");
+    check(unchanged(), "truncated checkpoints leave the sampler unchanged");
+
+    // Truncated payload behind a valid checksum: must fail in the reader
+    for (size_t cut : {size_t(16), good.size() / 2, good.size() - 9}) {
+        std::vector<uint8_t> bytes(good.begin(), good.begin() + cut);
+        ByteWriter trailer;
+        trailer.put(fnv1a(bytes.data(), bytes.size()));
+        bytes.insert(bytes.end(), trailer.bytes.begin(), trailer.bytes.end());
+        check(!target.deserialize(bytes.data(), bytes.size()), "reject a re-checksummed truncated payload");
+    }
+    check(unchanged(), "short payloads leave the sampler unchanged");
+
+    // Single flipped bits anywhere, including the header and the checksum
+    all_rejected = true;
+    for (size_t i = 0; i < good.size(); i += 1 + i / 8) {
+        std::vector<uint8_t> bytes = good;
+        bytes[i] ^= 0x10;
+        all_rejected = all_rejected && !target.deserialize(bytes.data(), bytes.size());
+    }
+    check(all_rejected, "reject corrupted checkpoints");
+    check(unchanged(), "corrupted checkpoints leave the sampler unchanged");
+
+    // Right framing, wrong sampler kind or curve model
+    ParallelTemperingMCMC ladder;
+    check(!ladder.deserialize(good.data(), good.size()), "reject an ensemble checkpoint in a ladder");
+    ParallelTemperingEnsemble2PL reduced;
+    check(!reduced.deserialize(good.data(), good.size()), "reject a 4PL checkpoint in a 2PL ensemble");
+
+    check(target.deserialize(good.data(), good.size()), "accept the intact checkpoint afterwards");
+    check(target.get_iteration() == 300, "intact checkpoint restores its iteration");
+}
+
+// Byte order mark, quoted header and fields (with a delimiter, an escaped
+// quote and a newline inside), CRLF and LF line ends, padding, a blank line,
+// short rows (skipped), unused columns and no final newline
+const char kUpload[] =
+    "\xEF\xBB\xBF" "id,\"Titre\",igg, site ,infected,notes\r\n"
+    "1,2.5,1.25,north,1,plain\r\n"
+    "2, 0.75 ,3.5,\"south, coast\",0,\"two\r\nlines\"\r\n"
+    "3,1e-1,0.5,\"say \"\"hi\"\"\",1,\"\"\n"
+    "\r\n"
+    "4,3.0,2.0\r\n"
+    "5,4.25,,north,0,empty igg\n"
+    "6,-1.5,0.25,\"multi\nline\",0,x\n"
+    "7,2,1,north,1";
+
+struct CsvResult {
+    int error, error_row, rows, skipped, infected;
+    std::vector<std::string> header, biomarkers, group_names;
+    std::vector<std::vector<double>> columns;
+    std::vector<int> outcomes, groups;
+
+    bool operator==(const CsvResult& o) const {
+        return error == o.error && error_row == o.error_row && rows == o.rows && skipped == o.skipped &&
+               infected == o.infected && header == o.header && biomarkers == o.biomarkers &&
+               group_names == o.group_names && columns == o.columns && outcomes == o.outcomes && groups == o.groups;
+    }
+};
+
+CsvResult parse_in_chunks(const std::string& text, size_t chunk, bool with_groups) {
+    CsvParser parser;
+    parser.add_biomarker_column("titre");
+    parser.add_biomarker_column("IgG");
+    if (with_groups) parser.set_group_column("site");
+    for (size_t at = 0; at < text.size(); at += chunk) {
+        if (!parser.push(text.data() + at, std::min(chunk, text.size() - at))) break;
+    }
+    parser.finish();
+    CsvResult r;
+    r.error = parser.get_error();
+    r.error_row = parser.get_error_row();
+    r.rows = parser.get_num_rows();
+    r.skipped = parser.get_num_skipped();
+    r.infected = parser.get_num_infected();
+    r.header = parser.get_column_names();
+    r.biomarkers = parser.get_biomarker_names();
+    r.group_names = parser.get_group_names();
+    for (int b = 0; b < parser.get_num_biomarkers(); ++b) r.columns.push_back(parser.get_column(b));
+    r.outcomes = parser.get_infected();
+    r.groups = parser.get_groups();
+    return r;
+}
+
+void test_csv_chunking() {
+    const std::string text(kUpload, sizeof kUpload - 1);
+    const CsvResult whole = parse_in_chunks(text, text.size(), true);
+    check(whole.error == CSV_OK, "CSV parses");
+    check(whole.header == std::vector<std::string>({"id", "Titre", "igg", "site", "infected", "notes"}),
+          "CSV header without the byte order mark");
+    check(whole.rows == 5 && whole.skipped == 2 && whole.infected == 3, "CSV row counts");
+    check(whole.columns.size() == 2 &&
+          whole.columns[0] == std::vector<double>({2.5, 0.75, 0.1, -1.5, 2.0}) &&
+          whole.columns[1] == std::vector<double>({1.25, 3.5, 0.5, 0.25, 1.0}), "CSV biomarker columns");
+    check(whole.outcomes == std::vector<int>({1, 0, 1, 0, 1}), "CSV outcomes");
+    check(whole.group_names == std::vector<std::string>({"north", "south, coast", "say \"hi\"", "multi\nline"}) &&
+          whole.groups == std::vector<int>({0, 1, 2, 3, 0}), "CSV quoted groups");
+
+    bool same = true;
+    for (size_t chunk = 1; chunk <= text.size(); ++chunk) same = same && parse_in_chunks(text, chunk, true) == whole;
+    check(same, "CSV chunk size does not change the result");
+
+    // An invalid outcome inside a quoted multi-line row: the same error and
+    // row number wherever the chunks split
+    std::string bad = text;
+    bad.replace(bad.find(",0,x"), 4, ",2,x");
+    const CsvResult failed = parse_in_chunks(bad, bad.size(), true);
+    check(failed.error == CSV_ERR_OUTCOME && failed.error_row == 9, "CSV outcome error at the row's first line");
+    same = true;
+    for (size_t chunk = 1; chunk <= bad.size(); ++chunk) same = same && parse_in_chunks(bad, chunk, true) == failed;
+    check(same, "CSV chunk size does not change the error");
+}
+
+// Overwrite n bytes at `at` and recompute the checksum, so only the loader's
+// own validation can reject the result
+std::vector<uint8_t> resigned(std::vector<uint8_t> bytes, size_t at, const void* value, size_t n) {
+    std::memcpy(bytes.data() + at, value, n);
+    const size_t body = bytes.size() - sizeof(uint64_t);
+    const uint64_t hash = fnv1a(bytes.data(), body);
+    std::memcpy(bytes.data() + body, &hash, sizeof hash);
+    return bytes;
+}
+
+// Crafted run-control fields that the setters would have clamped
+void test_checkpoint_invalid_control() {
+    const Data data = make_cohort(200, 13);
+    std::vector<uint8_t> bytes[2];
+    for (int k = 0; k < 2; ++k) {
+        ParallelTemperingEnsemble ensemble = make_ensemble(data);
+        ensemble.set_stopping_rule(1.01, 400, k == 0 ? 1000 : 2000);
+        ensemble.run(200);
+        ensemble.serialize(DRAWS_FLOAT64);
+        bytes[k] = ensemble.get_checkpoint();
+    }
+    // check_every is the first field that differs; RunControl::save writes
+    // iteration, progress_every, max_rhat and min_ess just before it
+    size_t at = 0;
+    while (at < bytes[0].size() && bytes[0][at] == bytes[1][at]) at++;
+    const size_t check_at = at, progress_at = at - 20, iteration_at = at - 24;
+
+    ParallelTemperingEnsemble target;
+    const int32_t valid = 50, zero = 0, negative = -1;
+    check(target.deserialize(resigned(bytes[0], check_at, &valid, 4).data(), bytes[0].size()),
+          "accept a re-checksummed checkpoint with valid contents");
+    check(!target.deserialize(resigned(bytes[0], check_at, &zero, 4).data(), bytes[0].size()),
+          "reject check_every = 0");
+    const int32_t below = SWAP_INTERVAL - 1;
+    check(!target.deserialize(resigned(bytes[0], check_at, &below, 4).data(), bytes[0].size()),
+          "reject check_every below the swap interval");
+    check(!target.deserialize(resigned(bytes[0], progress_at, &zero, 4).data(), bytes[0].size()),
+          "reject progress_every = 0");
+    check(!target.deserialize(resigned(bytes[0], iteration_at, &negative, 4).data(), bytes[0].size()),
+          "reject a negative iteration");
+    check(target.get_iteration() == 200, "invalid control fields leave the sampler unchanged");
+    target.run(50);
+    check(target.get_iteration() == 250, "the accepted sampler still runs");
+}
+
+// Offset of the first occurrence of needle in bytes (bytes.size() if none)
+size_t find_bytes(const std::vector<uint8_t>& bytes, const ByteWriter& needle) {
+    const auto& n = needle.bytes;
+    auto it = std::search(bytes.begin(), bytes.end(), n.begin(), n.end());
+    return static_cast<size_t>(it - bytes.begin());
+}
+
+// Retained-draw counts that disagree with the stored draws, in ring mode
+// and without a ring
+void test_checkpoint_invalid_draws() {
+    const Data data = make_cohort(200, 14);
+    for (int capacity : {0, 777}) {
+        ParallelTemperingEnsemble ensemble = make_ensemble(data);
+        RetentionPolicy retention;
+        retention.capacity = capacity;
+        ensemble.set_retention(retention);
+        ensemble.run(300);
+        ensemble.serialize(DRAWS_DELTA);
+        const std::vector<uint8_t> good = ensemble.get_checkpoint();
+
+        // DrawStore::save header of a cold chain: enabled, start, thin,
+        // capacity, recorded, stored count
+        ByteWriter header;
+        header.put<uint8_t>(1);
+        header.put<int32_t>(0);
+        header.put<int32_t>(1);
+        header.put<int32_t>(capacity);
+        header.put<int64_t>(300);
+        header.put<uint64_t>(300);
+        const size_t at = find_bytes(good, header);
+        check(at < good.size(), "find the retained-draw header");
+        if (at >= good.size()) continue;
+        const size_t recorded_at = at + 13;
+
+        ParallelTemperingEnsemble target;
+        const int64_t same = 300, more = 500, fewer = 299, negative = -1;
+        check(target.deserialize(resigned(good, recorded_at, &same, 8).data(), good.size()),
+              "accept a re-checksummed draw count that matches");
+        check(!target.deserialize(resigned(good, recorded_at, &more, 8).data(), good.size()),
+              "reject more recorded draws than stored");
+        check(!target.deserialize(resigned(good, recorded_at, &fewer, 8).data(), good.size()),
+              "reject fewer recorded draws than stored");
+        check(!target.deserialize(resigned(good, recorded_at, &negative, 8).data(), good.size()),
+              "reject a negative draw count");
+        check(target.get_iteration() == 300, "invalid draw counts leave the sampler unchanged");
+    }
+}
+
+} // namespace
+
+void test_hierarchical_block_range() {
+    const Data cohort = make_cohort(200, 5);
+    std::vector<int> group(cohort.N);
+    for (int i = 0; i < cohort.N; ++i) group[i] = i % 3;
+    const GroupedData data(cohort.titre, cohort.infected, group);
+    GroupPriors priors;
+    priors.population = default_priors();
+    set_random_seed(7);
+    ParallelTemperingHierarchical sampler(2, data, priors);
+    sampler.run(200);
+
+    const int top = data.get_num_groups() + 1;
+    check(sampler.export_draws(top, 0, 1) > 0, "tau block has draws");
+    for (int block : {-1, top + 1}) {
+        check(sampler.export_draws(block, 0, 1) == 0 && sampler.get_exported().values.empty(),
+              "out-of-range block exports nothing");
+        const std::vector<double> summary = sampler.summarize(block, 0, {0.5});
+        const std::vector<double> bands = sampler.curve_bands(block, {0.0, 1.0}, 0, {0.5});
+        const std::vector<double> rhat = sampler.compute_rhat(block, 0);
+        const std::vector<double> ess = sampler.compute_ess(block, 0);
+        check(summary.size() == 12 && std::isnan(summary[0]), "out-of-range block summary is NaN");
+        check(bands.size() == 4 && std::isnan(bands[0]), "out-of-range block bands are NaN");
+        check(rhat.size() == 4 && std::isnan(rhat[0]) && ess.size() == 4 && std::isnan(ess[0]),
+              "out-of-range block diagnostics are NaN");
+    }
+}
+
+int main() {
+    test_checkpoint_round_trip();
+    test_checkpoint_rejection();
+    test_checkpoint_invalid_control();
+    test_checkpoint_invalid_draws();
+    test_csv_chunking();
+    test_hierarchical_block_range();
+    std::printf("%s (%d failure%s)\n", failures == 0 ? "ok" : "FAILED", failures, failures == 1 ? "" : "s");
+    return failures;
+}